@@ -3,12 +3,22 @@
 
 #include "headers/main.h"
 #include "headers/color.h"
+#include "headers/arena.h"
 #include "headers/config.h"
 #include "headers/framework.h"
 #include "headers/build.h"
 #include "headers/pkg.h"
+#include "headers/resolve.h"
+#include "headers/sched.h"
+#include "headers/changes.h"
 #include "headers/fs.h"
+#include "headers/cache.h"
 #include "headers/lock.h"
+#include "headers/sha256.h"
+#include "headers/stats.h"
+#include "headers/lz.h"
+#include "headers/vendor.h"
+#include "headers/workspace.h"
 #include "headers/cmake.h"
 #include "headers/cmd.h"
 
@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include "headers/arena.h"
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+struct ArenaBlock {
+    ArenaBlock *next;
+    size_t used;
+    size_t size;
+    /* max_align_t keeps the payload aligned for any type */
+    max_align_t data[];
+};
+
+Arena *arena_new(void) {
+    return calloc(1, sizeof(Arena));
+}
+
+void arena_destroy(Arena *a) {
+    if (!a) return;
+    ArenaBlock *b = a->head;
+    while (b) {
+        ArenaBlock *next = b->next;
+        free(b);
+        b = next;
+    }
+    free(a->interned);
+    free(a);
+}
+
+void *arena_alloc(Arena *a, size_t size) {
+    size = (size + sizeof(max_align_t) - 1) & ~(sizeof(max_align_t) - 1);
+
+    ArenaBlock *b = a->head;
+    if (!b || b->size - b->used < size) {
+        size_t bsize = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+        b = malloc(sizeof(ArenaBlock) + bsize);
+        if (!b) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        b->used = 0;
+        b->size = bsize;
+        b->next = a->head;
+        a->head = b;
+    }
+
+    void *p = (char *)b->data + b->used;
+    b->used += size;
+    return memset(p, 0, size);
+}
+
+char *arena_strdup(Arena *a, const char *s) {
+    size_t len = strlen(s);
+    char *p = arena_alloc(a, len + 1);
+    memcpy(p, s, len + 1);
+    return p;
+}
+
+static uint32_t str_hash(const char *s) {
+    uint32_t h = 2166136261u;
+    for (; *s; s++) {
+        h ^= (unsigned char)*s;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void intern_insert(const char **table, int cap, const char *s) {
+    uint32_t slot = str_hash(s) & (cap - 1);
+    while (table[slot])
+        slot = (slot + 1) & (cap - 1);
+    table[slot] = s;
+}
+
+const char *arena_intern(Arena *a, const char *s) {
+    if (a->intern_cap > 0) {
+        uint32_t slot = str_hash(s) & (a->intern_cap - 1);
+        while (a->interned[slot]) {
+            if (strcmp(a->interned[slot], s) == 0)
+                return a->interned[slot];
+            slot = (slot + 1) & (a->intern_cap - 1);
+        }
+    }
+
+    /* keep the set at most half full */
+    if ((a->intern_count + 1) * 2 > a->intern_cap) {
+        int cap = a->intern_cap ? a->intern_cap * 2 : 256;
+        const char **table = calloc(cap, sizeof(char *));
+        if (!table) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        for (int i = 0; i < a->intern_cap; i++)
+            if (a->interned[i]) intern_insert(table, cap, a->interned[i]);
+        free(a->interned);
+        a->interned = table;
+        a->intern_cap = cap;
+    }
+
+    const char *copy = arena_strdup(a, s);
+    intern_insert(a->interned, a->intern_cap, copy);
+    a->intern_count++;
+    return copy;
+}
+
+const char *arena_printf(Arena *a, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int len = vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+
+    char *p = arena_alloc(a, (size_t)len + 1);
+    va_start(ap, fmt);
+    vsnprintf(p, (size_t)len + 1, fmt, ap);
+    va_end(ap);
+    return p;
+}
+
+void *arena_grow(Arena *a, void *items, int count, int *cap, size_t size) {
+    if (count < *cap) return items;
+
+    int ncap = *cap ? *cap * 2 : 8;
+    void *grown = arena_alloc(a, (size_t)ncap * size);
+    if (count > 0)
+        memcpy(grown, items, (size_t)count * size);
+    *cap = ncap;
+    return grown;
+}
+
+/* --- string lists --- */
+
+void strlist_init(StrList *l, Arena *a) {
+    memset(l, 0, sizeof(StrList));
+    l->arena = a;
+}
+
+void strlist_push(StrList *l, const char *s) {
+    l->items = arena_grow(l->arena, l->items, l->count, &l->cap, sizeof(char *));
+    l->items[l->count++] = arena_intern(l->arena, s);
+}
+
+int strlist_contains(const StrList *l, const char *s) {
+    for (int i = 0; i < l->count; i++)
+        if (strcmp(l->items[i], s) == 0) return 1;
+    return 0;
+}
+
+/* --- string buffers --- */
+
+void strbuf_init(StrBuf *sb) {
+    sb->cap = 256;
+    sb->len = 0;
+    sb->data = malloc(sb->cap);
+    if (!sb->data) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    sb->data[0] = '\0';
+}
+
+void strbuf_printf(StrBuf *sb, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int len = vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+    if (len < 0) return;
+
+    if (sb->len + (size_t)len + 1 > sb->cap) {
+        size_t cap = sb->cap;
+        while (sb->len + (size_t)len + 1 > cap) cap *= 2;
+        char *data = realloc(sb->data, cap);
+        if (!data) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        sb->data = data;
+        sb->cap = cap;
+    }
+
+    va_start(ap, fmt);
+    vsnprintf(sb->data + sb->len, sb->cap - sb->len, fmt, ap);
+    va_end(ap);
+    sb->len += (size_t)len;
+}
+
+void strbuf_free(StrBuf *sb) {
+    free(sb->data);
+    memset(sb, 0, sizeof(StrBuf));
+}
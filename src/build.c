@@ -11,91 +11,117 @@ void build_dep_base(const Dependency *dep, const char *pkg_dir,
                     char *buf, int bufsz) {
     if (dep->path[0])
         snprintf(buf, bufsz, "%s", dep->path);
+    else if (dep->subdir[0])
+        snprintf(buf, bufsz, "%s/%s/%s", pkg_dir, dep->name, dep->subdir);
     else
         snprintf(buf, bufsz, "%s/%s", pkg_dir, dep->name);
 }
 
+int build_command(const char *prefix, const char *args, const char *suffix,
+                  const char *rsp_path, StrBuf *out) {
+    size_t len = strlen(prefix) + strlen(args) + strlen(suffix) + 2;
+    if (rsp_path && len > BUILD_RSP_THRESHOLD) {
+        FILE *f = fopen(rsp_path, "w");
+        if (!f) {
+            err("cannot write response file: %s", rsp_path);
+            return -1;
+        }
+        fputs(args, f);
+        fputc('\n', f);
+        fclose(f);
+        strbuf_printf(out, "%s @'%s' %s", prefix, rsp_path, suffix);
+    } else {
+        strbuf_printf(out, "%s %s %s", prefix, args, suffix);
+    }
+    return 0;
+}
+
+int build_run(const char *prefix, const char *args, const char *suffix,
+              const char *rsp_path) {
+    StrBuf cmd;
+    strbuf_init(&cmd);
+    if (build_command(prefix, args, suffix, rsp_path, &cmd) != 0) {
+        strbuf_free(&cmd);
+        return -1;
+    }
+
+    fflush(stdout);
+    int ret = system(cmd.data);
+    strbuf_free(&cmd);
+    return ret;
+}
+
 int build_collect_pkg_sources(const Config *cfg, const char *pkg_dir,
-                              const char *config_file,
-                              char files[][512], int max, int *count,
+                              const char *config_file, StrList *files,
                               GooseFramework *fw) {
-    *count = 0;
-    if (cfg->dep_count == 0) return 0;
-
     for (int i = 0; i < cfg->dep_count; i++) {
         char base[512];
         build_dep_base(&cfg->deps[i], pkg_dir, base, sizeof(base));
 
-        char pkg_cfg_path[512];
+        char pkg_cfg_path[1024];
         snprintf(pkg_cfg_path, sizeof(pkg_cfg_path), "%s/%s", base, config_file);
 
         /* if package has config with explicit sources, use those */
         if (fs_exists(pkg_cfg_path)) {
             Config pkg_cfg;
             if (config_load(pkg_cfg_path, &pkg_cfg, fw) == 0 && pkg_cfg.source_count > 0) {
-                for (int j = 0; j < pkg_cfg.source_count && *count < max; j++) {
-                    snprintf(files[*count], 512, "%s/%s", base, pkg_cfg.sources[j]);
-                    (*count)++;
-                }
+                for (int j = 0; j < pkg_cfg.source_count; j++)
+                    strlist_push(files, arena_printf(files->arena, "%s/%s",
+                                                     base, pkg_cfg.sources[j]));
+                config_free(&pkg_cfg);
                 continue;
             }
+            config_free(&pkg_cfg);
         }
 
         /* fallback: collect all .c files */
-        char pkg_src[512];
+        char pkg_src[1024];
         snprintf(pkg_src, sizeof(pkg_src), "%s/src", base);
 
         if (!fs_exists(pkg_src))
             snprintf(pkg_src, sizeof(pkg_src), "%s", base);
 
-        int found = 0;
-        fs_collect_sources(pkg_src, files + *count, max - *count, &found);
-        *count += found;
+        fs_collect_sources(pkg_src, files);
     }
     return 0;
 }
 
 void build_include_flags(const Config *cfg, const char *pkg_dir,
-                         const char *config_file, char *buf, int bufsz,
+                         const char *config_file, StrBuf *out,
                          GooseFramework *fw) {
-    buf[0] = '\0';
-    int off = 0;
-
     /* project includes from config */
     for (int i = 0; i < cfg->include_count; i++)
-        off += snprintf(buf + off, bufsz - off, "-I%s ", cfg->includes[i]);
+        strbuf_printf(out, "-I%s ", cfg->includes[i]);
 
     /* package includes */
     for (int i = 0; i < cfg->dep_count; i++) {
         char base[512];
         build_dep_base(&cfg->deps[i], pkg_dir, base, sizeof(base));
 
-        char pkg_cfg_path[512];
+        char pkg_cfg_path[1024];
         snprintf(pkg_cfg_path, sizeof(pkg_cfg_path), "%s/%s", base, config_file);
 
         if (fs_exists(pkg_cfg_path)) {
             Config pkg_cfg;
             if (config_load(pkg_cfg_path, &pkg_cfg, fw) == 0) {
-                for (int j = 0; j < pkg_cfg.include_count; j++) {
-                    char inc[512];
-                    snprintf(inc, sizeof(inc), "%s/%s", base, pkg_cfg.includes[j]);
-                    off += snprintf(buf + off, bufsz - off, "-I%s ", inc);
-                }
+                for (int j = 0; j < pkg_cfg.include_count; j++)
+                    strbuf_printf(out, "-I%s/%s ", base, pkg_cfg.includes[j]);
+                config_free(&pkg_cfg);
                 continue;
             }
         }
 
         /* fallback: try src/, root, include/ */
-        char inc[512];
+        char inc[1024];
         snprintf(inc, sizeof(inc), "%s/src", base);
         if (fs_exists(inc))
-            off += snprintf(buf + off, bufsz - off, "-I%s ", inc);
+            strbuf_printf(out, "-I%s ", inc);
 
-        off += snprintf(buf + off, bufsz - off, "-I%s ", base);
+        strbuf_printf(out, "-I%s ", base);
 
         snprintf(inc, sizeof(inc), "%s/include", base);
         if (fs_exists(inc))
-            off += snprintf(buf + off, bufsz - off, "-I%s ", inc);
+            strbuf_printf(out, "-I%s ", inc);
     }
 }
 
@@ -107,15 +133,18 @@ int build_transpile(const Config *cfg, const char *build_dir) {
     snprintf(gen_dir, sizeof(gen_dir), "%s/gen", build_dir);
     fs_mkdir(gen_dir);
 
-    for (int p = 0; p < cfg->plugin_count; p++) {
-        char plugin_files[MAX_SRC_FILES][512];
-        int file_count = 0;
-        fs_collect_ext(cfg->src_dir, cfg->plugins[p].ext,
-                       plugin_files, MAX_SRC_FILES, &file_count);
+    Arena *arena = arena_new();
+    int rc = 0;
+
+    for (int p = 0; p < cfg->plugin_count && rc == 0; p++) {
+        StrList plugin_files;
+        strlist_init(&plugin_files, arena);
+        fs_collect_ext(cfg->src_dir, cfg->plugins[p].ext, &plugin_files);
 
-        for (int i = 0; i < file_count; i++) {
-            const char *base = strrchr(plugin_files[i], '/');
-            base = base ? base + 1 : plugin_files[i];
+        for (int i = 0; i < plugin_files.count; i++) {
+            const char *file = plugin_files.items[i];
+            const char *base = strrchr(file, '/');
+            base = base ? base + 1 : file;
 
             char stem[256];
             strncpy(stem, base, sizeof(stem) - 1);
@@ -125,15 +154,21 @@ int build_transpile(const Config *cfg, const char *build_dir) {
 
             info("Transpiling", "%s (%s)", base, cfg->plugins[p].name);
 
-            char cmd[2048];
-            snprintf(cmd, sizeof(cmd), "'%s' '%s' > '%s/%s.c'",
-                     cfg->plugins[p].command, plugin_files[i], gen_dir, stem);
-
-            if (system(cmd) != 0) {
-                err("transpile failed: %s", plugin_files[i]);
-                return -1;
+            StrBuf cmd;
+            strbuf_init(&cmd);
+            strbuf_printf(&cmd, "'%s' '%s' > '%s/%s.c'",
+                          cfg->plugins[p].command, file, gen_dir, stem);
+            int ret = system(cmd.data);
+            strbuf_free(&cmd);
+
+            if (ret != 0) {
+                err("transpile failed: %s", file);
+                rc = -1;
+                break;
             }
         }
     }
-    return 0;
+
+    arena_destroy(arena);
+    return rc;
 }
@@ -0,0 +1,71 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "headers/cache.h"
+#include "headers/fs.h"
+
+int cache_root(char *buf, int bufsz) {
+    const char *dir = getenv("GOOSE_CACHE_DIR");
+    if (dir && dir[0]) {
+        snprintf(buf, bufsz, "%s", dir);
+        return 0;
+    }
+    dir = getenv("XDG_CACHE_HOME");
+    if (dir && dir[0]) {
+        snprintf(buf, bufsz, "%s/goose", dir);
+        return 0;
+    }
+    dir = getenv("HOME");
+    if (dir && dir[0]) {
+        snprintf(buf, bufsz, "%s/.cache/goose", dir);
+        return 0;
+    }
+    return -1;
+}
+
+void cache_key_field(Sha256 *ctx, const char *field) {
+    sha256_update(ctx, field, strlen(field) + 1);
+}
+
+int cache_fetch(const char *kind, const char *key, const char *file,
+                const char *dest) {
+    char root[1024];
+    if (cache_root(root, sizeof(root)) != 0) return -1;
+
+    char path[2048];
+    snprintf(path, sizeof(path), "%s/%s/%s/%s", root, kind, key, file);
+    if (!fs_exists(path)) return -1;
+
+    char cmd[4096];
+    snprintf(cmd, sizeof(cmd), "cp -f '%s' '%s'", path, dest);
+    return system(cmd) == 0 ? 0 : -1;
+}
+
+int cache_store(const char *kind, const char *key, const char *src,
+                const char *file) {
+    char root[1024];
+    if (cache_root(root, sizeof(root)) != 0) return -1;
+
+    char entry[2048], tmp[2048];
+    snprintf(entry, sizeof(entry), "%s/%s/%s", root, kind, key);
+    if (fs_exists(entry)) return 0;
+
+    /* stage next to the entry so the final rename stays on one filesystem */
+    snprintf(tmp, sizeof(tmp), "%s/%s/.%s.%ld", root, kind, key, (long)getpid());
+
+    char cmd[8192];
+    snprintf(cmd, sizeof(cmd), "mkdir -p '%s' && cp -f '%s' '%s/%s'",
+             tmp, src, tmp, file);
+    if (system(cmd) != 0) {
+        fs_rmrf(tmp);
+        return -1;
+    }
+
+    /* another build may have published the same key first; theirs wins */
+    if (rename(tmp, entry) != 0) {
+        fs_rmrf(tmp);
+        return fs_exists(entry) ? 0 : -1;
+    }
+    return 0;
+}
@@ -0,0 +1,595 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include "config.h"
+#include "harness.h"
+#include "build.h"
+#include "test.h"
+#include "bench.h"
+#include "../headers/config.h"
+#include "../headers/build.h"
+#include "../headers/framework.h"
+#include "../headers/fs.h"
+#include "../headers/cache.h"
+#include "../headers/sched.h"
+#include "../headers/sha256.h"
+#include "../headers/color.h"
+#include "../headers/stats.h"
+
+static int cmp_str(const void *a, const void *b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+/* a duration in nanoseconds with a unit that keeps it readable */
+static void format_ns(double ns, char *out, size_t size) {
+    if (ns < 1e3)
+        snprintf(out, size, "%.2f ns", ns);
+    else if (ns < 1e6)
+        snprintf(out, size, "%.2f us", ns / 1e3);
+    else if (ns < 1e9)
+        snprintf(out, size, "%.2f ms", ns / 1e6);
+    else
+        snprintf(out, size, "%.2f s", ns / 1e9);
+}
+
+/* iterations per second in powers of 1000, bytes in powers of 1024 */
+static void format_rate(double per_sec, int bytes, char *out, size_t size) {
+    static const char *si[] = {"", "K", "M", "G", "T"};
+    static const char *bin[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+    double step = bytes ? 1024 : 1000;
+    int u = 0;
+    while (per_sec >= step && u < 4) {
+        per_sec /= step;
+        u++;
+    }
+    snprintf(out, size, "%.2f %s/s", per_sec, bytes ? bin[u] : si[u]);
+}
+
+/* the counters the runner reads with --counters, named as in its
+ * report and the JSON, with their column in the table */
+static const struct {
+    const char *name;
+    const char *column;
+} bench_counters[] = {
+    {"cycles", "cycles"},
+    {"instructions", "instructions"},
+    {"cache_misses", "cache-miss"},
+    {"branch_misses", "branch-miss"},
+    {"task_clock_ns", "task-clock"},
+    {"page_faults", "faults"},
+    {"context_switches", "ctx-sw"},
+};
+#define BENCH_COUNTERS \
+    (int)(sizeof(bench_counters) / sizeof(bench_counters[0]))
+enum { COUNTER_CYCLES, COUNTER_INSTRUCTIONS, COUNTER_TASK_CLOCK = 4 };
+
+/* one line of a samples file: a benchmark's name, iterations per sample,
+ * bytes per iteration, nanoseconds per iteration of each sample and any
+ * counters per iteration */
+typedef struct {
+    const char *name;
+    const char *iters;
+    double bytes;
+    double *v;
+    int n;
+    double counter[BENCH_COUNTERS];
+    unsigned counted;   /* bit i set if counter[i] was read */
+} BenchRow;
+
+typedef struct {
+    BenchRow *rows;
+    int count;
+    char key[SHA256_HEX_LEN];   /* a baseline's "# key" line, else "" */
+} BenchSet;
+
+/* read a samples file written by the runner, or a baseline saved from
+ * one. returns -1 if it cannot be read */
+static int load_benches(const char *path, Arena *arena, BenchSet *out) {
+    memset(out, 0, sizeof(*out));
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    int cap = 0;
+    char *line = NULL;
+    size_t line_cap = 0;
+    while (getline(&line, &line_cap, f) > 0) {
+        if (strncmp(line, "# key ", 6) == 0) {
+            snprintf(out->key, sizeof(out->key), "%.64s", line + 6);
+            continue;
+        }
+        char *name = strtok(line, "\t"), *iters = strtok(NULL, "\t");
+        char *bytes = strtok(NULL, "\t"), *list = strtok(NULL, "\t\n");
+        char *counters = strtok(NULL, "\n");
+        if (!name || !iters || !bytes || !list || name[0] == '#') continue;
+        out->rows = arena_grow(arena, out->rows, out->count, &cap,
+                               sizeof(BenchRow));
+        BenchRow *r = &out->rows[out->count++];
+        memset(r, 0, sizeof(*r));
+        r->name = arena_strdup(arena, name);
+        r->iters = arena_strdup(arena, iters);
+        r->bytes = strtod(bytes, NULL);
+        int vcap = 0;
+        for (char *tok = strtok(list, ","); tok; tok = strtok(NULL, ",")) {
+            r->v = arena_grow(arena, r->v, r->n, &vcap, sizeof(double));
+            r->v[r->n++] = strtod(tok, NULL);
+        }
+        for (char *tok = counters ? strtok(counters, ",") : NULL; tok;
+             tok = strtok(NULL, ",")) {
+            char *eq = strchr(tok, '=');
+            if (!eq) continue;
+            *eq = '\0';
+            for (int k = 0; k < BENCH_COUNTERS; k++)
+                if (strcmp(tok, bench_counters[k].name) == 0) {
+                    r->counter[k] = strtod(eq + 1, NULL);
+                    r->counted |= 1u << k;
+                }
+        }
+    }
+    free(line);
+    fclose(f);
+    return 0;
+}
+
+static int has_ipc(unsigned counted) {
+    unsigned both = 1u << COUNTER_CYCLES | 1u << COUNTER_INSTRUCTIONS;
+    return (counted & both) == both;
+}
+
+/* a table of the counters per iteration, with a column for each counter
+ * some benchmark has, and instructions per cycle when both were read */
+static void report_counters(const BenchSet *cur) {
+    unsigned any = 0;
+    for (int i = 0; i < cur->count; i++) any |= cur->rows[i].counted;
+    if (!any) return;
+
+    printf("  %-32s", "per iteration");
+    for (int k = 0; k < BENCH_COUNTERS; k++) {
+        if (any & 1u << k) printf(" %12s", bench_counters[k].column);
+        if (k == COUNTER_INSTRUCTIONS && has_ipc(any)) printf(" %6s", "IPC");
+    }
+    printf("\n");
+    for (int i = 0; i < cur->count; i++) {
+        const BenchRow *r = &cur->rows[i];
+        if (!r->counted) continue;
+        printf("  %-32s", r->name);
+        for (int k = 0; k < BENCH_COUNTERS; k++) {
+            char val[32] = "-";
+            if (r->counted & 1u << k) {
+                if (k == COUNTER_TASK_CLOCK)
+                    format_ns(r->counter[k], val, sizeof(val));
+                else
+                    snprintf(val, sizeof(val), "%.4g", r->counter[k]);
+            }
+            if (any & 1u << k) printf(" %12s", val);
+            if (k == COUNTER_INSTRUCTIONS && has_ipc(any)) {
+                if (has_ipc(r->counted) && r->counter[COUNTER_CYCLES] > 0)
+                    snprintf(val, sizeof(val), "%.2f",
+                             r->counter[COUNTER_INSTRUCTIONS] /
+                             r->counter[COUNTER_CYCLES]);
+                else
+                    snprintf(val, sizeof(val), "-");
+                printf(" %6s", val);
+            }
+        }
+        printf("\n");
+    }
+    printf("\n");
+}
+
+static const BenchRow *find_bench(const BenchSet *set, const char *name) {
+    for (int i = 0; set && i < set->count; i++)
+        if (strcmp(set->rows[i].name, name) == 0) return &set->rows[i];
+    return NULL;
+}
+
+/* what a comparison against the baseline says about one benchmark: it
+ * moved only if the confidence interval of the change excludes zero, and
+ * regressed only if the whole interval lies above fail_above (0 = never),
+ * so a noisy run does not fail on a slowdown it cannot show */
+static const char *bench_verdict(const StatsChange *c, double fail_above) {
+    if (c->lo > 0)
+        return fail_above > 0 && c->lo > fail_above ? "regressed" : "slower";
+    if (c->hi < 0) return "faster";
+    return "unchanged";
+}
+
+/* print a table of the benchmarks' summaries, compare them against base
+ * when there is one and write it all as JSON. returns how many
+ * benchmarks there were and counts the regressed ones */
+static int report_benches(const BenchSet *cur, const BenchSet *base,
+                          const char *base_name, double fail_above,
+                          const char *json, const char *project,
+                          double seconds, int *regressed) {
+    StrBuf out;
+    strbuf_init(&out);
+    strbuf_printf(&out, "{\n  \"project\": ");
+    json_string(&out, project);
+    strbuf_printf(&out, ",\n  \"seconds\": %g", seconds);
+    if (base) {
+        strbuf_printf(&out, ",\n  \"baseline\": ");
+        json_string(&out, base_name);
+    }
+    strbuf_printf(&out, ",\n  \"benchmarks\": [");
+
+    printf("\n  %-32s %12s %12s %12s %16s\n", "benchmark", "median", "MAD",
+           "p99", "throughput");
+    int count = 0;
+    for (int i = 0; i < cur->count; i++) {
+        const BenchRow *r = &cur->rows[i];
+        Stats st;
+        if (stats_summary(r->v, r->n, &st) != 0 || st.median <= 0) continue;
+
+        double rate = r->bytes > 0 ? r->bytes * 1e9 / st.median
+                                   : 1e9 / st.median;
+        char med[32], mad[32], p99[32], thr[32];
+        format_ns(st.median, med, sizeof(med));
+        format_ns(st.mad, mad, sizeof(mad));
+        format_ns(st.p99, p99, sizeof(p99));
+        format_rate(rate, r->bytes > 0, thr, sizeof(thr));
+        printf("  %-32s %12s %12s %12s %16s\n", r->name, med, mad, p99, thr);
+
+        strbuf_printf(&out, "%s\n    {\"name\": ", count ? "," : "");
+        json_string(&out, r->name);
+        strbuf_printf(&out, ", \"iterations\": %s, \"samples\": %d, "
+                      "\"median_ns\": %.3f, \"mad_ns\": %.3f, "
+                      "\"p99_ns\": %.3f, \"min_ns\": %.3f, "
+                      "\"mean_ns\": %.3f, \"ops_per_sec\": %.1f",
+                      r->iters, st.n, st.median, st.mad, st.p99, st.min,
+                      st.mean, 1e9 / st.median);
+        if (r->bytes > 0)
+            strbuf_printf(&out, ", \"bytes_per_sec\": %.1f", rate);
+        if (r->counted) {
+            const char *sep = "";
+            strbuf_printf(&out, ", \"counters\": {");
+            for (int k = 0; k < BENCH_COUNTERS; k++) {
+                if (!(r->counted & 1u << k)) continue;
+                strbuf_printf(&out, "%s\"%s\": %.6g", sep,
+                              bench_counters[k].name, r->counter[k]);
+                sep = ", ";
+            }
+            if (has_ipc(r->counted) && r->counter[COUNTER_CYCLES] > 0)
+                strbuf_printf(&out, ", \"ipc\": %.4f",
+                              r->counter[COUNTER_INSTRUCTIONS] /
+                                  r->counter[COUNTER_CYCLES]);
+            strbuf_printf(&out, "}");
+        }
+
+        const BenchRow *b = find_bench(base, r->name);
+        StatsChange c;
+        Stats bst;
+        if (b && stats_compare(b->v, b->n, r->v, r->n, 0.95, &c) == 0 &&
+            stats_summary(b->v, b->n, &bst) == 0)
+            strbuf_printf(&out, ", \"baseline_median_ns\": %.3f, "
+                          "\"change\": %.4f, \"change_lo\": %.4f, "
+                          "\"change_hi\": %.4f, \"verdict\": \"%s\"",
+                          bst.median, c.change, c.lo, c.hi,
+                          bench_verdict(&c, fail_above));
+        else if (base)
+            strbuf_printf(&out, ", \"verdict\": \"new\"");
+        strbuf_printf(&out, "}");
+        count++;
+    }
+    strbuf_printf(&out, "%s]\n}\n", count ? "\n  " : "");
+    printf("\n");
+    report_counters(cur);
+
+    /* the change of each median with its 95% bootstrap interval */
+    if (base) {
+        info("Comparing", "against baseline %s (95%% confidence)",
+             base_name);
+        printf("\n  %-32s %12s %12s %9s %21s\n", "benchmark", "baseline",
+               "now", "change", "interval");
+        for (int i = 0; i < cur->count; i++) {
+            const BenchRow *r = &cur->rows[i];
+            const BenchRow *b = find_bench(base, r->name);
+            Stats st, bst;
+            if (stats_summary(r->v, r->n, &st) != 0 || st.median <= 0)
+                continue;
+            char now[32], was[32];
+            format_ns(st.median, now, sizeof(now));
+            StatsChange c;
+            if (!b || stats_summary(b->v, b->n, &bst) != 0 ||
+                stats_compare(b->v, b->n, r->v, r->n, 0.95, &c) != 0) {
+                printf("  %-32s %12s %12s %9s %21s ", r->name, "-", now, "-",
+                       "-");
+                cprintf(CLR_CYAN, "new");
+                printf("\n");
+                continue;
+            }
+            char change[16], interval[40];
+            format_ns(bst.median, was, sizeof(was));
+            snprintf(change, sizeof(change), "%+.2f%%", c.change * 100);
+            snprintf(interval, sizeof(interval), "%+.2f%% .. %+.2f%%",
+                     c.lo * 100, c.hi * 100);
+            printf("  %-32s %12s %12s %9s %21s ", r->name, was, now, change,
+                   interval);
+            const char *verdict = bench_verdict(&c, fail_above);
+            if (strcmp(verdict, "regressed") == 0) {
+                cprintf(CLR_RED, "%s", verdict);
+                (*regressed)++;
+            } else if (strcmp(verdict, "slower") == 0) {
+                cprintf(CLR_YELLOW, "%s", verdict);
+            } else if (strcmp(verdict, "faster") == 0) {
+                cprintf(CLR_GREEN, "%s", verdict);
+            } else {
+                printf("%s", verdict);
+            }
+            printf("\n");
+        }
+        printf("\n");
+    }
+
+    if (fs_write_file(json, out.data) != 0)
+        warn("Results", "cannot write %s", json);
+    strbuf_free(&out);
+    return count;
+}
+
+/* what a baseline was measured with: the compile and link flags and the
+ * compiler's version. comparing against one made some other way measures
+ * the toolchain as much as the code */
+static void bench_key(const char *prefix, const char *includes,
+                      const char *ldflags, const char *cc,
+                      char key[SHA256_HEX_LEN]) {
+    Sha256 ctx;
+    sha256_init(&ctx);
+    cache_key_field(&ctx, "goose-bench-1");
+    cache_key_field(&ctx, prefix);
+    cache_key_field(&ctx, includes);
+    cache_key_field(&ctx, ldflags);
+    cache_key_field(&ctx, compiler_id(cc));
+    sha256_final_hex(&ctx, key);
+}
+
+/* keep a run's samples as a named baseline, headed by its key */
+static int save_baseline(const char *samples, const char *path,
+                         const char *key) {
+    FILE *in = fopen(samples, "r");
+    if (!in) return -1;
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        fclose(in);
+        return -1;
+    }
+    fprintf(out, "# key %s\n", key);
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0)
+        fwrite(buf, 1, n, out);
+    fclose(in);
+    return fclose(out) == 0 ? 0 : -1;
+}
+
+int c_bench(const Config *cfg, const char *build_dir, const char *pkg_dir,
+            const char *config_file, const char *bench_dir, void *userdata) {
+    GooseFramework *fw = (GooseFramework *)userdata;
+    CConfig cc = *(CConfig *)fw->custom_data;
+
+    if (!fs_exists(bench_dir)) {
+        err("no %s/ directory found", bench_dir);
+        return 1;
+    }
+
+    /* baselines live next to the samples they were saved from */
+    Arena *arena = arena_new();
+    const char *out_dir = arena_printf(arena, "%s/bench", build_dir);
+    const char *base_path = NULL, *save_path = NULL;
+    if (fw->bench_baseline) {
+        base_path = arena_printf(arena, "%s/baselines/%s.tsv", out_dir,
+                                 fw->bench_baseline);
+        if (!fs_exists(base_path)) {
+            err("no baseline named %s (save one with --save-baseline %s)",
+                fw->bench_baseline, fw->bench_baseline);
+            arena_destroy(arena);
+            return 1;
+        }
+    }
+    if (fw->bench_save_baseline)
+        save_path = arena_printf(arena, "%s/baselines/%s.tsv", out_dir,
+                                 fw->bench_save_baseline);
+
+    StrList files;
+    strlist_init(&files, arena);
+    fs_collect_sources(bench_dir, &files);
+    qsort(files.items, files.count, sizeof(char *), cmp_str);
+    if (files.count == 0) {
+        warn("Bench", "no benchmark files found in %s/", bench_dir);
+        arena_destroy(arena);
+        return 0;
+    }
+    if (build_transpile(cfg, build_dir) != 0) {
+        arena_destroy(arena);
+        return 1;
+    }
+
+    /* benchmarks measure release code, linked from the same objects as
+     * goose build --release and goose test --release */
+    StrList srcs;
+    StrBuf includes, ldflags, bench_includes, cmd;
+    strlist_init(&srcs, arena);
+    strbuf_init(&includes);
+    strbuf_init(&ldflags);
+    strbuf_init(&bench_includes);
+    strbuf_init(&cmd);
+    const char *prefix = linked_sources(cfg, 1, build_dir, pkg_dir,
+                                        config_file, &cc, &srcs, &includes,
+                                        &ldflags, arena, fw);
+    SharedObjs so;
+    shared_objs_init(&so, build_dir, 1, prefix, includes.data, arena);
+
+    /* goose_bench.h comes with goose, written where benchmarks find it */
+    const char *inc_dir = arena_printf(arena, "%s/include", out_dir);
+    const char *bin = arena_printf(arena, "%s/%s", out_dir, C_BENCH_RUNNER);
+    const char *main_src = arena_printf(arena, "%s_main.c", bin);
+    fs_mkdir(build_dir);
+    fs_mkdir(out_dir);
+    fs_mkdir(inc_dir);
+    int rc = fs_write_file(arena_printf(arena, "%s/goose_bench.h", inc_dir),
+                           c_bench_harness);
+    if (rc == 0)
+        rc = fs_write_file(main_src, "#define GOOSE_BENCH_RUNNER\n"
+                                     "#include \"goose_bench.h\"\n");
+    if (rc != 0) {
+        err("cannot write the benchmark harness to %s", out_dir);
+        goto done;
+    }
+    strbuf_printf(&bench_includes, "%s-I%s ", includes.data, inc_dir);
+
+    info("Benching", "%s v%s (release)", cfg->name, cfg->version);
+
+    /* every file of benchmarks compiles on its own and links once into
+     * the runner, together with the shared objects */
+    Sched *s = sched_new(fw->jobs);
+    rc = 1;
+    if (!s) {
+        err("out of memory");
+        goto done;
+    }
+    sched_keep_going(s);
+    StrBuf objs;
+    strbuf_init(&objs);
+    int ok = shared_objs_queue(&so, s, &srcs, prefix, includes.data,
+                               arena) == 0;
+    int first = sched_size(s);
+    for (int i = 0; ok && i <= files.count; i++) {
+        char stem[128];
+        const char *src = i < files.count ? files.items[i] : main_src;
+        test_name(src, stem, sizeof(stem));
+        strbuf_free(&cmd);
+        strbuf_init(&cmd);
+        strbuf_printf(&cmd, "%s %s'%s' -MMD -c -o '%s/%s.o' > "
+                      "'%s/%s.log' 2>&1", prefix, bench_includes.data, src,
+                      out_dir, stem, out_dir, stem);
+        ok = sched_cmd(s, cmd.data, NULL) >= 0;
+        strbuf_printf(&objs, "'%s/%s.o' ", out_dir, stem);
+    }
+    int last = sched_size(s);
+
+    const char *suffix = arena_printf(arena, "-o '%s'%s > '%s.log' 2>&1",
+                                      bin, ldflags.data, bin);
+    const char *rsp = arena_printf(arena, "%s.rsp", bin);
+    strbuf_printf(&objs, "%s", so.quoted.data);
+    strbuf_free(&cmd);
+    strbuf_init(&cmd);
+    int link = -1;
+    if (ok && build_command(prefix, objs.data, suffix, rsp, &cmd) == 0 &&
+        (link = sched_cmd(s, cmd.data, NULL)) >= 0) {
+        sched_after_range(s, link, so.from, so.to);
+        sched_after_range(s, link, first, last);
+    }
+    strbuf_free(&objs);
+    if (link < 0) {
+        err("cannot queue the benchmark build");
+        sched_free(s);
+        goto done;
+    }
+    shared_objs_report(&so, "benchmarks");
+    sched_run(s);
+    shared_objs_built(&so, s);
+    int linked = sched_status(s, link) == SCHED_DONE;
+    sched_free(s);
+    if (!linked) {
+        for (int i = 0; i <= files.count; i++) {
+            char stem[128];
+            test_name(i < files.count ? files.items[i] : main_src, stem,
+                      sizeof(stem));
+            print_file(arena_printf(arena, "%s/%s.log", out_dir, stem));
+        }
+        print_file(arena_printf(arena, "%s.log", bin));
+        fflush(stdout);
+        err("benchmarks failed to build");
+        goto done;
+    }
+
+    /* one benchmark at a time, in the foreground: anything running next
+     * to it would be measured too */
+    double seconds = fw->bench_time > 0 ? fw->bench_time : 1;
+    const char *samples = arena_printf(arena, "%s/samples.tsv", out_dir);
+    const char *json = arena_printf(arena, "%s/results.json", out_dir);
+    strbuf_free(&cmd);
+    strbuf_init(&cmd);
+    strbuf_printf(&cmd, "'%s' --report '%s' --time %g", bin, samples,
+                  seconds);
+    if (fw->bench_filter)
+        strbuf_printf(&cmd, " --filter '%s'", fw->bench_filter);
+    if (fw->bench_counters)
+        strbuf_printf(&cmd, " --counters");
+    info("Running", "each benchmark for about %gs", seconds);
+    fflush(stdout);
+    remove(samples);
+    int status = system(cmd.data);
+
+    char key[SHA256_HEX_LEN];
+    bench_key(prefix, includes.data, ldflags.data, cc.cc, key);
+    BenchSet cur, base;
+    load_benches(samples, arena, &cur);
+    int have_base = base_path && load_benches(base_path, arena,
+                                                 &base) == 0;
+    unsigned counted = 0;
+    for (int i = 0; i < cur.count; i++) counted |= cur.rows[i].counted;
+    if (fw->bench_counters && cur.count > 0 && !counted)
+        warn("Counters", "perf_event_open is not available here; "
+             "no counters were read");
+    else if (fw->bench_counters && cur.count > 0 &&
+             !(counted & 1u << COUNTER_CYCLES))
+        warn("Counters", "no hardware counters exposed here (no PMU, or "
+             "a VM); software counters only");
+    /* a baseline of other flags or another compiler measures the
+     * toolchain as well as the code: it is shown, but does not gate */
+    double fail_above = fw->bench_fail_above;
+    if (have_base && strcmp(base.key, key) != 0) {
+        if (fail_above > 0)
+            warn("Baseline", "%s was measured with other flags or another "
+                 "compiler; comparing without --fail-above",
+                 fw->bench_baseline);
+        else
+            warn("Baseline", "%s was measured with other flags or another "
+                 "compiler", fw->bench_baseline);
+        fail_above = 0;
+    }
+    int regressed = 0;
+    int count = report_benches(&cur, have_base ? &base : NULL,
+                               fw->bench_baseline, fail_above, json,
+                               cfg->name, seconds, &regressed);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        if (WIFSIGNALED(status))
+            err("benchmark runner died of signal %d", WTERMSIG(status));
+        else
+            err("benchmark runner failed (exit %d)", WEXITSTATUS(status));
+        goto done;
+    }
+    if (count == 0 && fw->bench_filter)
+        warn("Bench", "no benchmark matches %s", fw->bench_filter);
+    info("Results", "%d benchmark%s, written to %s", count,
+         count == 1 ? "" : "s", json);
+
+    /* a filtered run saves only what it ran, which is still a fair
+     * baseline for the same filter later */
+    if (save_path) {
+        fs_mkdir(arena_printf(arena, "%s/baselines", out_dir));
+        if (save_baseline(samples, save_path, key) != 0) {
+            err("cannot write %s", save_path);
+            goto done;
+        }
+        info("Saved", "baseline %s to %s", fw->bench_save_baseline,
+             save_path);
+    }
+    if (regressed > 0) {
+        fflush(stdout);
+        err("%d benchmark%s regressed by more than %g%% against "
+            "baseline %s", regressed, regressed == 1 ? "" : "s",
+            fw->bench_fail_above * 100, fw->bench_baseline);
+        goto done;
+    }
+    rc = 0;
+
+done:
+    strbuf_free(&includes);
+    strbuf_free(&ldflags);
+    strbuf_free(&bench_includes);
+    strbuf_free(&cmd);
+    strbuf_free(&so.quoted);
+    arena_destroy(arena);
+    *(CConfig *)fw->custom_data = cc;
+    return rc;
+}
@@ -0,0 +1,11 @@
+#ifndef GOOSE_CC_BENCH_H
+#define GOOSE_CC_BENCH_H
+
+#include "../headers/config.h"
+
+/* goose bench: build the benchmarks against the project's release
+ * objects, run them one at a time and report them */
+int c_bench(const Config *cfg, const char *build_dir, const char *pkg_dir,
+            const char *config_file, const char *bench_dir, void *userdata);
+
+#endif
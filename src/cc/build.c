@@ -2,36 +2,41 @@
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <sys/stat.h>
 #include "config.h"
+#include "build.h"
 #include "../headers/config.h"
 #include "../headers/build.h"
 #include "../headers/framework.h"
 #include "../headers/fs.h"
+#include "../headers/pkg.h"
+#include "../headers/cache.h"
+#include "../headers/sched.h"
 #include "../headers/color.h"
 
 /* collect ldflags from package config files */
 static void collect_pkg_ldflags(const Config *cfg, const char *pkg_dir,
-                                const char *config_file, char *buf, int bufsz,
+                                const char *config_file, StrBuf *out,
                                 GooseFramework *fw) {
-    int off = (int)strlen(buf);
     for (int i = 0; i < cfg->dep_count; i++) {
         char base[512];
         build_dep_base(&cfg->deps[i], pkg_dir, base, sizeof(base));
 
-        char pkg_cfg_path[512];
+        char pkg_cfg_path[1024];
         snprintf(pkg_cfg_path, sizeof(pkg_cfg_path), "%s/%s", base, config_file);
         if (!fs_exists(pkg_cfg_path)) continue;
 
         Config pkg_cfg;
         if (config_load(pkg_cfg_path, &pkg_cfg, fw) != 0) continue;
+        config_free(&pkg_cfg);
 
         /* read ldflags from package custom_data */
         CConfig *pcc = (CConfig *)fw->custom_data;
         if (strlen(pcc->ldflags) == 0) continue;
 
-        if (strstr(buf, pcc->ldflags) == NULL) {
-            if (off > 0 && off < bufsz - 1) buf[off++] = ' ';
-            off += snprintf(buf + off, bufsz - off, "%s", pcc->ldflags);
+        if (strstr(out->data, pcc->ldflags) == NULL) {
+            if (out->len > 0) strbuf_printf(out, " ");
+            strbuf_printf(out, "%s", pcc->ldflags);
         }
     }
 }
@@ -42,83 +47,209 @@ static int dep_is_lib(const Dependency *dep, const char *pkg_dir,
     char base[512];
     build_dep_base(dep, pkg_dir, base, sizeof(base));
 
-    char pkg_cfg_path[512];
+    char pkg_cfg_path[1024];
     snprintf(pkg_cfg_path, sizeof(pkg_cfg_path), "%s/%s", base, config_file);
     if (!fs_exists(pkg_cfg_path)) return 0;
 
     Config pkg_cfg;
     if (config_load(pkg_cfg_path, &pkg_cfg, fw) != 0) return 0;
-    return strcmp(pkg_cfg.type, "lib") == 0;
-}
-
-/* compile a list of sources to objects in obj_dir, then archive into out_a.
- * returns 0 on success. */
-static int archive_objects(const char *cc, const char *cflags,
-                           const char *defines, const char *mode_flags,
-                           const char *includes,
-                           char srcs[][512], int src_count,
-                           const char *obj_dir, const char *out_a) {
-    char mkcmd[1024];
-    snprintf(mkcmd, sizeof(mkcmd), "mkdir -p '%s'", obj_dir);
-    if (system(mkcmd) != 0) {
-        err("cannot create object directory: %s", obj_dir);
-        return -1;
-    }
+    int is_lib = strcmp(pkg_cfg.type, "lib") == 0;
+    config_free(&pkg_cfg);
+    return is_lib;
+}
 
-    char objs[MAX_SRC_FILES][512];
-    for (int i = 0; i < src_count; i++) {
-        const char *base = strrchr(srcs[i], '/');
-        base = base ? base + 1 : srcs[i];
-
-        char stem[256];
-        strncpy(stem, base, sizeof(stem) - 1);
-        stem[sizeof(stem) - 1] = '\0';
-        char *dot = strrchr(stem, '.');
-        if (dot) *dot = '\0';
-
-        snprintf(objs[i], sizeof(objs[i]), "%s/%s.o", obj_dir, stem);
-
-        char cmd[16384];
-        snprintf(cmd, sizeof(cmd), "%s %s %s %s %s -c '%s' -o '%s'",
-                 cc, cflags, defines, mode_flags, includes, srcs[i], objs[i]);
-        fflush(stdout);
-        if (system(cmd) != 0) {
-            err("compilation failed: %s", srcs[i]);
-            return -1;
-        }
+/* object file for src under obj_dir. the source path (relative to base,
+ * when it lies under it) is mirrored, with ".." components as "__", so
+ * files with one name in different directories do not collide */
+const char *object_path(Arena *arena, const char *obj_dir,
+                        const char *src, const char *base) {
+    size_t blen = base ? strlen(base) : 0;
+    if (blen && strncmp(src, base, blen) == 0 && src[blen] == '/')
+        src += blen + 1;
+
+    char rel[2048];
+    int off = 0;
+    char tmp[2048];
+    snprintf(tmp, sizeof(tmp), "%s", src);
+    for (char *tok = strtok(tmp, "/"); tok; tok = strtok(NULL, "/")) {
+        if (strcmp(tok, ".") == 0) continue;
+        off += snprintf(rel + off, sizeof(rel) - off, "%s%s",
+                        off ? "/" : "", strcmp(tok, "..") == 0 ? "__" : tok);
+        if (off >= (int)sizeof(rel)) break;
     }
+    rel[sizeof(rel) - 1] = '\0';
 
-    char arcmd[16384];
-    int off = snprintf(arcmd, sizeof(arcmd), "ar rcs '%s'", out_a);
-    for (int i = 0; i < src_count; i++)
-        off += snprintf(arcmd + off, sizeof(arcmd) - off, " '%s'", objs[i]);
-    fflush(stdout);
-    if (system(arcmd) != 0) {
-        err("archive failed: %s", out_a);
+    char *slash = strrchr(rel, '/');
+    char *dot = strrchr(rel, '.');
+    if (dot && (!slash || dot > slash)) *dot = '\0';
+    return arena_printf(arena, "%s/%s.o", obj_dir, rel);
+}
+
+/* the compiler command every object of a project is built with */
+const char *compile_prefix(const CConfig *cc, const char *pkg_defines,
+                           int release, Arena *arena) {
+    return arena_printf(arena, "%s %s %s %s", cc->cc, cc->cflags, pkg_defines,
+                        release ? "-O2 -DNDEBUG" : "-g -DDEBUG");
+}
+
+/* objects in a directory were built with the flags its "flags" file
+ * names, so another command with equal flags may link them as they are */
+void flags_key(const char *prefix, const char *includes,
+               char key[SHA256_HEX_LEN]) {
+    Sha256 ctx;
+    sha256_init(&ctx);
+    cache_key_field(&ctx, "goose-flags-1");
+    cache_key_field(&ctx, prefix);
+    cache_key_field(&ctx, includes);
+    sha256_final_hex(&ctx, key);
+}
+
+int flags_match(const char *obj_dir, const char *key) {
+    char path[1024], line[SHA256_HEX_LEN + 2] = "";
+    snprintf(path, sizeof(path), "%s/flags", obj_dir);
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    if (!fgets(line, sizeof(line), f)) line[0] = '\0';
+    fclose(f);
+    line[strcspn(line, "\n")] = '\0';
+    return strcmp(line, key) == 0;
+}
+
+void flags_write(const char *obj_dir, const char *key) {
+    char path[1024], content[SHA256_HEX_LEN + 2];
+    snprintf(path, sizeof(path), "%s/flags", obj_dir);
+    snprintf(content, sizeof(content), "%s\n", key);
+    fs_mkdir_p(obj_dir);
+    fs_write_file(path, content);
+}
+
+static int newer_than(const char *prereq, void *ctx) {
+    struct stat st;
+    return stat(prereq, &st) != 0 || st.st_mtime >= *(time_t *)ctx;
+}
+
+/* whether obj is newer than everything its depfile (from -MMD) lists.
+ * equal timestamps count as stale, since seconds are all we compare */
+int object_fresh(const char *obj) {
+    struct stat st;
+    if (stat(obj, &st) != 0) return 0;
+    char dep[1024];
+    snprintf(dep, sizeof(dep), "%s", obj);
+    size_t n = strlen(dep);
+    if (n < 2 || strcmp(dep + n - 2, ".o") != 0) return 0;
+    dep[n - 1] = 'd';
+    time_t built = st.st_mtime;
+    return depfile_each(dep, newer_than, &built) == 0;
+}
+
+/* queue compiling src into obj. returns the job id, -1 on error */
+int queue_compile(Sched *s, const char *prefix, const char *includes,
+                  const char *src, const char *obj, Arena *arena) {
+    char dir[2048];
+    snprintf(dir, sizeof(dir), "%s", obj);
+    char *slash = strrchr(dir, '/');
+    if (slash) *slash = '\0';
+    if (fs_mkdir_p(dir) != 0) {
+        err("cannot create object directory: %s", dir);
         return -1;
     }
 
-    char rancmd[1024];
-    snprintf(rancmd, sizeof(rancmd), "ranlib '%s' 2>/dev/null", out_a);
-    system(rancmd);
-    return 0;
+    StrBuf args, cmd;
+    strbuf_init(&args);
+    strbuf_init(&cmd);
+    strbuf_printf(&args, "%s'%s'", includes, src);
+    const char *suffix = arena_printf(arena, "-MMD -c -o '%s'", obj);
+    const char *rsp = arena_printf(arena, "%s.rsp", obj);
+
+    int id = -1;
+    if (build_command(prefix, args.data, suffix, rsp, &cmd) == 0)
+        id = sched_cmd(s, cmd.data,
+                       arena_printf(arena, "compilation failed: %s", src));
+    strbuf_free(&args);
+    strbuf_free(&cmd);
+    return id;
+}
+
+/* queue archiving objs into out_a once jobs [from, now) are done, which
+ * is where their compiles were queued. GNU ar reads long member lists from
+ * a response file; the BSD ar shipped on macOS does not, so there the list
+ * is split into batches that each fit on a command line. returns the id of
+ * the last archive job, -1 on error */
+static int queue_archive(Sched *s, const char *out_a, const char *obj_dir,
+                         const StrList *objs, int from) {
+    int to = sched_size(s);
+    char msg[1100];
+    snprintf(msg, sizeof(msg), "archive failed: %s", out_a);
+
+    /* start from an empty archive so members of deleted sources go */
+    StrBuf prefix, args, cmd;
+    strbuf_init(&prefix);
+    strbuf_init(&args);
+    strbuf_init(&cmd);
+    strbuf_printf(&prefix, "rm -f '%s' && ar rcs '%s'", out_a, out_a);
+
+    int id = -1;
+#ifdef __APPLE__
+    (void)obj_dir;
+    int prev = -1;
+    for (int i = 0; i < objs->count; i++) {
+        strbuf_printf(&args, "'%s' ", objs->items[i]);
+        int last = i == objs->count - 1;
+        if (!last && args.len <= BUILD_RSP_THRESHOLD / 2) continue;
+
+        cmd.len = 0;
+        cmd.data[0] = '\0';
+        build_command(prefix.data, args.data, "", NULL, &cmd);
+        if (last)
+            strbuf_printf(&cmd, " && { ranlib '%s' 2>/dev/null || true; }",
+                          out_a);
+        id = sched_cmd(s, cmd.data, msg);
+        if (id < 0) break;
+        sched_after_range(s, id, from, to);
+        if (prev >= 0) sched_after(s, id, prev);
+        prev = id;
+
+        /* later batches add to the archive the first one started */
+        prefix.len = 0;
+        prefix.data[0] = '\0';
+        strbuf_printf(&prefix, "ar rcs '%s'", out_a);
+        args.len = 0;
+        args.data[0] = '\0';
+    }
+#else
+    for (int i = 0; i < objs->count; i++)
+        strbuf_printf(&args, "'%s' ", objs->items[i]);
+    char rsp[1024];
+    snprintf(rsp, sizeof(rsp), "%s/ar.rsp", obj_dir);
+    fs_mkdir_p(obj_dir);
+    if (build_command(prefix.data, args.data, "", rsp, &cmd) == 0) {
+        strbuf_printf(&cmd, " && { ranlib '%s' 2>/dev/null || true; }", out_a);
+        id = sched_cmd(s, cmd.data, msg);
+        if (id >= 0) sched_after_range(s, id, from, to);
+    }
+#endif
+
+    strbuf_free(&prefix);
+    strbuf_free(&args);
+    strbuf_free(&cmd);
+    return id;
 }
 
 /* collect -D defines from package cflags */
-static void collect_pkg_defines(const Config *cfg, const char *pkg_dir,
-                                const char *config_file, char *buf, int bufsz,
-                                GooseFramework *fw) {
-    int off = (int)strlen(buf);
+void collect_pkg_defines(const Config *cfg, const char *pkg_dir,
+                         const char *config_file, StrBuf *out,
+                         GooseFramework *fw) {
     for (int i = 0; i < cfg->dep_count; i++) {
         char base[512];
         build_dep_base(&cfg->deps[i], pkg_dir, base, sizeof(base));
 
-        char pkg_cfg_path[512];
+        char pkg_cfg_path[1024];
         snprintf(pkg_cfg_path, sizeof(pkg_cfg_path), "%s/%s", base, config_file);
         if (!fs_exists(pkg_cfg_path)) continue;
 
         Config pkg_cfg;
         if (config_load(pkg_cfg_path, &pkg_cfg, fw) != 0) continue;
+        config_free(&pkg_cfg);
 
         CConfig *pcc = (CConfig *)fw->custom_data;
         if (strlen(pcc->cflags) == 0) continue;
@@ -135,9 +266,9 @@ static void collect_pkg_defines(const Config *cfg, const char *pkg_dir,
                 if (flen < (int)sizeof(flag)) {
                     memcpy(flag, start, flen);
                     flag[flen] = '\0';
-                    if (strstr(buf, flag) == NULL) {
-                        if (off > 0 && off < bufsz - 1) buf[off++] = ' ';
-                        off += snprintf(buf + off, bufsz - off, "%s", flag);
+                    if (strstr(out->data, flag) == NULL) {
+                        if (out->len > 0) strbuf_printf(out, " ");
+                        strbuf_printf(out, "%s", flag);
                     }
                 }
             } else {
@@ -147,370 +278,730 @@ static void collect_pkg_defines(const Config *cfg, const char *pkg_dir,
     }
 }
 
-int c_build(const Config *cfg, int release, const char *build_dir,
-            const char *pkg_dir, const char *config_file, void *userdata) {
-    (void)userdata;
+/* hash of `cc --version`, so a compiler upgrade changes every cache key.
+ * computed once per compiler command */
+const char *compiler_id(const char *cc) {
+    static char last_cc[64];
+    static char id[SHA256_HEX_LEN];
+    if (id[0] && strcmp(last_cc, cc) == 0) return id;
+
+    char cmd[256];
+    snprintf(cmd, sizeof(cmd), "%s --version 2>/dev/null", cc);
+    Sha256 ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, cc, strlen(cc));
+    FILE *p = popen(cmd, "r");
+    if (p) {
+        char buf[1024];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), p)) > 0)
+            sha256_update(&ctx, buf, n);
+        pclose(p);
+    }
+    sha256_final_hex(&ctx, id);
+    snprintf(last_cc, sizeof(last_cc), "%s", cc);
+    return id;
+}
 
-    /* get framework from userdata to access custom_data */
-    GooseFramework *fw = (GooseFramework *)userdata;
-    CConfig *cc = (CConfig *)fw->custom_data;
+/* fold the revision of every package deps reach, their own dependencies
+ * too, into ctx: a header of any of them can end up in the archive. each
+ * once, in the order the configs list them. returns -1 on a live path
+ * checkout */
+static int cache_key_deps(Sha256 *ctx, const Dependency *deps, int count,
+                          const char *pkg_dir, const char *config_file,
+                          StrList *seen, GooseFramework *fw) {
+    for (int i = 0; i < count; i++) {
+        const Dependency *d = &deps[i];
+        if (strlist_contains(seen, d->name)) continue;
+        strlist_push(seen, d->name);
+
+        char rev[256];
+        if (pkg_content_id(d, pkg_dir, rev, sizeof(rev)) != 0) return -1;
+        cache_key_field(ctx, d->name);
+        cache_key_field(ctx, rev);
+        cache_key_field(ctx, d->subdir);
+
+        char base[512], cfg_path[1024];
+        build_dep_base(d, pkg_dir, base, sizeof(base));
+        snprintf(cfg_path, sizeof(cfg_path), "%s/%s", base, config_file);
+        if (!fs_exists(cfg_path)) continue;
+        Config sub;
+        if (config_load(cfg_path, &sub, fw) != 0) return -1;
+        int rc = cache_key_deps(ctx, sub.deps, sub.dep_count, pkg_dir,
+                                config_file, seen, fw);
+        config_free(&sub);
+        if (rc != 0) return -1;
+    }
+    return 0;
+}
 
-    char out_dir[512];
-    snprintf(out_dir, sizeof(out_dir), "%s/%s",
-             build_dir, release ? "release" : "debug");
-    fs_mkdir(build_dir);
-    fs_mkdir(out_dir);
+/* artifact cache key for a lib dependency: what is built (its revision and
+ * the revisions of every package it depends on, directly or not) and how
+ * (compiler, flags, defines, include set). returns -1 when any of those
+ * packages is a live path checkout, which is never cached */
+static int lib_cache_key(const Dependency *dep, const Config *dep_cfg,
+                         const CConfig *cc, const char *defines,
+                         const char *mode_flags, const char *includes,
+                         const char *pkg_dir, const char *config_file,
+                         Arena *arena, GooseFramework *fw,
+                         char key[SHA256_HEX_LEN]) {
+    char rev[256];
+    if (pkg_content_id(dep, pkg_dir, rev, sizeof(rev)) != 0) return -1;
+
+    Sha256 ctx;
+    sha256_init(&ctx);
+    cache_key_field(&ctx, "goose-lib-2");
+    cache_key_field(&ctx, dep->name);
+    cache_key_field(&ctx, rev);
+    cache_key_field(&ctx, dep->subdir);
+    cache_key_field(&ctx, compiler_id(cc->cc));
+    cache_key_field(&ctx, cc->cflags);
+    cache_key_field(&ctx, mode_flags);
+    cache_key_field(&ctx, defines);
+    cache_key_field(&ctx, includes);
+
+    StrList seen;
+    strlist_init(&seen, arena);
+    strlist_push(&seen, dep->name);
+    if (cache_key_deps(&ctx, dep_cfg->deps, dep_cfg->dep_count, pkg_dir,
+                       config_file, &seen, fw) != 0)
+        return -1;
+
+    sha256_final_hex(&ctx, key);
+    return 0;
+}
 
-    char src_files[MAX_SRC_FILES][512];
-    int src_count = 0;
-    fs_collect_sources(cfg->src_dir, src_files, MAX_SRC_FILES, &src_count);
+/* an artifact cache entry to publish once its archive is built */
+typedef struct {
+    char key[SHA256_HEX_LEN];
+    const char *archive;
+} CacheStore;
 
-    /* collect generated sources */
-    char gen_dir[512];
-    snprintf(gen_dir, sizeof(gen_dir), "%s/gen", build_dir);
-    if (fs_exists(gen_dir)) {
-        int gen_count = 0;
-        fs_collect_sources(gen_dir, src_files + src_count,
-                           MAX_SRC_FILES - src_count, &gen_count);
-        src_count += gen_count;
-    }
+static int cache_store_job(Sched *s, void *ctx, int arg) {
+    (void)s; (void)arg;
+    CacheStore *cs = ctx;
+    cache_store("artifacts", cs->key, cs->archive, "lib.a");
+    return 0;
+}
 
-    if (src_count == 0) {
-        err("no source files found in %s/", cfg->src_dir);
+/* queue building one lib dependency into <out_dir>/lib<name>.a, or copy it
+ * from the artifact cache when the same revision was already built the
+ * same way */
+static int queue_lib_dep(Sched *s, const Dependency *dep, const CConfig *cc,
+                         const char *defines, const char *mode_flags,
+                         int release, const char *out_dir, const char *pkg_dir,
+                         const char *config_file, Arena *arena,
+                         StrList *lib_archives, GooseFramework *fw) {
+    char base[512];
+    build_dep_base(dep, pkg_dir, base, sizeof(base));
+
+    /* load the lib's own config to find its sources */
+    char dep_cfg_path[1024];
+    snprintf(dep_cfg_path, sizeof(dep_cfg_path), "%s/%s", base, config_file);
+    Config dep_cfg;
+    if (config_load(dep_cfg_path, &dep_cfg, fw) != 0) {
+        err("cannot load lib config: %s", dep_cfg_path);
         return -1;
     }
 
-    char includes[4096];
-    build_include_flags(cfg, pkg_dir, config_file, includes,
-                        sizeof(includes), fw);
+    /* the lib's include flags (its public headers) */
+    StrBuf lib_inc;
+    strbuf_init(&lib_inc);
+    build_include_flags(&dep_cfg, pkg_dir, config_file, &lib_inc, fw);
+    for (int j = 0; j < dep_cfg.include_count; j++)
+        strbuf_printf(&lib_inc, "-I%s/%s ", base, dep_cfg.includes[j]);
+
+    const char *dep_obj_dir = arena_printf(arena, "%s/deps/%s",
+                                           out_dir, dep->name);
+    const char *dep_a = arena_printf(arena, "%s/lib%s.a", out_dir, dep->name);
+    const char *mode = release ? "release" : "debug";
+
+    CacheStore *cs = arena_alloc(arena, sizeof(CacheStore));
+    int cacheable = lib_cache_key(dep, &dep_cfg, cc, defines, mode_flags,
+                                  lib_inc.data, pkg_dir, config_file, arena,
+                                  fw, cs->key) == 0;
+
+    /* the key needs the lib's config, but only a miss needs its sources.
+     * consumers read its include flags and ldflags from that config too,
+     * so the cache entry holds nothing but the archive */
+    int rc = 0;
+    if (cacheable && cache_fetch("artifacts", cs->key, "lib.a", dep_a) == 0) {
+        info("Cached", "%s (%s lib)", dep->name, mode);
+    } else {
+        info("Compiling", "%s (%s lib)", dep->name, mode);
+        StrList lib_srcs;
+        strlist_init(&lib_srcs, arena);
+        if (dep_cfg.source_count > 0) {
+            for (int j = 0; j < dep_cfg.source_count; j++)
+                strlist_push(&lib_srcs, arena_printf(arena, "%s/%s", base,
+                                                     dep_cfg.sources[j]));
+        } else {
+            const char *src_dir = arena_printf(arena, "%s/src", base);
+            fs_collect_sources(fs_exists(src_dir) ? src_dir : base,
+                               &lib_srcs);
+        }
 
-    /* add generated source include path */
-    if (fs_exists(gen_dir)) {
-        int ioff = (int)strlen(includes);
-        snprintf(includes + ioff, sizeof(includes) - ioff, "-I%s ", gen_dir);
+        const char *prefix = arena_printf(arena, "%s %s %s %s", cc->cc,
+                                          cc->cflags, defines, mode_flags);
+        StrList objs;
+        strlist_init(&objs, arena);
+        int first = sched_size(s);
+        for (int i = 0; i < lib_srcs.count && rc == 0; i++) {
+            const char *obj = object_path(arena, dep_obj_dir,
+                                          lib_srcs.items[i], base);
+            strlist_push(&objs, obj);
+            if (queue_compile(s, prefix, lib_inc.data, lib_srcs.items[i],
+                              obj, arena) < 0)
+                rc = -1;
+        }
+        int ar = rc == 0 ? queue_archive(s, dep_a, dep_obj_dir, &objs, first)
+                         : -1;
+        if (ar < 0) rc = -1;
+
+        if (rc == 0 && cacheable) {
+            cs->archive = dep_a;
+            int store = sched_fn(s, cache_store_job, cs, 0);
+            if (store < 0 || sched_after(s, store, ar) != 0)
+                rc = -1;
+        }
     }
+    config_free(&dep_cfg);
+    strbuf_free(&lib_inc);
+    if (rc != 0) return -1;
 
-    /* collect package -D defines */
-    char pkg_defines[2048] = {0};
-    collect_pkg_defines(cfg, pkg_dir, config_file, pkg_defines,
-                        sizeof(pkg_defines), fw);
-
-    /* mode flags */
-    const char *mode_flags = release ? "-O2 -DNDEBUG" : "-g -DDEBUG";
+    strlist_push(lib_archives, dep_a);
+    return 0;
+}
 
-    /* library mode: compile own sources to objects, archive to lib<name>.a */
-    if (strcmp(cfg->type, "lib") == 0) {
-        char obj_dir[512];
-        snprintf(obj_dir, sizeof(obj_dir), "%s/obj", out_dir);
+/* the pipelined part of a `goose build`: project sources compiled while
+ * packages were still being fetched, and lib dependencies archived as they
+ * landed. both assume no package adds -D defines; c_build uses them only
+ * if that held and no package header shadows what a source included */
+static struct {
+    int active;
+    int release;
+    CConfig cc;
+    Arena *arena;
+    StrList srcs;      /* sources compiled ahead of packages */
+    StrList objs;      /* their objects */
+    StrList sys_names; /* per source: headers found in system dirs, '\n'-joined */
+    StrList libs;      /* lib dependencies archived as they landed */
+    /* where the objects go, apart from obj/, and the flags they compile
+     * with: only the project's include dirs */
+    const char *obj_dir;
+    char key[SHA256_HEX_LEN];
+} pipeline;
+
+static void pipeline_reset(void) {
+    if (pipeline.arena) arena_destroy(pipeline.arena);
+    memset(&pipeline, 0, sizeof(pipeline));
+}
 
-        char out_a[512];
-        snprintf(out_a, sizeof(out_a), "%s/lib%s.a", out_dir, cfg->name);
+/* directories the compiler searches for headers of its own, as listed by
+ * the preprocessor's -v output */
+static void system_include_dirs(const CConfig *cc, StrList *out) {
+    char cmd[512];
+    snprintf(cmd, sizeof(cmd),
+             "%s %s -E -Wp,-v -x c /dev/null 2>&1 >/dev/null",
+             cc->cc, cc->cflags);
+    FILE *p = popen(cmd, "r");
+    if (!p) return;
+
+    char line[1024];
+    int in_list = 0;
+    while (fgets(line, sizeof(line), p)) {
+        line[strcspn(line, "\n")] = '\0';
+        if (strstr(line, "search starts here:")) {
+            in_list = 1;
+        } else if (strncmp(line, "End of search list", 18) == 0) {
+            in_list = 0;
+        } else if (in_list && line[0] == ' ') {
+            char *dir = line + 1;
+            char *fw_note = strstr(dir, " (framework directory)");
+            if (fw_note) *fw_note = '\0';
+            strlist_push(out, dir);
+        }
+    }
+    pclose(p);
+}
 
-        info("Compiling", "%s (%s lib)", cfg->name,
-             release ? "release" : "debug");
-        if (archive_objects(cc->cc, cc->cflags, pkg_defines, mode_flags,
-                            includes, src_files, src_count,
-                            obj_dir, out_a) != 0)
-            return -1;
+enum { HDR_MISSING, HDR_PROJECT, HDR_SYSTEM };
 
-        info("Finished", "%s", out_a);
-        return 0;
+static int find_header(const char *from, const char *name, int quoted,
+                       const StrList *dirs, const StrList *sys_dirs,
+                       char *found, int foundsz) {
+    if (quoted) {
+        const char *slash = strrchr(from, '/');
+        int dlen = slash ? (int)(slash - from) : 1;
+        snprintf(found, foundsz, "%.*s/%s", dlen, slash ? from : ".", name);
+        if (fs_exists(found)) return HDR_PROJECT;
     }
+    for (int i = 0; i < dirs->count; i++) {
+        snprintf(found, foundsz, "%s/%s", dirs->items[i], name);
+        if (fs_exists(found)) return HDR_PROJECT;
+    }
+    for (int i = 0; i < sys_dirs->count; i++) {
+        snprintf(found, foundsz, "%s/%s", sys_dirs->items[i], name);
+        if (fs_exists(found)) return HDR_SYSTEM;
+    }
+    return HDR_MISSING;
+}
 
-    /* binary mode: gather package sources, but build any lib dependency as a
-     * static archive and link it instead of compiling its sources directly */
-    char pkg_files[MAX_SRC_FILES][512];
-    int pkg_count = 0;
-    char lib_archives[MAX_DEPS][512];
-    int lib_archive_count = 0;
-
-    for (int i = 0; i < cfg->dep_count; i++) {
-        if (dep_is_lib(&cfg->deps[i], pkg_dir, config_file, fw)) {
-            char base[512];
-            build_dep_base(&cfg->deps[i], pkg_dir, base, sizeof(base));
-
-            /* load the lib's own config to find its sources */
-            char dep_cfg_path[512];
-            snprintf(dep_cfg_path, sizeof(dep_cfg_path), "%s/%s",
-                     base, config_file);
-            Config dep_cfg;
-            if (config_load(dep_cfg_path, &dep_cfg, fw) != 0) {
-                err("cannot load lib config: %s", dep_cfg_path);
-                return -1;
-            }
+/* follow file's #include lines through the project's own headers. returns
+ * 0 when every header resolves in the project or the compiler's system
+ * dirs, appending the system ones to sys_names. returns -1 at the first
+ * header found nowhere (it can only come from a package still on its way)
+ * or an include computed by a macro */
+static int scan_includes(const char *file, const StrList *dirs,
+                         const StrList *sys_dirs, StrList *seen,
+                         StrBuf *sys_names) {
+    if (strlist_contains(seen, file)) return 0;
+    strlist_push(seen, file);
+
+    FILE *f = fopen(file, "r");
+    if (!f) return -1;
+
+    char line[4096];
+    int rc = 0;
+    while (rc == 0 && fgets(line, sizeof(line), f)) {
+        char *p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p++ != '#') continue;
+        while (*p == ' ' || *p == '\t') p++;
+        if (strncmp(p, "include", 7) != 0 || isalnum((unsigned char)p[7]) ||
+            p[7] == '_')
+            continue;
+        p += 7;
+        while (*p == ' ' || *p == '\t') p++;
+
+        char close = *p == '"' ? '"' : *p == '<' ? '>' : 0;
+        char *end = close ? strchr(p + 1, close) : NULL;
+        if (!end) {
+            rc = -1;
+            break;
+        }
+        *end = '\0';
+
+        char found[2048];
+        switch (find_header(file, p + 1, close == '"', dirs, sys_dirs,
+                            found, sizeof(found))) {
+        case HDR_PROJECT:
+            rc = scan_includes(found, dirs, sys_dirs, seen, sys_names);
+            break;
+        case HDR_SYSTEM:
+            strbuf_printf(sys_names, "%s\n", p + 1);
+            break;
+        default:
+            rc = -1;
+        }
+    }
+    fclose(f);
+    return rc;
+}
 
-            /* collect the lib's sources (explicit list or src/ scan) */
-            char lib_srcs[MAX_SRC_FILES][512];
-            int lib_src_count = 0;
-            if (dep_cfg.source_count > 0) {
-                for (int j = 0; j < dep_cfg.source_count; j++)
-                    snprintf(lib_srcs[lib_src_count++], 512, "%s/%s",
-                             base, dep_cfg.sources[j]);
-            } else {
-                char lib_src_dir[512];
-                snprintf(lib_src_dir, sizeof(lib_src_dir), "%s/src", base);
-                if (!fs_exists(lib_src_dir))
-                    snprintf(lib_src_dir, sizeof(lib_src_dir), "%s", base);
-                fs_collect_sources(lib_src_dir, lib_srcs, MAX_SRC_FILES,
-                                   &lib_src_count);
+/* the object of a source compiled ahead of packages, if it can be linked
+ * as is: none of the system headers it included is shadowed by a
+ * package's. NULL otherwise */
+static const char *pipelined_object(const char *src, const StrList *pkg_inc) {
+    for (int i = 0; i < pipeline.srcs.count; i++) {
+        if (strcmp(pipeline.srcs.items[i], src) != 0) continue;
+
+        char names[8192];
+        snprintf(names, sizeof(names), "%s", pipeline.sys_names.items[i]);
+        for (char *n = strtok(names, "\n"); n; n = strtok(NULL, "\n")) {
+            for (int d = 0; d < pkg_inc->count; d++) {
+                char path[2048];
+                snprintf(path, sizeof(path), "%s/%s", pkg_inc->items[d], n);
+                if (fs_exists(path)) return NULL;
             }
-
-            /* the lib's include flags (its public headers) */
-            char lib_inc[2048];
-            build_include_flags(&dep_cfg, pkg_dir, config_file, lib_inc,
-                                sizeof(lib_inc), fw);
-            int lioff = (int)strlen(lib_inc);
-            for (int j = 0; j < dep_cfg.include_count; j++)
-                lioff += snprintf(lib_inc + lioff, sizeof(lib_inc) - lioff,
-                                  "-I%s/%s ", base, dep_cfg.includes[j]);
-
-            char dep_obj_dir[512];
-            snprintf(dep_obj_dir, sizeof(dep_obj_dir), "%s/deps/%s",
-                     out_dir, cfg->deps[i].name);
-            char dep_a[512];
-            snprintf(dep_a, sizeof(dep_a), "%s/lib%s.a",
-                     out_dir, cfg->deps[i].name);
-
-            info("Compiling", "%s (%s lib)", cfg->deps[i].name,
-                 release ? "release" : "debug");
-            if (archive_objects(cc->cc, cc->cflags, pkg_defines, mode_flags,
-                                lib_inc, lib_srcs, lib_src_count,
-                                dep_obj_dir, dep_a) != 0)
-                return -1;
-
-            strncpy(lib_archives[lib_archive_count++], dep_a, 511);
-        } else {
-            /* non-lib dep: compile its sources straight in */
-            char one_dep_files[MAX_SRC_FILES][512];
-            int one_count = 0;
-            Config single;
-            memset(&single, 0, sizeof(single));
-            single.deps[0] = cfg->deps[i];
-            single.dep_count = 1;
-            strncpy(single.src_dir, cfg->src_dir, MAX_PATH_LEN - 1);
-            build_collect_pkg_sources(&single, pkg_dir, config_file,
-                                      one_dep_files, MAX_SRC_FILES,
-                                      &one_count, fw);
-            for (int j = 0; j < one_count && pkg_count < MAX_SRC_FILES; j++)
-                strncpy(pkg_files[pkg_count++], one_dep_files[j], 511);
         }
+        return pipeline.objs.items[i];
     }
+    return NULL;
+}
 
-    char cmd[16384];
-    int off = snprintf(cmd, sizeof(cmd), "%s %s %s %s %s ",
-                       cc->cc, cc->cflags, pkg_defines, mode_flags, includes);
+/* the package include directories of cfg, one per entry */
+static void pkg_include_dirs(const Config *cfg, const char *pkg_dir,
+                             const char *config_file, StrList *out,
+                             GooseFramework *fw) {
+    Config deps_only = *cfg;
+    deps_only.include_count = 0;
+
+    StrBuf flags;
+    strbuf_init(&flags);
+    build_include_flags(&deps_only, pkg_dir, config_file, &flags, fw);
+    char *save = NULL;
+    for (char *tok = strtok_r(flags.data, " ", &save); tok;
+         tok = strtok_r(NULL, " ", &save))
+        if (strncmp(tok, "-I", 2) == 0)
+            strlist_push(out, tok + 2);
+    strbuf_free(&flags);
+}
 
-    for (int i = 0; i < src_count; i++)
-        off += snprintf(cmd + off, sizeof(cmd) - off, "'%s' ", src_files[i]);
+/* queue every project source whose headers are all on disk already, so it
+ * compiles while dependencies are fetched */
+int c_schedule(const Config *cfg, int release, const char *build_dir,
+               const char *pkg_dir, const char *config_file, Sched *s,
+               void *userdata) {
+    (void)pkg_dir; (void)config_file;
+    GooseFramework *fw = (GooseFramework *)userdata;
 
-    for (int i = 0; i < pkg_count; i++)
-        off += snprintf(cmd + off, sizeof(cmd) - off, "'%s' ", pkg_files[i]);
+    pipeline_reset();
+    pipeline.active = 1;
+    pipeline.release = release;
+    pipeline.cc = *(CConfig *)fw->custom_data;
+    pipeline.arena = arena_new();
+    Arena *arena = pipeline.arena;
+    strlist_init(&pipeline.srcs, arena);
+    strlist_init(&pipeline.objs, arena);
+    strlist_init(&pipeline.sys_names, arena);
+    strlist_init(&pipeline.libs, arena);
+
+    /* nothing to overlap with; c_build compiles in parallel anyway */
+    if (cfg->dep_count == 0) return 0;
+
+    StrList srcs, dirs, sys_dirs;
+    strlist_init(&srcs, arena);
+    strlist_init(&dirs, arena);
+    strlist_init(&sys_dirs, arena);
+    fs_collect_sources(cfg->src_dir, &srcs);
+
+    StrBuf includes;
+    strbuf_init(&includes);
+    for (int i = 0; i < cfg->include_count; i++) {
+        strlist_push(&dirs, cfg->includes[i]);
+        strbuf_printf(&includes, "-I%s ", cfg->includes[i]);
+    }
 
-    /* link any built lib archives */
-    for (int i = 0; i < lib_archive_count; i++)
-        off += snprintf(cmd + off, sizeof(cmd) - off, "'%s' ", lib_archives[i]);
+    char gen_dir[1024];
+    snprintf(gen_dir, sizeof(gen_dir), "%s/gen", build_dir);
+    if (fs_exists(gen_dir)) {
+        fs_collect_sources(gen_dir, &srcs);
+        strlist_push(&dirs, gen_dir);
+        strbuf_printf(&includes, "-I%s ", gen_dir);
+    }
+    system_include_dirs(&pipeline.cc, &sys_dirs);
 
-    char output[512];
-    snprintf(output, sizeof(output), "%s/%s", out_dir, cfg->name);
-    off += snprintf(cmd + off, sizeof(cmd) - off, "-o '%s'", output);
+    const char *mode_flags = release ? "-O2 -DNDEBUG" : "-g -DDEBUG";
+    const char *prefix = arena_printf(arena, "%s %s  %s", pipeline.cc.cc,
+                                      pipeline.cc.cflags, mode_flags);
+    const char *obj_dir = arena_printf(arena, "%s/%s/obj-ahead", build_dir,
+                                       release ? "release" : "debug");
+    pipeline.obj_dir = obj_dir;
+    flags_key(prefix, includes.data, pipeline.key);
+
+    int rc = 0;
+    for (int i = 0; i < srcs.count && rc == 0; i++) {
+        StrList seen;
+        StrBuf names;
+        strlist_init(&seen, arena);
+        strbuf_init(&names);
+        if (scan_includes(srcs.items[i], &dirs, &sys_dirs, &seen, &names) == 0) {
+            const char *obj = object_path(arena, obj_dir, srcs.items[i], NULL);
+            if (queue_compile(s, prefix, includes.data, srcs.items[i], obj,
+                              arena) < 0) {
+                rc = -1;
+            } else {
+                strlist_push(&pipeline.srcs, srcs.items[i]);
+                strlist_push(&pipeline.objs, obj);
+                strlist_push(&pipeline.sys_names, names.data);
+            }
+        }
+        strbuf_free(&names);
+    }
+    strbuf_free(&includes);
 
-    /* project ldflags */
-    char all_ldflags[1024] = {0};
-    if (strlen(cc->ldflags) > 0)
-        strncpy(all_ldflags, cc->ldflags, sizeof(all_ldflags) - 1);
+    if (pipeline.srcs.count > 0)
+        info("Compiling", "%d of %d sources ahead of dependencies",
+             pipeline.srcs.count, srcs.count);
+    return rc;
+}
 
-    /* package ldflags */
-    collect_pkg_ldflags(cfg, pkg_dir, config_file, all_ldflags,
-                        sizeof(all_ldflags), fw);
+/* queue a lib dependency's archive as soon as it and its own dependencies
+ * are on disk */
+int c_pkg_ready(const Config *cfg, const Dependency *dep, int release,
+                const char *build_dir, const char *pkg_dir,
+                const char *config_file, Sched *s, void *userdata) {
+    GooseFramework *fw = (GooseFramework *)userdata;
+    if (!pipeline.active || strcmp(cfg->type, "lib") == 0) return 0;
+    if (!dep_is_lib(dep, pkg_dir, config_file, fw)) return 0;
 
-    if (strlen(all_ldflags) > 0)
-        off += snprintf(cmd + off, sizeof(cmd) - off, " %s", all_ldflags);
+    const char *out_dir = arena_printf(pipeline.arena, "%s/%s", build_dir,
+                                       release ? "release" : "debug");
+    fs_mkdir_p(out_dir);
 
-    info("Compiling", "%s (%s)", cfg->name, release ? "release" : "debug");
-    fflush(stdout);
-    int ret = system(cmd);
-    if (ret != 0) {
-        err("compilation failed");
+    StrList archives;
+    strlist_init(&archives, pipeline.arena);
+    const char *mode_flags = release ? "-O2 -DNDEBUG" : "-g -DDEBUG";
+    if (queue_lib_dep(s, dep, &pipeline.cc, "", mode_flags, release, out_dir,
+                      pkg_dir, config_file, pipeline.arena, &archives,
+                      fw) != 0)
         return -1;
-    }
-
-    info("Finished", "%s", output);
+    strlist_push(&pipeline.libs, dep->name);
     return 0;
 }
 
-int c_test(const Config *cfg, int release, const char *build_dir,
-           const char *pkg_dir, const char *config_file, const char *test_dir,
-           void *userdata) {
-    GooseFramework *fw = (GooseFramework *)userdata;
-    CConfig *cc = (CConfig *)fw->custom_data;
-
-    if (!fs_exists(test_dir)) {
-        err("no %s/ directory found", test_dir);
-        return 1;
+/* package objects already built for earlier members of this workspace
+ * build; they outlive a single c_build */
+static struct {
+    Arena *arena;
+    StrList objs;
+} shared;
+
+/* where a workspace member compiles the sources of fetched packages: the
+ * root's build directory, keyed by the flags they compile with. they get
+ * only the packages' include dirs, so members built the same way share
+ * one object per source. NULL outside a workspace */
+static const char *shared_obj_dir(const Config *cfg, const char *prefix,
+                                  int release, const char *pkg_dir,
+                                  const char *config_file, StrBuf *includes,
+                                  Arena *arena, GooseFramework *fw) {
+    if (!fw->shared_build_dir[0]) return NULL;
+
+    Config fetched;
+    memset(&fetched, 0, sizeof(fetched));
+    fetched.deps = arena_alloc(arena, (cfg->dep_count + 1) * sizeof(Dependency));
+    for (int i = 0; i < cfg->dep_count; i++)
+        if (!cfg->deps[i].path[0])
+            fetched.deps[fetched.dep_count++] = cfg->deps[i];
+    build_include_flags(&fetched, pkg_dir, config_file, includes, fw);
+
+    Sha256 ctx;
+    char key[SHA256_HEX_LEN];
+    sha256_init(&ctx);
+    cache_key_field(&ctx, prefix);
+    cache_key_field(&ctx, includes->data);
+    sha256_final_hex(&ctx, key);
+
+    if (!shared.arena) {
+        shared.arena = arena_new();
+        strlist_init(&shared.objs, shared.arena);
     }
+    return arena_printf(arena, "%s/%s/pkg/%.16s", fw->shared_build_dir,
+                        release ? "release" : "debug", key);
+}
 
-    /* collect test files */
-    char test_files[MAX_SRC_FILES][512];
-    int test_count = 0;
-    fs_collect_sources(test_dir, test_files, MAX_SRC_FILES, &test_count);
-
-    if (test_count == 0) {
-        warn("Test", "no test files found in %s/", test_dir);
-        return 0;
-    }
+/* record what a finished build compiled with: obj_dir with every include
+ * dir, and the pipeline's directory with the ones it compiled ahead with */
+static void record_flags(const char *obj_dir, const char *prefix,
+                         const char *includes, int pipelined) {
+    char key[SHA256_HEX_LEN];
+    flags_key(prefix, includes, key);
+    flags_write(obj_dir, key);
+    if (pipelined && pipeline.srcs.count > 0)
+        flags_write(pipeline.obj_dir, pipeline.key);
+}
 
-    if (build_transpile(cfg, build_dir) != 0)
-        return 1;
+static int c_build_with(const Config *cfg, const CConfig *cc, int release,
+                        const char *build_dir, const char *pkg_dir,
+                        const char *config_file, Arena *arena,
+                        GooseFramework *fw) {
+    char out_dir[512];
+    snprintf(out_dir, sizeof(out_dir), "%s/%s",
+             build_dir, release ? "release" : "debug");
+    fs_mkdir(build_dir);
+    fs_mkdir(out_dir);
 
-    /* collect project sources (excluding main.c) */
-    char src_files[MAX_SRC_FILES][512];
-    int src_count = 0;
-    fs_collect_sources(cfg->src_dir, src_files, MAX_SRC_FILES, &src_count);
+    StrList src_files;
+    strlist_init(&src_files, arena);
+    fs_collect_sources(cfg->src_dir, &src_files);
 
     /* collect generated sources */
-    char gen_dir[512];
+    char gen_dir[1024];
     snprintf(gen_dir, sizeof(gen_dir), "%s/gen", build_dir);
-    int has_gen = fs_exists(gen_dir);
-    if (has_gen) {
-        int gen_count = 0;
-        fs_collect_sources(gen_dir, src_files + src_count,
-                           MAX_SRC_FILES - src_count, &gen_count);
-        src_count += gen_count;
+    if (fs_exists(gen_dir))
+        fs_collect_sources(gen_dir, &src_files);
+
+    if (src_files.count == 0) {
+        err("no source files found in %s/", cfg->src_dir);
+        return -1;
     }
 
-    /* collect package sources */
-    char pkg_files[MAX_SRC_FILES][512];
-    int pkg_count = 0;
-    build_collect_pkg_sources(cfg, pkg_dir, config_file, pkg_files,
-                              MAX_SRC_FILES, &pkg_count, fw);
-
-    info("Testing", "%s v%s", cfg->name, cfg->version);
-
-    int passed = 0, failed = 0;
-
-    for (int t = 0; t < test_count; t++) {
-        /* derive test name from file */
-        const char *fname = strrchr(test_files[t], '/');
-        fname = fname ? fname + 1 : test_files[t];
-        char tname[128];
-        strncpy(tname, fname, 127);
-        char *dot = strrchr(tname, '.');
-        if (dot) *dot = '\0';
-
-        char tout_dir[512];
-        snprintf(tout_dir, sizeof(tout_dir), "%s/test", build_dir);
-        fs_mkdir(build_dir);
-        fs_mkdir(tout_dir);
-
-        char bin[512];
-        snprintf(bin, sizeof(bin), "%s/%s", tout_dir, tname);
-
-        /* compile: test file + project sources (skip main.c) + pkg sources */
-        char cmd[8192];
-        const char *mode_flags = release ? "-O2 -DNDEBUG" : "-g -DDEBUG";
-        int off = snprintf(cmd, sizeof(cmd), "%s %s %s ",
-                           cc->cc, cc->cflags, mode_flags);
-
-        /* project includes */
-        for (int i = 0; i < cfg->include_count; i++)
-            off += snprintf(cmd + off, sizeof(cmd) - off, "-I%s ",
-                            cfg->includes[i]);
-
-        /* package include paths */
-        for (int i = 0; i < cfg->dep_count; i++) {
-            char base[512];
-            build_dep_base(&cfg->deps[i], pkg_dir, base, sizeof(base));
-            char pcfg[512];
-            snprintf(pcfg, sizeof(pcfg), "%s/%s", base, config_file);
-            if (fs_exists(pcfg)) {
-                Config pkg_cfg;
-                if (config_load(pcfg, &pkg_cfg, fw) == 0) {
-                    for (int j = 0; j < pkg_cfg.include_count; j++) {
-                        char inc[512];
-                        snprintf(inc, sizeof(inc), "%s/%s",
-                                 base, pkg_cfg.includes[j]);
-                        off += snprintf(cmd + off, sizeof(cmd) - off,
-                                        "-I%s ", inc);
-                    }
-                    continue;
-                }
-            }
-            /* fallback */
-            char inc[512];
-            snprintf(inc, sizeof(inc), "%s/src", base);
-            if (fs_exists(inc))
-                off += snprintf(cmd + off, sizeof(cmd) - off, "-I%s ", inc);
-            off += snprintf(cmd + off, sizeof(cmd) - off, "-I%s ", base);
-        }
+    StrBuf includes, pkg_defines;
+    strbuf_init(&includes);
+    strbuf_init(&pkg_defines);
+    build_include_flags(cfg, pkg_dir, config_file, &includes, fw);
 
-        /* generated source include path */
-        if (has_gen)
-            off += snprintf(cmd + off, sizeof(cmd) - off, "-I%s ", gen_dir);
+    /* add generated source include path */
+    if (fs_exists(gen_dir))
+        strbuf_printf(&includes, "-I%s ", gen_dir);
 
-        /* test file itself */
-        off += snprintf(cmd + off, sizeof(cmd) - off, "'%s' ", test_files[t]);
+    /* collect package -D defines */
+    collect_pkg_defines(cfg, pkg_dir, config_file, &pkg_defines, fw);
 
-        /* project .c files except main.c */
-        for (int i = 0; i < src_count; i++) {
-            const char *base = strrchr(src_files[i], '/');
-            base = base ? base + 1 : src_files[i];
-            if (strcmp(base, "main.c") == 0) continue;
-            off += snprintf(cmd + off, sizeof(cmd) - off, "'%s' ", src_files[i]);
-        }
+    /* what the pipeline built ahead holds only without package defines */
+    int pipelined = pipeline.active && pipeline.release == release &&
+                    pkg_defines.len == 0;
+    StrList pkg_inc;
+    strlist_init(&pkg_inc, arena);
+    if (pipelined)
+        pkg_include_dirs(cfg, pkg_dir, config_file, &pkg_inc, fw);
 
-        /* package .c files */
-        for (int i = 0; i < pkg_count; i++)
-            off += snprintf(cmd + off, sizeof(cmd) - off, "'%s' ", pkg_files[i]);
-
-        off += snprintf(cmd + off, sizeof(cmd) - off, "-o '%s'", bin);
-
-        /* ldflags */
-        if (strlen(cc->ldflags) > 0)
-            off += snprintf(cmd + off, sizeof(cmd) - off, " %s", cc->ldflags);
-        for (int pi = 0; pi < cfg->dep_count; pi++) {
-            char base[512];
-            build_dep_base(&cfg->deps[pi], pkg_dir, base, sizeof(base));
-            char plp[512];
-            snprintf(plp, sizeof(plp), "%s/%s", base, config_file);
-            if (!fs_exists(plp)) continue;
-            Config pc;
-            if (config_load(plp, &pc, fw) == 0) {
-                CConfig *pcc = (CConfig *)fw->custom_data;
-                if (strlen(pcc->ldflags) > 0)
-                    off += snprintf(cmd + off, sizeof(cmd) - off,
-                                    " %s", pcc->ldflags);
+    /* mode flags */
+    const char *mode_flags = release ? "-O2 -DNDEBUG" : "-g -DDEBUG";
+    const char *prefix = compile_prefix(cc, pkg_defines.data, release, arena);
+    char obj_dir[1024];
+    snprintf(obj_dir, sizeof(obj_dir), "%s/obj", out_dir);
+
+    Sched *s = sched_new(fw->jobs);
+    StrList objs, pkg_files, lib_archives, shared_new;
+    StrBuf shared_inc;
+    strbuf_init(&shared_inc);
+    strlist_init(&shared_new, arena);
+    strlist_init(&objs, arena);
+    strlist_init(&pkg_files, arena);
+    strlist_init(&lib_archives, arena);
+    StrBuf args, suffix, all_ldflags;
+    strbuf_init(&args);
+    strbuf_init(&suffix);
+    strbuf_init(&all_ldflags);
+    int rc = -1;
+    int is_lib = strcmp(cfg->type, "lib") == 0;
+    if (!s) goto done;
+
+    /* binary mode: build any lib dependency as a static archive and link
+     * it; other packages have their sources compiled straight in */
+    for (int i = 0; i < cfg->dep_count && !is_lib; i++) {
+        if (dep_is_lib(&cfg->deps[i], pkg_dir, config_file, fw)) {
+            if (pipelined &&
+                strlist_contains(&pipeline.libs, cfg->deps[i].name)) {
+                strlist_push(&lib_archives, arena_printf(arena, "%s/lib%s.a",
+                             out_dir, cfg->deps[i].name));
+            } else if (queue_lib_dep(s, &cfg->deps[i], cc, pkg_defines.data,
+                                     mode_flags, release, out_dir, pkg_dir,
+                                     config_file, arena, &lib_archives,
+                                     fw) != 0) {
+                goto done;
             }
+        } else {
+            Config single;
+            memset(&single, 0, sizeof(single));
+            single.deps = &cfg->deps[i];
+            single.dep_count = 1;
+            single.src_dir = cfg->src_dir;
+            build_collect_pkg_sources(&single, pkg_dir, config_file,
+                                      &pkg_files, fw);
         }
+    }
 
-        /* compile */
-        fflush(stdout);
-        if (system(cmd) != 0) {
-            cprintf(CLR_RED, "      FAIL ");
-            printf("%s (compile error)\n", tname);
-            failed++;
+    info("Compiling", "%s (%s%s)", cfg->name,
+         release ? "release" : "debug", is_lib ? " lib" : "");
+
+    size_t pkg_len = strlen(pkg_dir);
+    int reused = 0;
+    const char *shared_dir = pkg_files.count > 0
+        ? shared_obj_dir(cfg, prefix, release, pkg_dir, config_file,
+                         &shared_inc, arena, fw)
+        : NULL;
+
+    int first = sched_size(s);
+    for (int i = 0; i < src_files.count + pkg_files.count; i++) {
+        const char *src = i < src_files.count
+                        ? src_files.items[i]
+                        : pkg_files.items[i - src_files.count];
+        if (shared_dir && i >= src_files.count &&
+            strncmp(src, pkg_dir, pkg_len) == 0 && src[pkg_len] == '/') {
+            const char *obj = object_path(arena, shared_dir, src, pkg_dir);
+            if (strlist_contains(&shared.objs, obj)) {
+                reused++;
+            } else {
+                if (queue_compile(s, prefix, shared_inc.data, src, obj,
+                                  arena) < 0)
+                    goto done;
+                strlist_push(&shared_new, obj);
+            }
+            strlist_push(&objs, obj);
             continue;
         }
-
-        /* run */
-        char runcmd[1024];
-        snprintf(runcmd, sizeof(runcmd), "'%s' 2>&1", bin);
-        int ret = system(runcmd);
-        if (ret == 0) {
-            cprintf(CLR_GREEN, "      PASS ");
-            printf("%s\n", tname);
-            passed++;
+        const char *obj = pipelined ? pipelined_object(src, &pkg_inc) : NULL;
+        if (obj) {
+            /* an object of an earlier build there would pass for this
+             * one's under the new flags of obj/ */
+            remove(object_path(arena, obj_dir, src, NULL));
         } else {
-            cprintf(CLR_RED, "      FAIL ");
-            printf("%s (exit %d)\n", tname, ret);
-            failed++;
+            obj = object_path(arena, obj_dir, src, NULL);
+            if (queue_compile(s, prefix, includes.data, src, obj, arena) < 0)
+                goto done;
         }
+        strlist_push(&objs, obj);
     }
 
-    printf("\n");
-    info("Results", "%d passed, %d failed, %d total",
-         passed, failed, passed + failed);
+    /* library mode: archive own objects to lib<name>.a */
+    if (is_lib) {
+        char out_a[1024];
+        snprintf(out_a, sizeof(out_a), "%s/lib%s.a", out_dir, cfg->name);
+        if (queue_archive(s, out_a, obj_dir, &objs, first) < 0 ||
+            sched_run(s) != 0)
+            goto done;
+        record_flags(obj_dir, prefix, includes.data, pipelined);
+        info("Finished", "%s", out_a);
+        rc = 0;
+        goto done;
+    }
+
+    if (sched_run(s) != 0)
+        goto done;
+    record_flags(obj_dir, prefix, includes.data, pipelined);
+    for (int i = 0; i < shared_new.count; i++)
+        strlist_push(&shared.objs, shared_new.items[i]);
+    if (reused > 0)
+        info("Reusing", "%d package object%s from earlier members", reused,
+             reused == 1 ? "" : "s");
+
+    for (int i = 0; i < objs.count; i++)
+        strbuf_printf(&args, "'%s' ", objs.items[i]);
+
+    /* link any built lib archives. deps arrive dependencies-first, and a
+     * static archive must follow the archives that reference it */
+    for (int i = lib_archives.count - 1; i >= 0; i--)
+        strbuf_printf(&args, "'%s' ", lib_archives.items[i]);
+
+    char output[1024], rsp[1024];
+    snprintf(output, sizeof(output), "%s/%s", out_dir, cfg->name);
+    snprintf(rsp, sizeof(rsp), "%s/%s.rsp", out_dir, cfg->name);
+    strbuf_printf(&suffix, "-o '%s'", output);
+
+    /* project ldflags, then package ldflags */
+    strbuf_printf(&all_ldflags, "%s", cc->ldflags);
+    collect_pkg_ldflags(cfg, pkg_dir, config_file, &all_ldflags, fw);
+
+    if (all_ldflags.len > 0)
+        strbuf_printf(&suffix, " %s", all_ldflags.data);
+
+    if (build_run(prefix, args.data, suffix.data, rsp) != 0) {
+        err("link failed: %s", output);
+        goto done;
+    }
+
+    info("Finished", "%s", output);
+    rc = 0;
+
+done:
+    sched_free(s);
+    strbuf_free(&args);
+    strbuf_free(&suffix);
+    strbuf_free(&all_ldflags);
+    strbuf_free(&includes);
+    strbuf_free(&pkg_defines);
+    strbuf_free(&shared_inc);
+    return rc;
+}
+
+int c_build(const Config *cfg, int release, const char *build_dir,
+            const char *pkg_dir, const char *config_file, void *userdata) {
+    /* get framework from userdata to access custom_data. loading a package
+     * config overwrites custom_data, so keep the project's settings aside */
+    GooseFramework *fw = (GooseFramework *)userdata;
+    CConfig cc = *(CConfig *)fw->custom_data;
+
+    Arena *arena = arena_new();
+    int rc = c_build_with(cfg, &cc, release, build_dir, pkg_dir,
+                          config_file, arena, fw);
+    arena_destroy(arena);
+    pipeline_reset();
 
-    return failed > 0 ? 1 : 0;
+    *(CConfig *)fw->custom_data = cc;
+    return rc;
 }
 
 int c_run(const Config *cfg, int release, const char *build_dir,
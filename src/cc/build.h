@@ -0,0 +1,43 @@
+#ifndef GOOSE_CC_BUILD_H
+#define GOOSE_CC_BUILD_H
+
+#include "config.h"
+#include "../headers/config.h"
+#include "../headers/framework.h"
+#include "../headers/sched.h"
+#include "../headers/sha256.h"
+
+/* what goose test and goose bench take from the build driver, so
+ * their objects are built the way goose build builds them */
+
+/* object file for src under obj_dir, its path mirrored below it */
+const char *object_path(Arena *arena, const char *obj_dir,
+                        const char *src, const char *base);
+
+/* the compiler command every object of a project is built with */
+const char *compile_prefix(const CConfig *cc, const char *pkg_defines,
+                           int release, Arena *arena);
+
+/* the key of the flags a directory's objects were built with, kept in
+ * its "flags" file */
+void flags_key(const char *prefix, const char *includes,
+               char key[SHA256_HEX_LEN]);
+int flags_match(const char *obj_dir, const char *key);
+void flags_write(const char *obj_dir, const char *key);
+
+/* whether obj is newer than everything its depfile lists */
+int object_fresh(const char *obj);
+
+/* queue compiling src into obj. returns the job id, -1 on error */
+int queue_compile(Sched *s, const char *prefix, const char *includes,
+                  const char *src, const char *obj, Arena *arena);
+
+/* -D defines from package cflags */
+void collect_pkg_defines(const Config *cfg, const char *pkg_dir,
+                         const char *config_file, StrBuf *out,
+                         GooseFramework *fw);
+
+/* hash of `cc --version`, computed once per compiler command */
+const char *compiler_id(const char *cc);
+
+#endif
@@ -0,0 +1,520 @@
+#include "harness.h"
+
+/* goose_test.h and goose_bench.h as goose test and goose bench write them
+ * to build/<test|bench>/include. kept as text here so the binary carries
+ * them and needs no install step */
+const char c_test_harness[] =
+    "/* goose_test.h: test cases for goose test. a test file that includes it\n"
+    " * declares cases with TEST(name) instead of main(); goose test links\n"
+    " * all such files into one runner that runs each case in a forked\n"
+    " * worker.\n"
+    " * written by goose test, do not edit */\n"
+    "#ifndef GOOSE_TEST_H\n"
+    "#define GOOSE_TEST_H\n"
+    "\n"
+    "typedef void (*goose_case_fn)(void);\n"
+    "\n"
+    "void goose_test_register(const char *name, const char *file,\n"
+    "                         goose_case_fn fn);\n"
+    "void goose_test_fail(const char *file, int line, const char *expr,\n"
+    "                     int fatal);\n"
+    "\n"
+    "#define TEST(name)                                                \\\n"
+    "    static void goose_case_##name(void);                          \\\n"
+    "    __attribute__((constructor))                                  \\\n"
+    "    static void goose_reg_##name(void) {                          \\\n"
+    "        goose_test_register(#name, __FILE__, goose_case_##name);  \\\n"
+    "    }                                                             \\\n"
+    "    static void goose_case_##name(void)\n"
+    "\n"
+    "/* CHECK reports a failure and goes on; REQUIRE also ends the case */\n"
+    "#define CHECK(cond) \\\n"
+    "    ((cond) ? (void)0 : goose_test_fail(__FILE__, __LINE__, #cond, 0))\n"
+    "#define REQUIRE(cond) \\\n"
+    "    ((cond) ? (void)0 : goose_test_fail(__FILE__, __LINE__, #cond, 1))\n"
+    "\n"
+    "#ifdef GOOSE_TEST_RUNNER\n"
+    "#ifndef _DEFAULT_SOURCE\n"
+    "#define _DEFAULT_SOURCE\n"
+    "#endif\n"
+    "#include <fcntl.h>\n"
+    "#include <fnmatch.h>\n"
+    "#include <signal.h>\n"
+    "#include <stdio.h>\n"
+    "#include <stdlib.h>\n"
+    "#include <string.h>\n"
+    "#include <time.h>\n"
+    "#include <unistd.h>\n"
+    "#include <sys/resource.h>\n"
+    "#include <sys/wait.h>\n"
+    "\n"
+    "typedef struct {\n"
+    "    char name[256];     /* <file stem>.<case> */\n"
+    "    goose_case_fn fn;\n"
+    "    pid_t pid;\n"
+    "    double started;\n"
+    "    double seconds;\n"
+    "    long max_rss;\n"
+    "    int status;\n"
+    "    int timed_out;\n"
+    "} GooseCase;\n"
+    "\n"
+    "static GooseCase *goose_cases;\n"
+    "static int goose_case_count, goose_case_cap;\n"
+    "static int goose_failed;\n"
+    "\n"
+    "void goose_test_register(const char *name, const char *file,\n"
+    "                         goose_case_fn fn) {\n"
+    "    if (goose_case_count == goose_case_cap) {\n"
+    "        goose_case_cap = goose_case_cap ? goose_case_cap * 2 : 64;\n"
+    "        goose_cases = realloc(goose_cases,\n"
+    "                              goose_case_cap * sizeof(GooseCase));\n"
+    "        if (!goose_cases) abort();\n"
+    "    }\n"
+    "    GooseCase *c = &goose_cases[goose_case_count++];\n"
+    "    memset(c, 0, sizeof(*c));\n"
+    "    const char *base = strrchr(file, '/');\n"
+    "    base = base ? base + 1 : file;\n"
+    "    const char *dot = strrchr(base, '.');\n"
+    "    int stem = dot ? (int)(dot - base) : (int)strlen(base);\n"
+    "    snprintf(c->name, sizeof(c->name), \"%.*s.%s\", stem, base, name);\n"
+    "    c->fn = fn;\n"
+    "}\n"
+    "\n"
+    "void goose_test_fail(const char *file, int line, const char *expr,\n"
+    "                     int fatal) {\n"
+    "    fprintf(stderr, \"%s:%d: %s failed: %s\\n\", file, line,\n"
+    "            fatal ? \"REQUIRE\" : \"CHECK\", expr);\n"
+    "    goose_failed = 1;\n"
+    "    if (fatal) {\n"
+    "        fflush(NULL);\n"
+    "        _exit(1);\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "static double goose_now(void) {\n"
+    "    struct timespec ts;\n"
+    "    clock_gettime(CLOCK_MONOTONIC, &ts);\n"
+    "    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;\n"
+    "}\n"
+    "\n"
+    "static int goose_cmp_case(const void *a, const void *b) {\n"
+    "    const GooseCase *x = a, *y = b;\n"
+    "    return strcmp(x->name, y->name);\n"
+    "}\n"
+    "\n"
+    "static unsigned goose_fnv1a(const char *s) {\n"
+    "    unsigned h = 2166136261u;\n"
+    "    for (; *s; s++) h = (h ^ (unsigned char)*s) * 16777619u;\n"
+    "    return h;\n"
+    "}\n"
+    "\n"
+    "/* run one case in a child with its output in dir/<name>.out */\n"
+    "static int goose_spawn(GooseCase *c, const char *dir) {\n"
+    "    char out[1024];\n"
+    "    snprintf(out, sizeof(out), \"%s/%s.out\", dir, c->name);\n"
+    "    fflush(NULL);\n"
+    "    pid_t pid = fork();\n"
+    "    if (pid < 0) return -1;\n"
+    "    if (pid == 0) {\n"
+    "        setpgid(0, 0);\n"
+    "        int fd = open(out, O_WRONLY | O_CREAT | O_TRUNC, 0644);\n"
+    "        if (fd >= 0) {\n"
+    "            dup2(fd, 1);\n"
+    "            dup2(fd, 2);\n"
+    "            close(fd);\n"
+    "        }\n"
+    "        c->fn();\n"
+    "        fflush(NULL);\n"
+    "        _exit(goose_failed ? 1 : 0);\n"
+    "    }\n"
+    "    setpgid(pid, pid);\n"
+    "    c->pid = pid;\n"
+    "    c->started = goose_now();\n"
+    "    return 0;\n"
+    "}\n"
+    "\n"
+    "/* usage: runner [--dir D] [--report F] [-j N] [--filter G]\n"
+    " *               [--shard K/N] [--timeout S] [--list]\n"
+    " * runs the selected cases, -j at a time, and writes one line per\n"
+    " * case to the report: name, pass|fail|timeout, seconds, peak memory\n"
+    " * in KiB and the wait status */\n"
+    "int main(int argc, char **argv) {\n"
+    "    const char *dir = \".\", *report = NULL, *filter = NULL;\n"
+    "    int jobs = 0, shard_k = 0, shard_n = 0, list = 0;\n"
+    "    double timeout = 0;\n"
+    "    for (int i = 1; i < argc; i++) {\n"
+    "        const char *val = i + 1 < argc ? argv[i + 1] : NULL;\n"
+    "        if (strcmp(argv[i], \"--list\") == 0) list = 1;\n"
+    "        else if (!val) break;\n"
+    "        else if (strcmp(argv[i], \"--dir\") == 0) dir = argv[++i];\n"
+    "        else if (strcmp(argv[i], \"--report\") == 0) report = argv[++i];\n"
+    "        else if (strcmp(argv[i], \"--filter\") == 0) filter = argv[++i];\n"
+    "        else if (strcmp(argv[i], \"-j\") == 0) jobs = atoi(argv[++i]);\n"
+    "        else if (strcmp(argv[i], \"--timeout\") == 0)\n"
+    "            timeout = atof(argv[++i]);\n"
+    "        else if (strcmp(argv[i], \"--shard\") == 0 &&\n"
+    "                 sscanf(argv[++i], \"%d/%d\", &shard_k, &shard_n) != 2)\n"
+    "            shard_n = 0;\n"
+    "    }\n"
+    "    if (jobs <= 0) {\n"
+    "        long n = sysconf(_SC_NPROCESSORS_ONLN);\n"
+    "        jobs = n > 0 ? (int)n : 1;\n"
+    "    }\n"
+    "\n"
+    "    /* the cases this run covers, in name order */\n"
+    "    qsort(goose_cases, goose_case_count, sizeof(GooseCase),\n"
+    "          goose_cmp_case);\n"
+    "    int count = 0;\n"
+    "    for (int i = 0; i < goose_case_count; i++) {\n"
+    "        GooseCase *c = &goose_cases[i];\n"
+    "        if (filter && fnmatch(filter, c->name, 0) != 0) continue;\n"
+    "        unsigned h = goose_fnv1a(c->name);\n"
+    "        if (shard_n > 0 && (int)(h % (unsigned)shard_n) != shard_k - 1)\n"
+    "            continue;\n"
+    "        goose_cases[count++] = *c;\n"
+    "    }\n"
+    "    if (list) {\n"
+    "        for (int i = 0; i < count; i++)\n"
+    "            printf(\"%s\\n\", goose_cases[i].name);\n"
+    "        return 0;\n"
+    "    }\n"
+    "\n"
+    "    int next = 0, running = 0, failed = 0;\n"
+    "    while (next < count || running > 0) {\n"
+    "        while (running < jobs && next < count) {\n"
+    "            if (goose_spawn(&goose_cases[next], dir) != 0) return 2;\n"
+    "            next++;\n"
+    "            running++;\n"
+    "        }\n"
+    "\n"
+    "        /* kill what ran too long, then collect what finished */\n"
+    "        double t = goose_now();\n"
+    "        for (int i = 0; timeout > 0 && i < next; i++) {\n"
+    "            GooseCase *c = &goose_cases[i];\n"
+    "            if (c->pid > 0 && !c->timed_out &&\n"
+    "                t - c->started >= timeout) {\n"
+    "                kill(-c->pid, SIGKILL);\n"
+    "                c->timed_out = 1;\n"
+    "            }\n"
+    "        }\n"
+    "        int status;\n"
+    "        struct rusage ru;\n"
+    "        pid_t pid = wait4(-1, &status, timeout > 0 ? WNOHANG : 0, &ru);\n"
+    "        if (pid == 0) {\n"
+    "            struct timespec ts = {0, 5000000};\n"
+    "            nanosleep(&ts, NULL);\n"
+    "            continue;\n"
+    "        }\n"
+    "        if (pid < 0) break;\n"
+    "        for (int i = 0; i < next; i++) {\n"
+    "            GooseCase *c = &goose_cases[i];\n"
+    "            if (c->pid != pid) continue;\n"
+    "            c->pid = 0;\n"
+    "            c->seconds = goose_now() - c->started;\n"
+    "            c->status = status;\n"
+    "#ifdef __APPLE__\n"
+    "            c->max_rss = ru.ru_maxrss / 1024;\n"
+    "#else\n"
+    "            c->max_rss = ru.ru_maxrss;\n"
+    "#endif\n"
+    "            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)\n"
+    "                failed++;\n"
+    "            running--;\n"
+    "            break;\n"
+    "        }\n"
+    "    }\n"
+    "\n"
+    "    FILE *f = report ? fopen(report, \"w\") : stdout;\n"
+    "    if (!f) return 2;\n"
+    "    for (int i = 0; i < count; i++) {\n"
+    "        const GooseCase *c = &goose_cases[i];\n"
+    "        int ok = WIFEXITED(c->status) && WEXITSTATUS(c->status) == 0;\n"
+    "        const char *verdict = c->timed_out ? \"timeout\"\n"
+    "                            : ok           ? \"pass\"\n"
+    "                                           : \"fail\";\n"
+    "        fprintf(f, \"%s\\t%s\\t%.3f\\t%ld\\t%d\\n\", c->name, verdict,\n"
+    "                c->seconds, c->max_rss, c->status);\n"
+    "    }\n"
+    "    if (f != stdout) fclose(f);\n"
+    "    return failed > 0 ? 1 : 0;\n"
+    "}\n"
+    "#endif\n"
+    "\n"
+    "#endif\n";
+
+const char c_bench_harness[] =
+    "/* goose_bench.h: benchmarks for goose bench. a file in benches/ that\n"
+    " * includes it declares each one with BENCH(name), whose body runs the\n"
+    " * code under measurement `iters` times; goose bench links all such\n"
+    " * files into one runner that times every benchmark in turn.\n"
+    " * written by goose bench, do not edit */\n"
+    "#ifndef GOOSE_BENCH_H\n"
+    "#define GOOSE_BENCH_H\n"
+    "\n"
+    "/* the runner needs clock_gettime, before anything includes a header */\n"
+    "#if defined(GOOSE_BENCH_RUNNER) && !defined(_DEFAULT_SOURCE)\n"
+    "#define _DEFAULT_SOURCE\n"
+    "#endif\n"
+    "#include <stdint.h>\n"
+    "\n"
+    "typedef void (*goose_bench_fn)(uint64_t iters);\n"
+    "\n"
+    "void goose_bench_register(const char *name, const char *file,\n"
+    "                          goose_bench_fn fn);\n"
+    "/* bytes the running benchmark handles per iteration, so the report\n"
+    " * gives a throughput in bytes as well */\n"
+    "void goose_bench_bytes(uint64_t bytes);\n"
+    "/* monotonic nanoseconds */\n"
+    "uint64_t goose_bench_now(void);\n"
+    "\n"
+    "#define BENCH(name)                                               \\\n"
+    "    static void goose_bench_##name(uint64_t iters);               \\\n"
+    "    __attribute__((constructor))                                  \\\n"
+    "    static void goose_breg_##name(void) {                         \\\n"
+    "        goose_bench_register(#name, __FILE__, goose_bench_##name); \\\n"
+    "    }                                                             \\\n"
+    "    static void goose_bench_##name(uint64_t iters)\n"
+    "\n"
+    "/* keep the compiler from dropping a value nothing reads, and from\n"
+    " * holding memory in registers across the point */\n"
+    "#define do_not_optimize(x) \\\n"
+    "    __asm__ __volatile__(\"\" : : \"r,m\"(x) : \"memory\")\n"
+    "static inline void clobber_memory(void) {\n"
+    "    __asm__ __volatile__(\"\" : : : \"memory\");\n"
+    "}\n"
+    "\n"
+    "/* the CPU's tick counter: rdtsc on x86 (a fixed rate on anything\n"
+    " * recent, not core cycles), cntvct_el0 on arm64, else nanoseconds */\n"
+    "static inline uint64_t goose_bench_ticks(void) {\n"
+    "#if defined(__x86_64__) || defined(__i386__)\n"
+    "    uint32_t lo, hi;\n"
+    "    __asm__ __volatile__(\"rdtsc\" : \"=a\"(lo), \"=d\"(hi));\n"
+    "    return ((uint64_t)hi << 32) | lo;\n"
+    "#elif defined(__aarch64__)\n"
+    "    uint64_t v;\n"
+    "    __asm__ __volatile__(\"mrs %0, cntvct_el0\" : \"=r\"(v));\n"
+    "    return v;\n"
+    "#else\n"
+    "    return goose_bench_now();\n"
+    "#endif\n"
+    "}\n"
+    "\n"
+    "#ifdef GOOSE_BENCH_RUNNER\n"
+    "#include <fnmatch.h>\n"
+    "#include <stdio.h>\n"
+    "#include <stdlib.h>\n"
+    "#include <string.h>\n"
+    "#include <time.h>\n"
+    "#ifdef __linux__\n"
+    "#include <linux/perf_event.h>\n"
+    "#include <sys/ioctl.h>\n"
+    "#include <sys/syscall.h>\n"
+    "#include <unistd.h>\n"
+    "#endif\n"
+    "\n"
+    "typedef struct {\n"
+    "    char name[256];     /* <file stem>.<benchmark> */\n"
+    "    goose_bench_fn fn;\n"
+    "    uint64_t bytes;\n"
+    "} GooseBench;\n"
+    "\n"
+    "static GooseBench *goose_benches, *goose_bench_cur;\n"
+    "static int goose_bench_count, goose_bench_cap;\n"
+    "\n"
+    "void goose_bench_register(const char *name, const char *file,\n"
+    "                          goose_bench_fn fn) {\n"
+    "    if (goose_bench_count == goose_bench_cap) {\n"
+    "        goose_bench_cap = goose_bench_cap ? goose_bench_cap * 2 : 64;\n"
+    "        goose_benches = realloc(goose_benches,\n"
+    "                                goose_bench_cap * sizeof(GooseBench));\n"
+    "        if (!goose_benches) abort();\n"
+    "    }\n"
+    "    GooseBench *b = &goose_benches[goose_bench_count++];\n"
+    "    memset(b, 0, sizeof(*b));\n"
+    "    const char *base = strrchr(file, '/');\n"
+    "    base = base ? base + 1 : file;\n"
+    "    const char *dot = strrchr(base, '.');\n"
+    "    int stem = dot ? (int)(dot - base) : (int)strlen(base);\n"
+    "    snprintf(b->name, sizeof(b->name), \"%.*s.%s\", stem, base, name);\n"
+    "    b->fn = fn;\n"
+    "}\n"
+    "\n"
+    "void goose_bench_bytes(uint64_t bytes) {\n"
+    "    if (goose_bench_cur) goose_bench_cur->bytes = bytes;\n"
+    "}\n"
+    "\n"
+    "uint64_t goose_bench_now(void) {\n"
+    "    struct timespec ts;\n"
+    "    clock_gettime(CLOCK_MONOTONIC, &ts);\n"
+    "    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;\n"
+    "}\n"
+    "\n"
+    "/* counters read with perf_event_open, without the perf tool. each is\n"
+    " * opened on its own, so one the kernel or a VM does not expose (most\n"
+    " * often all the hardware ones) leaves the others working */\n"
+    "static const struct {\n"
+    "    const char *name;\n"
+    "    uint32_t type;\n"
+    "    uint64_t config;\n"
+    "} goose_counters[] = {\n"
+    "#ifdef __linux__\n"
+    "    {\"cycles\", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},\n"
+    "    {\"instructions\", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},\n"
+    "    {\"cache_misses\", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},\n"
+    "    {\"branch_misses\", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},\n"
+    "    {\"task_clock_ns\", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},\n"
+    "    {\"page_faults\", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},\n"
+    "    {\"context_switches\", PERF_TYPE_SOFTWARE,\n"
+    "     PERF_COUNT_SW_CONTEXT_SWITCHES},\n"
+    "#endif\n"
+    "    {NULL, 0, 0}\n"
+    "};\n"
+    "#define GOOSE_COUNTERS \\\n"
+    "    (int)(sizeof(goose_counters) / sizeof(goose_counters[0]) - 1)\n"
+    "static int goose_counter_fd[GOOSE_COUNTERS + 1];\n"
+    "\n"
+    "/* open what can be opened, disabled and counting this process in user\n"
+    " * space only, which an unprivileged process may. returns how many */\n"
+    "static int goose_counters_open(void) {\n"
+    "    int open = 0;\n"
+    "    for (int i = 0; i < GOOSE_COUNTERS; i++) {\n"
+    "        goose_counter_fd[i] = -1;\n"
+    "#ifdef __linux__\n"
+    "        struct perf_event_attr attr;\n"
+    "        memset(&attr, 0, sizeof(attr));\n"
+    "        attr.size = sizeof(attr);\n"
+    "        attr.type = goose_counters[i].type;\n"
+    "        attr.config = goose_counters[i].config;\n"
+    "        attr.disabled = 1;\n"
+    "        attr.exclude_kernel = 1;\n"
+    "        attr.exclude_hv = 1;\n"
+    "        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |\n"
+    "                           PERF_FORMAT_TOTAL_TIME_RUNNING;\n"
+    "        goose_counter_fd[i] = (int)syscall(SYS_perf_event_open, &attr,\n"
+    "                                           0, -1, -1, 0);\n"
+    "        if (goose_counter_fd[i] >= 0) open++;\n"
+    "#endif\n"
+    "    }\n"
+    "    return open;\n"
+    "}\n"
+    "\n"
+    "static void goose_counters_ctl(int start) {\n"
+    "#ifdef __linux__\n"
+    "    for (int i = 0; i < GOOSE_COUNTERS; i++) {\n"
+    "        if (goose_counter_fd[i] < 0) continue;\n"
+    "        if (start) ioctl(goose_counter_fd[i], PERF_EVENT_IOC_RESET, 0);\n"
+    "        ioctl(goose_counter_fd[i], start ? PERF_EVENT_IOC_ENABLE\n"
+    "                                         : PERF_EVENT_IOC_DISABLE, 0);\n"
+    "    }\n"
+    "#else\n"
+    "    (void)start;\n"
+    "#endif\n"
+    "}\n"
+    "\n"
+    "/* write each counter per iteration as name=value, scaled up for the\n"
+    " * time the kernel had it switched out when there were too many */\n"
+    "static void goose_counters_report(FILE *f, uint64_t iters) {\n"
+    "    const char *sep = \"\\t\";\n"
+    "    for (int i = 0; i < GOOSE_COUNTERS; i++) {\n"
+    "        uint64_t v[3];\n"
+    "        if (goose_counter_fd[i] < 0 ||\n"
+    "            read(goose_counter_fd[i], v, sizeof(v)) != sizeof(v) ||\n"
+    "            v[2] == 0)\n"
+    "            continue;\n"
+    "        double n = (double)v[0] * ((double)v[1] / (double)v[2]);\n"
+    "        fprintf(f, \"%s%s=%.6g\", sep, goose_counters[i].name,\n"
+    "                n / (double)iters);\n"
+    "        sep = \",\";\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "static double goose_bench_run(GooseBench *b, uint64_t iters) {\n"
+    "    uint64_t t0 = goose_bench_now();\n"
+    "    b->fn(iters);\n"
+    "    return (double)(goose_bench_now() - t0);\n"
+    "}\n"
+    "\n"
+    "static int goose_cmp_bench(const void *a, const void *b) {\n"
+    "    const GooseBench *x = a, *y = b;\n"
+    "    return strcmp(x->name, y->name);\n"
+    "}\n"
+    "\n"
+    "/* usage: runner [--report F] [--filter G] [--time S] [--counters]\n"
+    " *               [--list]\n"
+    " * for each benchmark: grow the iteration count until one run takes a\n"
+    " * hundredth of the time, warm up at that count for a tenth of it, then\n"
+    " * take samples for the time (at least 10, at most 100). the report gets\n"
+    " * a line per benchmark: name, iterations per sample, bytes per\n"
+    " * iteration and each sample's nanoseconds per iteration, comma\n"
+    " * separated. with --counters a fifth field holds the counters of the\n"
+    " * samples per iteration, as name=value pairs */\n"
+    "int main(int argc, char **argv) {\n"
+    "    const char *report = NULL, *filter = NULL;\n"
+    "    double seconds = 1;\n"
+    "    int list = 0, counters = 0;\n"
+    "    for (int i = 1; i < argc; i++) {\n"
+    "        const char *val = i + 1 < argc ? argv[i + 1] : NULL;\n"
+    "        if (strcmp(argv[i], \"--list\") == 0) list = 1;\n"
+    "        else if (strcmp(argv[i], \"--counters\") == 0) counters = 1;\n"
+    "        else if (!val) break;\n"
+    "        else if (strcmp(argv[i], \"--report\") == 0) report = argv[++i];\n"
+    "        else if (strcmp(argv[i], \"--filter\") == 0) filter = argv[++i];\n"
+    "        else if (strcmp(argv[i], \"--time\") == 0)\n"
+    "            seconds = atof(argv[++i]);\n"
+    "    }\n"
+    "    double budget = seconds > 0 ? seconds * 1e9 : 1e9;\n"
+    "    double target = budget / 100;\n"
+    "\n"
+    "    qsort(goose_benches, goose_bench_count, sizeof(GooseBench),\n"
+    "          goose_cmp_bench);\n"
+    "    FILE *f = report && !list ? fopen(report, \"w\") : stdout;\n"
+    "    if (!f) return 2;\n"
+    "    if (counters && !list) counters = goose_counters_open() > 0;\n"
+    "    for (int i = 0; i < goose_bench_count; i++) {\n"
+    "        GooseBench *b = &goose_benches[i];\n"
+    "        if (filter && fnmatch(filter, b->name, 0) != 0) continue;\n"
+    "        if (list) {\n"
+    "            printf(\"%s\\n\", b->name);\n"
+    "            continue;\n"
+    "        }\n"
+    "        goose_bench_cur = b;\n"
+    "\n"
+    "        uint64_t iters = 1;\n"
+    "        double t;\n"
+    "        for (;;) {\n"
+    "            t = goose_bench_run(b, iters);\n"
+    "            if (t >= target || iters >= (uint64_t)1 << 40) break;\n"
+    "            double grow = t > 0 ? target * 1.2 / t : 100;\n"
+    "            grow = grow > 100 ? 100 : grow < 2 ? 2 : grow;\n"
+    "            iters = (uint64_t)((double)iters * grow);\n"
+    "        }\n"
+    "        for (double spent = 0; spent < budget / 10;)\n"
+    "            spent += goose_bench_run(b, iters);\n"
+    "\n"
+    "        /* samples are written after the loop, so the counters see\n"
+    "         * nothing but the benchmark and the clock */\n"
+    "        double elapsed = 0, samples[100];\n"
+    "        int n = 0;\n"
+    "        if (counters) goose_counters_ctl(1);\n"
+    "        for (; n < 100 && (n < 10 || elapsed < budget); n++) {\n"
+    "            t = goose_bench_run(b, iters);\n"
+    "            elapsed += t;\n"
+    "            samples[n] = t / (double)iters;\n"
+    "        }\n"
+    "        if (counters) goose_counters_ctl(0);\n"
+    "        fprintf(f, \"%s\\t%llu\\t%llu\\t\", b->name,\n"
+    "                (unsigned long long)iters,\n"
+    "                (unsigned long long)b->bytes);\n"
+    "        for (int k = 0; k < n; k++)\n"
+    "            fprintf(f, \"%s%.3f\", k ? \",\" : \"\", samples[k]);\n"
+    "        if (counters) goose_counters_report(f, iters * (uint64_t)n);\n"
+    "        fprintf(f, \"\\n\");\n"
+    "        fflush(f);\n"
+    "    }\n"
+    "    if (f != stdout) fclose(f);\n"
+    "    return 0;\n"
+    "}\n"
+    "#endif\n"
+    "\n"
+    "#endif\n";
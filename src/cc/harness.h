@@ -0,0 +1,17 @@
+#ifndef GOOSE_CC_HARNESS_H
+#define GOOSE_CC_HARNESS_H
+
+/* the text of goose_test.h: TEST(name) cases, CHECK and REQUIRE, and with
+ * GOOSE_TEST_RUNNER defined the runner main() that goose test links them
+ * into */
+extern const char c_test_harness[];
+
+/* the text of goose_bench.h: BENCH(name), do_not_optimize, clobber_memory
+ * and timers, and with GOOSE_BENCH_RUNNER defined the runner main() that
+ * calibrates and samples every benchmark */
+extern const char c_bench_harness[];
+
+#define C_TEST_RUNNER  "goose_tests"
+#define C_BENCH_RUNNER "goose_benches"
+
+#endif
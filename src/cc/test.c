@@ -0,0 +1,1573 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <fnmatch.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "config.h"
+#include "harness.h"
+#include "build.h"
+#include "test.h"
+#include "../headers/config.h"
+#include "../headers/build.h"
+#include "../headers/framework.h"
+#include "../headers/fs.h"
+#include "../headers/cache.h"
+#include "../headers/sched.h"
+#include "../headers/changes.h"
+#include "../headers/sha256.h"
+#include "../headers/color.h"
+
+/* the command writing what `files` pull in to depfile, so --affected can
+ * tell later which tests a change reaches. only the preprocessor runs; on
+ * failure no depfile is left behind */
+static int deps_command(const char *prefix, const char *includes,
+                        const char *files, const char *target,
+                        const char *depfile, StrBuf *cmd) {
+    StrBuf args, suffix;
+    strbuf_init(&args);
+    strbuf_init(&suffix);
+    strbuf_printf(&args, "%s%s", includes, files);
+    strbuf_printf(&suffix, "-MM -MT '%s' > '%s' 2>/dev/null || rm -f '%s'",
+                  target, depfile, depfile);
+    StrBuf rsp;
+    strbuf_init(&rsp);
+    strbuf_printf(&rsp, "%s.rsp", depfile);
+    int rc = build_command(prefix, args.data, suffix.data, rsp.data, cmd);
+    strbuf_free(&args);
+    strbuf_free(&suffix);
+    strbuf_free(&rsp);
+    return rc;
+}
+
+static void record_deps(const char *prefix, const char *includes,
+                        const char *files, const char *target,
+                        const char *depfile) {
+    StrBuf cmd;
+    strbuf_init(&cmd);
+    if (deps_command(prefix, includes, files, target, depfile, &cmd) == 0) {
+        fflush(stdout);
+        if (system(cmd.data) != 0) remove(depfile);
+    }
+    strbuf_free(&cmd);
+}
+
+/* whether a change reaches depfile, recording it first if there is none
+ * yet. anything unknown counts as reached */
+static int deps_changed(const ChangeSet *c, const char *prefix,
+                        const char *includes, const char *files,
+                        const char *target, const char *depfile) {
+    int hit = changes_depfile(c, depfile);
+    if (hit < 0) {
+        record_deps(prefix, includes, files, target, depfile);
+        hit = changes_depfile(c, depfile);
+    }
+    return hit != 0;
+}
+
+static int cmp_str(const void *a, const void *b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+/* one test binary on the scheduler: compile its file, link it with the
+ * shared objects, run it, then report. the harness runner is one too,
+ * built from every file of TEST cases; a case it ran is reported as a
+ * TestJob of its own with only the verdict fields set */
+typedef struct {
+    const char *file;
+    char name[128];
+    int compile;
+    int link;
+    int run;
+    int reported;   /* 1 pass, -1 fail, 0 not run */
+    int report;
+    int run_ok;     /* the binary was built and run, so seconds is real */
+    int timed_out;
+    int cached;     /* passed before with the same fingerprint, not run */
+    double seconds;
+    long max_rss;   /* KiB */
+    char fingerprint[SHA256_HEX_LEN];   /* empty if it cannot be taken */
+    const char **objs;  /* its own objects, linked with the shared ones */
+    int obj_count;
+    int runner;
+    const char *args;   /* the runner's options */
+    int cases;          /* how many cases the runner reported */
+} TestJob;
+
+typedef struct {
+    TestJob *tests;
+    TestJob *cases;     /* what the runner reported, in its order */
+    int case_count;
+    int case_cap;
+    Arena *arena;
+    const Config *cfg;
+    const char *out_dir;
+    const char *bin_dir;    /* binaries only, apart from the records */
+    double timeout;
+    int no_cache;
+    int cached;
+    int passed;
+    int failed;
+} TestRun;
+
+/* copy a captured log to stdout */
+void print_file(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return;
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        fwrite(buf, 1, n, stdout);
+    fclose(f);
+}
+
+/* what a test's verdict depends on: its binary and options, the data
+ * files and variables goose.yaml says it reads, where it runs and how
+ * long it may. returns -1 if something cannot be read, which rules out
+ * the cache */
+static int test_fingerprint(const char *bin, const char *args,
+                            const Config *cfg, double timeout,
+                            char out[SHA256_HEX_LEN]) {
+    char hex[SHA256_HEX_LEN], cwd[1024];
+    if (sha256_file_hex(bin, hex) != 0 || !getcwd(cwd, sizeof(cwd)))
+        return -1;
+    Sha256 ctx;
+    sha256_init(&ctx);
+    cache_key_field(&ctx, "goose-test-1");
+    cache_key_field(&ctx, hex);
+    cache_key_field(&ctx, args ? args : "");
+    cache_key_field(&ctx, cwd);
+    snprintf(hex, sizeof(hex), "%g", timeout);
+    cache_key_field(&ctx, hex);
+
+    for (int i = 0; i < cfg->test_data_count; i++) {
+        const char *path = cfg->test_data[i];
+        struct stat st;
+        cache_key_field(&ctx, path);
+        if (stat(path, &st) != 0)
+            snprintf(hex, sizeof(hex), "missing");
+        else if (S_ISDIR(st.st_mode) ? fs_tree_hash(path, hex) != 0
+                                     : sha256_file_hex(path, hex) != 0)
+            return -1;
+        cache_key_field(&ctx, hex);
+    }
+    for (int i = 0; i < cfg->test_env_count; i++) {
+        const char *val = getenv(cfg->test_env[i]);
+        cache_key_field(&ctx, cfg->test_env[i]);
+        cache_key_field(&ctx, val ? "set" : "unset");
+        cache_key_field(&ctx, val ? val : "");
+    }
+    sha256_final_hex(&ctx, out);
+    return 0;
+}
+
+/* <out_dir>/<name>.pass holds "fingerprint seconds max_rss" of the last
+ * run of a test that passed */
+static int read_pass(const TestRun *tr, TestJob *t) {
+    const char *path = arena_printf(tr->arena, "%s/%s.pass", tr->out_dir,
+                                    t->name);
+    char fp[SHA256_HEX_LEN];
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    double secs;
+    long rss;
+    int ok = fscanf(f, "%64s %lf %ld", fp, &secs, &rss) == 3 &&
+             strcmp(fp, t->fingerprint) == 0;
+    fclose(f);
+    if (ok) {
+        t->seconds = secs;
+        t->max_rss = rss;
+    }
+    return ok;
+}
+
+static void write_pass(const TestRun *tr, const TestJob *t) {
+    const char *path = arena_printf(tr->arena, "%s/%s.pass", tr->out_dir,
+                                    t->name);
+    char line[256];
+    if (t->reported <= 0 || !t->fingerprint[0]) {
+        remove(path);
+        return;
+    }
+    snprintf(line, sizeof(line), "%s %.3f %ld\n", t->fingerprint,
+             t->seconds, t->max_rss);
+    fs_write_file(path, line);
+}
+
+/* once a test is linked: leave it be if it passed before with the same
+ * fingerprint, otherwise queue running it ahead of its report */
+static int check_test(Sched *s, void *ctx, int arg) {
+    TestRun *tr = ctx;
+    TestJob *t = &tr->tests[arg];
+    const char *bin = arena_printf(tr->arena, "%s/%s", tr->bin_dir, t->name);
+    if (test_fingerprint(bin, t->args, tr->cfg, tr->timeout,
+                         t->fingerprint) != 0)
+        t->fingerprint[0] = '\0';
+    if (!tr->no_cache && t->fingerprint[0] && read_pass(tr, t)) {
+        t->cached = 1;
+        return 0;
+    }
+
+    /* the runner times its cases itself; what they reported last time
+     * must not pass for this run's if it dies before writing */
+    StrBuf cmd;
+    strbuf_init(&cmd);
+    strbuf_printf(&cmd, "exec '%s' %s> '%s/%s.out' 2>&1", bin,
+                  t->args ? t->args : "", tr->out_dir, t->name);
+    t->run = sched_cmd(s, cmd.data, NULL);
+    strbuf_free(&cmd);
+    if (t->run < 0) return -1;
+    if (t->runner) {
+        remove(arena_printf(tr->arena, "%s/%s.cases", tr->out_dir, t->name));
+    } else if (tr->timeout > 0) {
+        sched_timeout(s, t->run, tr->timeout);
+    }
+    sched_after(s, t->report, t->run);
+    return 0;
+}
+
+/* why a test or case that ran did not pass */
+static void print_failure(const char *name, int timed_out, int status,
+                          double timeout) {
+    cprintf(CLR_RED, "      FAIL ");
+    if (timed_out)
+        printf("%s (timed out after %gs)\n", name, timeout);
+    else if (WIFSIGNALED(status))
+        printf("%s (signal %d)\n", name, WTERMSIG(status));
+    else
+        printf("%s (exit %d)\n", name, WEXITSTATUS(status));
+}
+
+/* read back the verdict of every case the runner ran from
+ * <out_dir>/<runner>.cases and print each like a test of its own. a
+ * cached runner shows the cases of the run that passed. returns how many
+ * failed */
+static int report_cases(TestRun *tr, TestJob *t) {
+    FILE *f = fopen(arena_printf(tr->arena, "%s/%s.cases", tr->out_dir,
+                                 t->name), "r");
+    if (!f) return 0;
+    int failed = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        char name[128], verdict[16];
+        double secs;
+        long rss;
+        int status;
+        if (sscanf(line, "%127s %15s %lf %ld %d", name, verdict, &secs, &rss,
+                   &status) != 5)
+            continue;
+        int cap = tr->case_cap;
+        tr->cases = arena_grow(tr->arena, tr->cases, tr->case_count, &cap,
+                               sizeof(TestJob));
+        tr->case_cap = cap;
+        TestJob *c = &tr->cases[tr->case_count++];
+        memset(c, 0, sizeof(*c));
+        snprintf(c->name, sizeof(c->name), "%s", name);
+        c->seconds = secs;
+        c->max_rss = rss;
+        c->run_ok = 1;
+        c->cached = t->cached;
+        c->timed_out = strcmp(verdict, "timeout") == 0;
+        c->reported = strcmp(verdict, "pass") == 0 ? 1 : -1;
+        t->cases++;
+
+        if (c->cached) {
+            cprintf(CLR_GREEN, "    CACHED ");
+            printf("%s\n", c->name);
+            tr->cached++;
+            tr->passed++;
+            continue;
+        }
+        print_file(arena_printf(tr->arena, "%s/cases/%s.out", tr->out_dir,
+                                name));
+        if (c->reported > 0) {
+            cprintf(CLR_GREEN, "      PASS ");
+            printf("%s\n", c->name);
+            tr->passed++;
+        } else {
+            print_failure(c->name, c->timed_out, status, tr->timeout);
+            tr->failed++;
+            failed++;
+        }
+    }
+    fclose(f);
+    return failed;
+}
+
+/* the runner passes when every case it ran did; failing on its own, say
+ * it crashed outside a case, it is reported by name */
+static int report_runner(Sched *s, TestRun *tr, TestJob *t) {
+    if (!t->cached && sched_status(s, t->run) == SCHED_PENDING) {
+        cprintf(CLR_RED, "      FAIL ");
+        printf("%s (not run)\n", t->name);
+        t->reported = -1;
+        tr->failed++;
+        return 0;
+    }
+
+    int ok = t->cached;
+    if (!t->cached) {
+        print_file(arena_printf(tr->arena, "%s/%s.out", tr->out_dir,
+                                t->name));
+        t->seconds = sched_seconds(s, t->run);
+        t->max_rss = sched_max_rss(s, t->run);
+        t->run_ok = 1;
+        ok = sched_status(s, t->run) == SCHED_DONE;
+    }
+    if (report_cases(tr, t) == 0 && !ok) {
+        print_failure(t->name, 0, sched_exit_status(s, t->run), 0);
+        tr->failed++;
+    }
+    t->reported = ok ? 1 : -1;
+    write_pass(tr, t);
+    fflush(stdout);
+    return 0;
+}
+
+/* print one test's captured output and verdict. reports are chained in
+ * file order, so the log reads the same however the jobs interleaved */
+static int report_test(Sched *s, void *ctx, int arg) {
+    TestRun *tr = ctx;
+    TestJob *t = &tr->tests[arg];
+
+    if (sched_status(s, t->compile) != SCHED_DONE ||
+        sched_status(s, t->link) != SCHED_DONE) {
+        /* the runner has a log per case file, then its own */
+        for (int i = 0; t->runner && i < t->obj_count; i++)
+            print_file(arena_printf(tr->arena, "%.*s.log",
+                                    (int)strlen(t->objs[i]) - 2,
+                                    t->objs[i]));
+        print_file(arena_printf(tr->arena, "%s/%s.log", tr->out_dir,
+                                t->name));
+        cprintf(CLR_RED, "      FAIL ");
+        printf("%s (compile error)\n", t->name);
+        t->reported = -1;
+        tr->failed++;
+        return 0;
+    }
+    if (t->runner) return report_runner(s, tr, t);
+
+    if (t->cached) {
+        cprintf(CLR_GREEN, "    CACHED ");
+        printf("%s\n", t->name);
+        t->reported = 1;
+        t->run_ok = 1;
+        tr->passed++;
+        tr->cached++;
+        return 0;
+    }
+    if (sched_status(s, t->run) == SCHED_PENDING) {
+        cprintf(CLR_RED, "      FAIL ");
+        printf("%s (not run)\n", t->name);
+        t->reported = -1;
+        tr->failed++;
+        return 0;
+    }
+
+    print_file(arena_printf(tr->arena, "%s/%s.out", tr->out_dir, t->name));
+    int status = sched_exit_status(s, t->run);
+    t->seconds = sched_seconds(s, t->run);
+    t->max_rss = sched_max_rss(s, t->run);
+    t->timed_out = sched_timed_out(s, t->run);
+    t->run_ok = 1;
+    if (sched_status(s, t->run) == SCHED_DONE) {
+        cprintf(CLR_GREEN, "      PASS ");
+        printf("%s\n", t->name);
+        t->reported = 1;
+        tr->passed++;
+    } else {
+        print_failure(t->name, t->timed_out, status, tr->timeout);
+        t->reported = -1;
+        tr->failed++;
+    }
+    write_pass(tr, t);
+    fflush(stdout);
+    return 0;
+}
+
+/* test durations from earlier runs, read from build/test/timings. it
+ * holds lines like a results file, so merged shard results serve too */
+typedef struct {
+    StrList names;
+    StrList status;
+    double *secs;
+    int cap;
+} Timings;
+
+static void timings_load(const char *path, Timings *tm, Arena *arena) {
+    strlist_init(&tm->names, arena);
+    strlist_init(&tm->status, arena);
+    tm->secs = NULL;
+    tm->cap = 0;
+    FILE *f = fopen(path, "r");
+    if (!f) return;
+    char line[512], name[256], status[16];
+    double secs;
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' ||
+            sscanf(line, "%255s %15s %lf", name, status, &secs) != 3)
+            continue;
+        int cap = tm->cap;
+        tm->secs = arena_grow(arena, tm->secs, tm->names.count, &cap,
+                              sizeof(double));
+        tm->cap = cap;
+        tm->secs[tm->names.count] = secs;
+        strlist_push(&tm->names, name);
+        strlist_push(&tm->status, status);
+    }
+    fclose(f);
+}
+
+/* the line recording name, -1 if there is none. the last one wins */
+static int timings_find(const Timings *tm, const char *name) {
+    for (int i = tm->names.count - 1; i >= 0; i--)
+        if (strcmp(tm->names.items[i], name) == 0) return i;
+    return -1;
+}
+
+static double timings_get(const Timings *tm, const char *name) {
+    int i = timings_find(tm, name);
+    return i < 0 ? -1 : tm->secs[i];
+}
+
+/* the name a test file runs under: its file name without extension */
+void test_name(const char *file, char *out, size_t size) {
+    const char *base = strrchr(file, '/');
+    snprintf(out, size, "%s", base ? base + 1 : file);
+    char *dot = strrchr(out, '.');
+    if (dot) *dot = '\0';
+}
+
+static unsigned fnv1a(const char *s) {
+    unsigned h = 2166136261u;
+    for (; *s; s++) h = (h ^ (unsigned char)*s) * 16777619u;
+    return h;
+}
+
+typedef struct {
+    const char *name;
+    double secs;
+} ShardItem;
+
+static int cmp_shard_item(const void *a, const void *b) {
+    const ShardItem *x = a, *y = b;
+    if (x->secs != y->secs) return x->secs > y->secs ? -1 : 1;
+    return strcmp(x->name, y->name);
+}
+
+/* keep in files only the tests of shard k of n. with recorded durations,
+ * the longest tests are dealt out first, each to the shard with the least
+ * work so far, and a test without one counts as the average. otherwise a
+ * hash of the name decides, so a test stays put as others come and go.
+ * every node must see the same files and timings to agree on the split.
+ * returns 1 if durations were used */
+static int shard_tests(StrList *files, int k, int n, const Timings *tm,
+                       Arena *arena) {
+    ShardItem *items = arena_alloc(arena, (files->count + 1) * sizeof(*items));
+    double total = 0;
+    int known = 0;
+    for (int i = 0; i < files->count; i++) {
+        char name[128];
+        test_name(files->items[i], name, sizeof(name));
+        items[i].name = arena_strdup(arena, name);
+        items[i].secs = timings_get(tm, name);
+        if (items[i].secs >= 0) {
+            total += items[i].secs;
+            known++;
+        }
+    }
+
+    StrList keep;
+    strlist_init(&keep, arena);
+    if (known == 0) {
+        for (int i = 0; i < files->count; i++)
+            if ((int)(fnv1a(items[i].name) % (unsigned)n) == k - 1)
+                strlist_push(&keep, files->items[i]);
+        *files = keep;
+        return 0;
+    }
+
+    /* pair each item with its file before sorting by duration */
+    const char **by_name = arena_alloc(arena,
+                                       (files->count + 1) * sizeof(char *));
+    for (int i = 0; i < files->count; i++) {
+        if (items[i].secs < 0) items[i].secs = total / known;
+        by_name[i] = items[i].name;
+    }
+    qsort(items, files->count, sizeof(*items), cmp_shard_item);
+
+    double *load = arena_alloc(arena, n * sizeof(double));
+    memset(load, 0, n * sizeof(double));
+    unsigned char *mine = arena_alloc(arena, files->count + 1);
+    memset(mine, 0, files->count + 1);
+    for (int i = 0; i < files->count; i++) {
+        int least = 0;
+        for (int j = 1; j < n; j++)
+            if (load[j] < load[least]) least = j;
+        load[least] += items[i].secs;
+        if (least != k - 1) continue;
+        for (int f = 0; f < files->count; f++)
+            if (strcmp(by_name[f], items[i].name) == 0) mine[f] = 1;
+    }
+    for (int i = 0; i < files->count; i++)
+        if (mine[i]) strlist_push(&keep, files->items[i]);
+    *files = keep;
+    return 1;
+}
+
+/* entry i of what the run reported: the tests, then the runner's cases.
+ * NULL for one that did not report, and for the runner once it reported
+ * cases, which stand in for it */
+static const TestJob *result_at(const TestRun *tr, int count, int i) {
+    const TestJob *t = i < count ? &tr->tests[i] : &tr->cases[i - count];
+    if (!t->reported || (t->runner && t->cases > 0)) return NULL;
+    return t;
+}
+
+/* write what this run reported, one "name<TAB>pass|fail<TAB>seconds"
+ * line per test or case, to results. timings keeps the latest line of
+ * every test binary that ran, here or before; one that did not compile
+ * keeps its old one. a shard leaves timings alone (NULL), so the shards
+ * after it on the same machine still split the tests the same way */
+static void write_results(const TestRun *tr, int count, const char *results,
+                          const char *timings_path, const Timings *old) {
+    StrBuf out, merged;
+    strbuf_init(&out);
+    strbuf_init(&merged);
+    for (int i = 0; i < old->names.count; i++) {
+        const char *name = old->names.items[i];
+        int rerun = 0;
+        for (int j = 0; j < count && !rerun; j++)
+            rerun = tr->tests[j].run_ok && strcmp(tr->tests[j].name, name) == 0;
+        if (!rerun && timings_find(old, name) == i)
+            strbuf_printf(&merged, "%s\t%s\t%.3f\n", name,
+                          old->status.items[i], old->secs[i]);
+    }
+    for (int i = 0; i < count + tr->case_count; i++) {
+        const TestJob *t = result_at(tr, count, i);
+        if (t)
+            strbuf_printf(&out, "%s\t%s\t%.3f\n", t->name,
+                          t->reported > 0 ? "pass" : "fail", t->seconds);
+    }
+    for (int i = 0; i < count; i++) {
+        const TestJob *t = &tr->tests[i];
+        if (t->reported && t->run_ok)
+            strbuf_printf(&merged, "%s\t%s\t%.3f\n", t->name,
+                          t->reported > 0 ? "pass" : "fail", t->seconds);
+    }
+    if (fs_write_file(results, out.data) != 0)
+        warn("Results", "cannot write %s", results);
+    if (timings_path)
+        fs_write_file(timings_path, merged.data);
+    strbuf_free(&out);
+    strbuf_free(&merged);
+}
+
+void json_string(StrBuf *out, const char *s) {
+    strbuf_printf(out, "\"");
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\')
+            strbuf_printf(out, "\\%c", *s);
+        else if ((unsigned char)*s < 0x20)
+            strbuf_printf(out, "\\u%04x", (unsigned char)*s);
+        else
+            strbuf_printf(out, "%c", *s);
+    }
+    strbuf_printf(out, "\"");
+}
+
+/* the run as JSON for CI dashboards: totals, then every test reported
+ * with how it ended, its wall time and peak memory. the same tests also
+ * go to <path>l as JSON lines, one self-contained object per test, so
+ * the files of several shards merge with cat */
+static void write_json(const TestRun *tr, int count, const char *path,
+                       const char *project, const char *shard) {
+    StrBuf out, lines;
+    strbuf_init(&out);
+    strbuf_init(&lines);
+    strbuf_printf(&out, "{\n  \"project\": ");
+    json_string(&out, project);
+    strbuf_printf(&out, ",\n  \"passed\": %d,\n  \"failed\": %d,\n"
+                  "  \"timeout\": %g,\n  \"tests\": [", tr->passed,
+                  tr->failed, tr->timeout);
+    int first = 1;
+    for (int i = 0; i < count + tr->case_count; i++) {
+        const TestJob *t = result_at(tr, count, i);
+        if (!t) continue;
+        const char *status = t->cached       ? "cached"
+                           : t->reported > 0 ? "pass"
+                           : t->timed_out    ? "timeout"
+                           : t->run_ok       ? "fail"
+                                             : "compile_error";
+        strbuf_printf(&out, "%s\n    {\"name\": ", first ? "" : ",");
+        json_string(&out, t->name);
+        strbuf_printf(&out, ", \"status\": \"%s\", \"seconds\": %.3f, "
+                      "\"max_rss_kib\": %ld}", status, t->seconds,
+                      t->max_rss);
+        first = 0;
+
+        strbuf_printf(&lines, "{\"project\": ");
+        json_string(&lines, project);
+        if (shard)
+            strbuf_printf(&lines, ", \"shard\": \"%s\"", shard);
+        strbuf_printf(&lines, ", \"name\": ");
+        json_string(&lines, t->name);
+        strbuf_printf(&lines, ", \"status\": \"%s\", \"seconds\": %.3f, "
+                      "\"max_rss_kib\": %ld}\n", status, t->seconds,
+                      t->max_rss);
+    }
+    strbuf_printf(&out, "%s]\n}\n", first ? "" : "\n  ");
+    if (fs_write_file(path, out.data) != 0)
+        warn("Results", "cannot write %s", path);
+    StrBuf lines_path;
+    strbuf_init(&lines_path);
+    strbuf_printf(&lines_path, "%sl", path);
+    if (fs_write_file(lines_path.data, lines.data) != 0)
+        warn("Results", "cannot write %s", lines_path.data);
+    strbuf_free(&lines_path);
+    strbuf_free(&lines);
+    strbuf_free(&out);
+}
+
+static int cmp_slower(const void *a, const void *b) {
+    const TestJob *x = *(const TestJob *const *)a;
+    const TestJob *y = *(const TestJob *const *)b;
+    if (x->seconds != y->seconds) return x->seconds > y->seconds ? -1 : 1;
+    return strcmp(x->name, y->name);
+}
+
+/* the few tests that took longest, to keep an eye on as the suite grows */
+static void report_slowest(const TestRun *tr, int count, Arena *arena) {
+    int total = count + tr->case_count;
+    const TestJob **ran = arena_alloc(arena, (total + 1) * sizeof(*ran));
+    int n = 0;
+    for (int i = 0; i < total; i++) {
+        const TestJob *t = result_at(tr, count, i);
+        if (t && t->run_ok && !t->cached) ran[n++] = t;
+    }
+    if (n < 2) return;
+    qsort(ran, n, sizeof(*ran), cmp_slower);
+    int shown = n < 5 ? n : 5;
+    info("Slowest", "%d of %d tests", shown, n);
+    for (int i = 0; i < shown; i++)
+        printf("             %7.2fs %8.1f MiB  %s\n", ran[i]->seconds,
+               ran[i]->max_rss / 1024.0, ran[i]->name);
+}
+
+/* what the objects linked into tests define and need, as nm reports */
+typedef struct {
+    const char *sym;
+    int obj;
+} SymDef;
+
+typedef struct {
+    const char **files;     /* objects, then the tests' own */
+    int count;
+    SymDef *defs;           /* sorted by symbol */
+    int def_count;
+    int def_cap;
+    StrList *needs;         /* per object */
+} SymTable;
+
+static int cmp_symdef(const void *a, const void *b) {
+    return strcmp(((const SymDef *)a)->sym, ((const SymDef *)b)->sym);
+}
+
+/* run nm over files [from, to) and file each external symbol as defined
+ * or needed by the object it came from */
+static int nm_scan(SymTable *st, int from, int to, Arena *arena) {
+    StrBuf cmd;
+    strbuf_init(&cmd);
+    strbuf_printf(&cmd, "nm -P -g -A");
+    for (int i = from; i < to; i++)
+        strbuf_printf(&cmd, " '%s'", st->files[i]);
+    strbuf_printf(&cmd, " 2>/dev/null");
+    FILE *p = popen(cmd.data, "r");
+    strbuf_free(&cmd);
+    if (!p) return -1;
+
+    char line[4096];
+    int cur = from;
+    while (fgets(line, sizeof(line), p)) {
+        char *sep = strstr(line, ": ");
+        if (!sep) continue;
+        *sep = '\0';
+        /* lines of one file come together, so look where the last was */
+        if (strcmp(st->files[cur], line) != 0)
+            for (cur = from; cur < to; cur++)
+                if (strcmp(st->files[cur], line) == 0) break;
+        if (cur == to) {
+            cur = from;
+            continue;
+        }
+        char sym[1024], type[8];
+        if (sscanf(sep + 2, "%1023s %7s", sym, type) != 2) continue;
+        if (strcmp(type, "U") == 0 || strcmp(type, "w") == 0 ||
+            strcmp(type, "v") == 0) {
+            strlist_push(&st->needs[cur], sym);
+        } else {
+            int cap = st->def_cap;
+            st->defs = arena_grow(arena, st->defs, st->def_count, &cap,
+                                  sizeof(SymDef));
+            st->def_cap = cap;
+            st->defs[st->def_count].sym = arena_intern(arena, sym);
+            st->defs[st->def_count++].obj = cur;
+        }
+    }
+    return pclose(p) == 0 ? 0 : -1;
+}
+
+/* mark the files [from, to) that run code before or after main: anything
+ * in .init_array, .ctors and the like. such an object acts on every
+ * test that links it, whether or not the test refers to it */
+static int ctor_scan(const SymTable *st, int from, int to,
+                     unsigned char *always) {
+    static const char *sections[] = {".init_array", ".preinit_array",
+                                      ".fini_array", ".ctors", ".dtors"};
+    StrBuf cmd;
+    strbuf_init(&cmd);
+    strbuf_printf(&cmd, "size -A");
+    for (int i = from; i < to; i++)
+        strbuf_printf(&cmd, " '%s'", st->files[i]);
+    strbuf_printf(&cmd, " 2>/dev/null");
+    FILE *p = popen(cmd.data, "r");
+    strbuf_free(&cmd);
+    if (!p) return -1;
+
+    /* "<file>  :" starts each file's table of "<section> <size> <addr>" */
+    char line[4096];
+    int cur = -1;
+    while (fgets(line, sizeof(line), p)) {
+        size_t len = strcspn(line, "\n");
+        line[len] = '\0';
+        if (len > 3 && strcmp(line + len - 3, "  :") == 0) {
+            line[len - 3] = '\0';
+            for (cur = from; cur < to; cur++)
+                if (strcmp(st->files[cur], line) == 0) break;
+            if (cur == to) cur = -1;
+            continue;
+        }
+        char sec[256];
+        unsigned long size;
+        if (cur < 0 || sscanf(line, "%255s %lu", sec, &size) != 2 || !size)
+            continue;
+        for (int k = 0; k < (int)(sizeof(sections) / sizeof(*sections)); k++)
+            if (strncmp(sec, sections[k], strlen(sections[k])) == 0)
+                always[cur] = 1;
+    }
+    return pclose(p) == 0 ? 0 : -1;
+}
+
+/* queue the shared objects defining a symbol bin exports to the shared
+ * libraries it loads. the linker exports a symbol an object defines that
+ * a library also defines or refers to, so these are the objects that may
+ * interpose on a library's own calls, which nm of the objects cannot see */
+static void exported_roots(const SymTable *st, int shared, const char *bin,
+                           unsigned char *seen, int *queue, int *tail) {
+    StrBuf cmd;
+    strbuf_init(&cmd);
+    strbuf_printf(&cmd, "nm -D -P --defined-only '%s' 2>/dev/null", bin);
+    FILE *p = popen(cmd.data, "r");
+    strbuf_free(&cmd);
+    if (!p) return;
+    char line[4096];
+    while (fgets(line, sizeof(line), p)) {
+        char sym[1024];
+        if (sscanf(line, "%1023s", sym) != 1) continue;
+        SymDef key = {sym, 0};
+        SymDef *d = bsearch(&key, st->defs, st->def_count, sizeof(SymDef),
+                            cmp_symdef);
+        if (!d || d->obj >= shared || seen[d->obj]) continue;
+        seen[d->obj] = 1;
+        queue[(*tail)++] = d->obj;
+    }
+    pclose(p);
+}
+
+static int prereq_collect(const char *prereq, void *ctx) {
+    StrList *l = ctx;
+    if (!strlist_contains(l, prereq)) strlist_push(l, prereq);
+    return 0;
+}
+
+/* write <name>.impact for every test linked this run: a depfile listing
+ * the prerequisites of the test's own objects and of each shared object
+ * it reaches through the symbols they need. an object the test does not
+ * refer to still counts when it could act on the test all the same: it
+ * has constructors or destructors, it defines a symbol another object
+ * defines too, or the test binary exports one of its symbols to a
+ * library. selection may take a test that did not need to run, but
+ * must not skip one that did */
+static void record_impact(const TestRun *tr, int count, const Sched *s,
+                          const StrList *objs, Arena *arena) {
+    SymTable st;
+    memset(&st, 0, sizeof(st));
+    /* one that did not link may lack objects for nm to read */
+    int *own = arena_alloc(arena, (count + 1) * sizeof(int));
+    st.count = objs->count;
+    for (int t = 0; t < count; t++) {
+        own[t] = st.count;
+        if (sched_status(s, tr->tests[t].link) == SCHED_DONE)
+            st.count += tr->tests[t].obj_count;
+    }
+    st.files = arena_alloc(arena, (st.count + 1) * sizeof(char *));
+    st.needs = arena_alloc(arena, (st.count + 1) * sizeof(StrList));
+    for (int i = 0; i < objs->count; i++)
+        st.files[i] = objs->items[i];
+    for (int t = 0; t < count; t++) {
+        const TestJob *tj = &tr->tests[t];
+        if (sched_status(s, tj->link) != SCHED_DONE) continue;
+        for (int j = 0; j < tj->obj_count; j++)
+            st.files[own[t] + j] = tj->objs[j];
+    }
+    for (int i = 0; i < st.count; i++)
+        strlist_init(&st.needs[i], arena);
+    /* a few hundred paths per nm keeps the command line short */
+    for (int i = 0; i < st.count; i += 200) {
+        int to = i + 200 < st.count ? i + 200 : st.count;
+        if (nm_scan(&st, i, to, arena) != 0) {
+            warn("Impact", "cannot read symbols with nm, tests are not "
+                 "narrowed by --impacted");
+            return;
+        }
+    }
+    qsort(st.defs, st.def_count, sizeof(SymDef), cmp_symdef);
+
+    /* shared objects that count for every test */
+    int shared = objs->count;
+    unsigned char *always = arena_alloc(arena, shared + 1);
+    memset(always, 0, shared + 1);
+    for (int i = 0; i < shared; i += 200) {
+        int to = i + 200 < shared ? i + 200 : shared;
+        if (ctor_scan(&st, i, to, always) != 0) {
+            warn("Impact", "cannot read sections with size, every shared "
+                 "object counts for every test");
+            memset(always, 1, shared);
+            break;
+        }
+    }
+    for (int i = 0, j; i < st.def_count; i = j) {
+        for (j = i + 1; j < st.def_count &&
+                        strcmp(st.defs[j].sym, st.defs[i].sym) == 0; j++)
+            ;
+        for (int k = i; j - i > 1 && k < j; k++)
+            if (st.defs[k].obj < shared) always[st.defs[k].obj] = 1;
+    }
+
+    unsigned char *seen = arena_alloc(arena, st.count + 1);
+    int *queue = arena_alloc(arena, (st.count + 1) * sizeof(int));
+    for (int t = 0; t < count; t++) {
+        const TestJob *tj = &tr->tests[t];
+        if (sched_status(s, tj->link) != SCHED_DONE) continue;
+
+        /* breadth first from the test's objects through what they need */
+        memset(seen, 0, st.count + 1);
+        int head = 0, tail = 0;
+        for (int j = 0; j < tj->obj_count; j++) {
+            queue[tail++] = own[t] + j;
+            seen[own[t] + j] = 1;
+        }
+        for (int i = 0; i < shared; i++)
+            if (always[i]) {
+                queue[tail++] = i;
+                seen[i] = 1;
+            }
+        const char *bin = arena_printf(arena, "%s/%s", tr->bin_dir,
+                                       tj->name);
+        exported_roots(&st, shared, bin, seen, queue, &tail);
+        while (head < tail) {
+            const StrList *needs = &st.needs[queue[head++]];
+            for (int n = 0; n < needs->count; n++) {
+                SymDef key = {needs->items[n], 0};
+                SymDef *d = bsearch(&key, st.defs, st.def_count,
+                                    sizeof(SymDef), cmp_symdef);
+                if (!d || seen[d->obj] || d->obj >= objs->count) continue;
+                seen[d->obj] = 1;
+                queue[tail++] = d->obj;
+            }
+        }
+
+        StrList prereqs;
+        strlist_init(&prereqs, arena);
+        int complete = 1;
+        for (int q = 0; q < tail && complete; q++) {
+            char *dep = arena_strdup(arena, st.files[queue[q]]);
+            dep[strlen(dep) - 1] = 'd';
+            complete = depfile_each(dep, prereq_collect, &prereqs) == 0;
+        }
+
+        const char *path = arena_printf(arena, "%s/%s.impact", tr->out_dir,
+                                        tj->name);
+        if (!complete) {
+            remove(path);
+            continue;
+        }
+        StrBuf out;
+        strbuf_init(&out);
+        strbuf_printf(&out, "%s:", tj->name);
+        for (int i = 0; i < prereqs.count; i++) {
+            strbuf_printf(&out, " \\\n ");
+            for (const char *c = prereqs.items[i]; *c; c++) {
+                if (*c == ' ')
+                    strbuf_printf(&out, "\\ ");
+                else
+                    strbuf_printf(&out, "%c", *c);
+            }
+        }
+        strbuf_printf(&out, "\n");
+        fs_write_file(path, out.data);
+        strbuf_free(&out);
+    }
+}
+
+/* queue linking test i from its own objects once the jobs compiling them
+ * and [shared_from, shared_to) are done, then checking it, which runs
+ * it unless it is cached, and reporting it after prev_report. returns
+ * the report job */
+static int queue_link(Sched *s, TestRun *tr, int i, const char *prefix,
+                      const char *shared_objs, const char *ldflags,
+                      int shared_from, int shared_to, int prev_report) {
+    TestJob *t = &tr->tests[i];
+    const char *dir = tr->out_dir;
+    const char *bin = arena_printf(tr->arena, "%s/%s", tr->bin_dir, t->name);
+    const char *rsp = arena_printf(tr->arena, "%s/%s.rsp", dir, t->name);
+    const char *log = arena_printf(tr->arena, "%s/%s.log", dir, t->name);
+
+    StrBuf cmd, args, suffix;
+    strbuf_init(&cmd);
+    strbuf_init(&args);
+    strbuf_init(&suffix);
+    for (int j = 0; j < t->obj_count; j++)
+        strbuf_printf(&args, "'%s' ", t->objs[j]);
+    strbuf_printf(&args, "%s", shared_objs);
+    strbuf_printf(&suffix, "-o '%s'%s >> '%s' 2>&1", bin, ldflags, log);
+    t->link = -1;
+    if (build_command(prefix, args.data, suffix.data, rsp, &cmd) == 0 &&
+        (t->link = sched_cmd(s, cmd.data, NULL)) >= 0)
+        sched_after_range(s, t->link, shared_from, shared_to);
+    strbuf_free(&cmd);
+    strbuf_free(&args);
+    strbuf_free(&suffix);
+
+    /* running it is up to check_test, which knows the binary */
+    t->run = -1;
+    int check = t->link >= 0 ? sched_fn(s, check_test, tr, i) : -1;
+    if (check >= 0) sched_after(s, check, t->link);
+
+    t->report = check >= 0 ? sched_fn(s, report_test, tr, i) : -1;
+    int report = t->report;
+    if (report >= 0) {
+        sched_always(s, report);
+        sched_after(s, report, check);
+        if (prev_report >= 0) sched_after(s, report, prev_report);
+    }
+    return report;
+}
+
+/* queue compiling t's own file (its depfile comes with it), then linking,
+ * running and reporting it. output of each step is captured in out_dir */
+static int queue_test(Sched *s, TestRun *tr, int i, const char *prefix,
+                      const char *includes, const char *shared_objs,
+                      const char *ldflags, int shared_from, int shared_to,
+                      int prev_report, Arena *arena) {
+    TestJob *t = &tr->tests[i];
+    const char *base = arena_printf(arena, "%s/%s", tr->out_dir, t->name);
+    t->objs = arena_alloc(arena, sizeof(char *));
+    t->objs[0] = arena_printf(arena, "%s.o", base);
+    t->obj_count = 1;
+
+    StrBuf cmd;
+    strbuf_init(&cmd);
+    strbuf_printf(&cmd, "%s %s'%s' -MMD -c -o '%s.o' > '%s.log' 2>&1",
+                  prefix, includes, t->file, base, base);
+    t->compile = sched_cmd(s, cmd.data, NULL);
+    strbuf_free(&cmd);
+    if (t->compile < 0) return -1;
+
+    int report = queue_link(s, tr, i, prefix, shared_objs, ldflags,
+                            shared_from, shared_to, prev_report);
+    if (t->link >= 0) sched_after(s, t->link, t->compile);
+    return report;
+}
+
+/* queue the harness runner as test i: compile every file of cases and
+ * the runner's main, each to its own object and log, and link them into
+ * one binary, so N files of cases cost one link rather than N */
+static int queue_runner(Sched *s, TestRun *tr, int i, const StrList *files,
+                        const char *prefix, const char *includes,
+                        const char *shared_objs, const char *ldflags,
+                        int shared_from, int shared_to, int prev_report,
+                        Arena *arena) {
+    TestJob *t = &tr->tests[i];
+    const char *dir = tr->out_dir;
+    t->objs = arena_alloc(arena, (files->count + 1) * sizeof(char *));
+    t->obj_count = files->count + 1;
+
+    int first = sched_size(s);
+    StrBuf cmd;
+    for (int j = 0; j <= files->count; j++) {
+        char stem[128];
+        const char *src = j < files->count
+                        ? files->items[j]
+                        : arena_printf(arena, "%s/%s_main.c", dir, t->name);
+        test_name(src, stem, sizeof(stem));
+        t->objs[j] = arena_printf(arena, "%s/%s.o", dir, stem);
+        strbuf_init(&cmd);
+        strbuf_printf(&cmd, "%s %s'%s' -MMD -c -o '%s' > '%s/%s.log' 2>&1",
+                      prefix, includes, src, t->objs[j], dir,
+                      j < files->count ? stem : t->name);
+        t->compile = sched_cmd(s, cmd.data, NULL);
+        strbuf_free(&cmd);
+        if (t->compile < 0) return -1;
+    }
+    int last = sched_size(s);
+
+    int report = queue_link(s, tr, i, prefix, shared_objs, ldflags,
+                            shared_from, shared_to, prev_report);
+    if (t->link >= 0) sched_after_range(s, t->link, first, last);
+    return report;
+}
+
+/* what tests and benchmarks link besides their own files: the project's
+ * sources but main.c, generated sources and package sources, into srcs.
+ * includes and ldflags get the build's, so objects the build left behind
+ * link as they are. returns the compile command prefix. loading package
+ * configs overwrites custom_data, so the caller keeps its own cc */
+const char *linked_sources(const Config *cfg, int release,
+                           const char *build_dir, const char *pkg_dir,
+                           const char *config_file, const CConfig *cc,
+                           StrList *srcs, StrBuf *includes,
+                           StrBuf *ldflags, Arena *arena,
+                           GooseFramework *fw) {
+    StrList src_files, pkg_files;
+    strlist_init(&src_files, arena);
+    strlist_init(&pkg_files, arena);
+    fs_collect_sources(cfg->src_dir, &src_files);
+    char gen_dir[1024];
+    snprintf(gen_dir, sizeof(gen_dir), "%s/gen", build_dir);
+    int has_gen = fs_exists(gen_dir);
+    if (has_gen)
+        fs_collect_sources(gen_dir, &src_files);
+    build_collect_pkg_sources(cfg, pkg_dir, config_file, &pkg_files, fw);
+    for (int i = 0; i < src_files.count + pkg_files.count; i++) {
+        const char *src = i < src_files.count
+                        ? src_files.items[i]
+                        : pkg_files.items[i - src_files.count];
+        const char *base = strrchr(src, '/');
+        base = base ? base + 1 : src;
+        if (i < src_files.count && strcmp(base, "main.c") == 0) continue;
+        strlist_push(srcs, src);
+    }
+
+    StrBuf pkg_defines;
+    strbuf_init(&pkg_defines);
+    build_include_flags(cfg, pkg_dir, config_file, includes, fw);
+    if (has_gen)
+        strbuf_printf(includes, "-I%s ", gen_dir);
+    collect_pkg_defines(cfg, pkg_dir, config_file, &pkg_defines, fw);
+    const char *prefix = compile_prefix(cc, pkg_defines.data, release, arena);
+    strbuf_free(&pkg_defines);
+
+    if (strlen(cc->ldflags) > 0)
+        strbuf_printf(ldflags, " %s", cc->ldflags);
+    for (int pi = 0; pi < cfg->dep_count; pi++) {
+        char base[512];
+        build_dep_base(&cfg->deps[pi], pkg_dir, base, sizeof(base));
+        char plp[1024];
+        snprintf(plp, sizeof(plp), "%s/%s", base, config_file);
+        if (!fs_exists(plp)) continue;
+        Config pc;
+        if (config_load(plp, &pc, fw) == 0) {
+            config_free(&pc);
+            CConfig *pcc = (CConfig *)fw->custom_data;
+            if (strlen(pcc->ldflags) > 0)
+                strbuf_printf(ldflags, " %s", pcc->ldflags);
+        }
+    }
+    return prefix;
+}
+
+void shared_objs_init(SharedObjs *so, const char *build_dir,
+                      int release, const char *prefix,
+                      const char *includes, Arena *arena) {
+    so->build_obj = arena_printf(arena, "%s/%s/obj", build_dir,
+                                 release ? "release" : "debug");
+    so->test_obj = arena_printf(arena, "%s/%s/test-obj", build_dir,
+                                release ? "release" : "debug");
+    flags_key(prefix, includes, so->key);
+    so->build_match = flags_match(so->build_obj, so->key);
+    if (!flags_match(so->test_obj, so->key) && fs_exists(so->test_obj))
+        fs_rmrf(so->test_obj);
+    strlist_init(&so->objs, arena);
+    strbuf_init(&so->quoted);
+    so->from = so->to = -1;
+    so->compiled = so->reused = 0;
+}
+
+/* queue compiling what has no fresh object yet. returns -1 if a job
+ * cannot be queued */
+int shared_objs_queue(SharedObjs *so, Sched *s, const StrList *srcs,
+                      const char *prefix, const char *includes,
+                      Arena *arena) {
+    so->from = sched_size(s);
+    int rc = 0;
+    for (int i = 0; i < srcs->count; i++) {
+        const char *src = srcs->items[i];
+        const char *obj = so->build_match
+                        ? object_path(arena, so->build_obj, src, NULL)
+                        : NULL;
+        if (obj && object_fresh(obj)) {
+            so->reused++;
+        } else {
+            obj = object_path(arena, so->test_obj, src, NULL);
+            if (object_fresh(obj)) {
+                so->reused++;
+            } else {
+                if (queue_compile(s, prefix, includes, src, obj,
+                                  arena) < 0) {
+                    rc = -1;
+                    break;
+                }
+                so->compiled++;
+            }
+        }
+        strlist_push(&so->objs, obj);
+        strbuf_printf(&so->quoted, "'%s' ", obj);
+    }
+    so->to = sched_size(s);
+    return rc;
+}
+
+/* once the scheduler ran: whether every object got built, in which case
+ * test-obj is marked as built with these flags */
+int shared_objs_built(SharedObjs *so, const Sched *s) {
+    for (int j = so->from; j < so->to; j++)
+        if (sched_status(s, j) != SCHED_DONE) return 0;
+    if (so->compiled > 0) flags_write(so->test_obj, so->key);
+    return 1;
+}
+
+void shared_objs_report(const SharedObjs *so, const char *what) {
+    if (so->compiled > 0)
+        info("Compiling", "%d source%s shared by the %s", so->compiled,
+             so->compiled == 1 ? "" : "s", what);
+    if (so->reused > 0)
+        info("Reusing", "%d object%s from earlier builds", so->reused,
+             so->reused == 1 ? "" : "s");
+}
+
+/* whether a test file holds TEST cases for the runner rather than a main */
+static int has_cases(const char *file) {
+    FILE *f = fopen(file, "r");
+    if (!f) return 0;
+    char line[1024];
+    int found = 0;
+    while (!found && fgets(line, sizeof(line), f))
+        found = line[strspn(line, " \t")] == '#' &&
+                strstr(line, "include") && strstr(line, "goose_test.h");
+    fclose(f);
+    return found;
+}
+
+/* what one goose test covers and where it writes, threaded through its
+ * steps: select the tests, build them, run them, report them */
+typedef struct {
+    const char *out_dir;
+    const char *timings_path;   /* durations, for --shard to balance by */
+    const char *results;        /* results.tsv, or one per shard */
+    const char *json;
+    const char *src_dep;        /* what the shared objects come from */
+    StrList files;              /* tests with a main of their own */
+    StrList case_files;         /* files of TEST cases, for the runner */
+    int selected;               /* tests --filter left, before --shard */
+    Timings timings;
+    /* what the build links into every test */
+    const char *prefix;
+    StrList shared_srcs;
+    StrBuf includes;
+    StrBuf ldflags;
+    /* --affected and --impacted */
+    const ChangeSet *changes;
+    int impacted;
+    int run_all;
+    int queued;                 /* jobs in the TestRun, the runner too */
+    int skipped;
+    int runner;                 /* the runner's job, or -1 */
+} TestPlan;
+
+/* the test files --filter and --shard leave. returns how many test files
+ * there are before either, 0 after saying there are none */
+static int select_tests(TestPlan *p, const char *test_dir,
+                        const GooseFramework *fw, Arena *arena) {
+    StrList test_files;
+    strlist_init(&test_files, arena);
+    fs_collect_sources(test_dir, &test_files);
+    qsort(test_files.items, test_files.count, sizeof(char *), cmp_str);
+    if (test_files.count == 0) {
+        warn("Test", "no test files found in %s/", test_dir);
+        return 0;
+    }
+
+    /* files of TEST cases all go into the runner, which filters and
+     * shards by case itself */
+    strlist_init(&p->files, arena);
+    strlist_init(&p->case_files, arena);
+    for (int i = 0; i < test_files.count; i++)
+        strlist_push(has_cases(test_files.items[i]) ? &p->case_files
+                                                     : &p->files,
+                     test_files.items[i]);
+
+    /* --filter, then --shard over what is left, so every shard sees the
+     * same list */
+    timings_load(p->timings_path, &p->timings, arena);
+    if (fw->test_filter) {
+        StrList matched;
+        strlist_init(&matched, arena);
+        for (int i = 0; i < p->files.count; i++) {
+            char name[128];
+            test_name(p->files.items[i], name, sizeof(name));
+            if (fnmatch(fw->test_filter, name, 0) == 0)
+                strlist_push(&matched, p->files.items[i]);
+        }
+        p->files = matched;
+    }
+    p->selected = p->files.count;
+    if (fw->shard_count > 0) {
+        int balanced = shard_tests(&p->files, fw->shard_index,
+                                   fw->shard_count, &p->timings, arena);
+        info("Shard", "%d/%d: %d of %d tests (%s)", fw->shard_index,
+             fw->shard_count, p->files.count, p->selected,
+             balanced ? "balanced by recorded durations" : "by name");
+    }
+    if (fw->test_filter && p->selected == 0 && p->case_files.count == 0)
+        warn("Test", "no test matches %s", fw->test_filter);
+    return test_files.count;
+}
+
+/* of the selected tests, the ones a change reaches, into tr->tests; with
+ * no --affected or --impacted, all of them. the runner counts as one
+ * test, reached through any of its files or what it links */
+static void select_changed(TestPlan *p, TestRun *tr, const Config *cfg,
+                           const char *config_file, Arena *arena) {
+    const ChangeSet *changes = p->changes;
+    const char *prefix = p->prefix, *includes = p->includes.data;
+    int impacted = p->impacted;
+
+    /* every test links the project and package sources, so a change to
+     * those (sources.d), a new source or the config reruns them all.
+     * otherwise a test runs when its own depfile lists a changed file.
+     * --impacted goes by what each test was linked from (its .impact
+     * file), so a source or header only some tests reach no longer runs
+     * them all. a config still does, as it sets every flag */
+    p->run_all = 1;
+    if (changes) {
+        StrBuf linked;
+        strbuf_init(&linked);
+        for (int i = 0; i < p->shared_srcs.count; i++)
+            strbuf_printf(&linked, "'%s' ", p->shared_srcs.items[i]);
+        p->run_all = changes_has(changes, config_file) ||
+                     (!impacted &&
+                      (changes_under_ext(changes, cfg->src_dir, ".c") ||
+                       deps_changed(changes, prefix, includes, linked.data,
+                                    "sources", p->src_dep)));
+        strbuf_free(&linked);
+        for (int i = 0; i < cfg->dep_count && !p->run_all; i++) {
+            if (!cfg->deps[i].path[0]) continue;
+            const char *dep_cfg = arena_printf(arena, "%s/%s",
+                                               cfg->deps[i].path,
+                                               config_file);
+            p->run_all = changes_has(changes, dep_cfg) ||
+                         (!impacted &&
+                          changes_under_ext(changes, cfg->deps[i].path,
+                                            ".c"));
+        }
+    }
+
+    for (int t = 0; t < p->files.count; t++) {
+        TestJob *tj = &tr->tests[p->queued];
+        memset(tj, 0, sizeof(*tj));
+        tj->file = p->files.items[t];
+        test_name(tj->file, tj->name, sizeof(tj->name));
+
+        if (!p->run_all && impacted) {
+            /* with no record yet the test runs, and gets one */
+            const char *impact = arena_printf(arena, "%s/%s.impact",
+                                              p->out_dir, tj->name);
+            if (!changes_has(changes, tj->file) &&
+                changes_depfile(changes, impact) == 0) {
+                p->skipped++;
+                continue;
+            }
+        } else if (!p->run_all) {
+            const char *depfile = arena_printf(arena, "%s/%s.d",
+                                               p->out_dir, tj->name);
+            const char *quoted = arena_printf(arena, "'%s'", tj->file);
+            if (!changes_has(changes, tj->file) &&
+                !deps_changed(changes, prefix, includes, quoted, tj->name,
+                              depfile)) {
+                p->skipped++;
+                continue;
+            }
+        }
+        p->queued++;
+    }
+
+    p->runner = -1;
+    if (p->case_files.count == 0) return;
+    int selected = p->run_all;
+    if (!p->run_all && impacted)
+        selected = changes_depfile(changes,
+                                   arena_printf(arena, "%s/%s.impact",
+                                                p->out_dir,
+                                                C_TEST_RUNNER)) != 0;
+    for (int i = 0; !selected && i < p->case_files.count; i++) {
+        const char *file = p->case_files.items[i];
+        char stem[128];
+        test_name(file, stem, sizeof(stem));
+        selected = changes_has(changes, file) ||
+                   (!impacted &&
+                    deps_changed(changes, prefix, includes,
+                                 arena_printf(arena, "'%s'", file), stem,
+                                 arena_printf(arena, "%s/%s.d", p->out_dir,
+                                              stem)));
+    }
+    if (!selected) {
+        p->skipped++;
+        return;
+    }
+    p->runner = p->queued++;
+    TestJob *tj = &tr->tests[p->runner];
+    memset(tj, 0, sizeof(*tj));
+    tj->file = p->case_files.items[0];
+    tj->runner = 1;
+    snprintf(tj->name, sizeof(tj->name), "%s", C_TEST_RUNNER);
+}
+
+/* write goose_test.h where the runner's files find it, with the runner's
+ * main next to them, and set the runner's options. returns the include
+ * flags tests compile with, or NULL if the harness cannot be written */
+static const char *prepare_runner(const TestPlan *p, TestRun *tr,
+                                  const Sched *s, const GooseFramework *fw,
+                                  Arena *arena) {
+    const char *inc_dir = arena_printf(arena, "%s/include", p->out_dir);
+    const char *cases_dir = arena_printf(arena, "%s/cases", p->out_dir);
+    fs_mkdir(inc_dir);
+    fs_mkdir(cases_dir);
+    int written =
+        fs_write_file(arena_printf(arena, "%s/goose_test.h", inc_dir),
+                      c_test_harness) == 0 &&
+        fs_write_file(arena_printf(arena, "%s/%s_main.c", p->out_dir,
+                                   C_TEST_RUNNER),
+                      "#define GOOSE_TEST_RUNNER\n"
+                      "#include \"goose_test.h\"\n") == 0;
+    if (!written) {
+        err("cannot write the test harness to %s", p->out_dir);
+        return NULL;
+    }
+
+    StrBuf args;
+    strbuf_init(&args);
+    strbuf_printf(&args, "--dir '%s' --report '%s/%s.cases' -j %d ",
+                  cases_dir, p->out_dir, C_TEST_RUNNER, sched_jobs(s));
+    if (tr->timeout > 0)
+        strbuf_printf(&args, "--timeout %g ", tr->timeout);
+    if (fw->test_filter)
+        strbuf_printf(&args, "--filter '%s' ", fw->test_filter);
+    if (fw->shard_count > 0)
+        strbuf_printf(&args, "--shard %d/%d ", fw->shard_index,
+                      fw->shard_count);
+    tr->tests[p->runner].args = arena_strdup(arena, args.data);
+    strbuf_free(&args);
+    return arena_printf(arena, "%s-I%s ", p->includes.data, inc_dir);
+}
+
+/* queue the shared objects, then every selected test after them.
+ * returns -1 if something cannot be written or queued */
+static int build_tests(const TestPlan *p, TestRun *tr, SharedObjs *so,
+                       Sched *s, const GooseFramework *fw, Arena *arena) {
+    const char *includes = p->includes.data;
+    if (p->runner >= 0 &&
+        !(includes = prepare_runner(p, tr, s, fw, arena)))
+        return -1;
+
+    if (p->queued > 0 &&
+        shared_objs_queue(so, s, &p->shared_srcs, p->prefix,
+                          p->includes.data, arena) != 0)
+        return -1;
+
+    int report = -1;
+    for (int i = 0; i < p->queued; i++) {
+        if (i == p->runner)
+            report = queue_runner(s, tr, i, &p->case_files, p->prefix,
+                                  includes, so->quoted.data,
+                                  p->ldflags.data, so->from, so->to,
+                                  report, arena);
+        else
+            report = queue_test(s, tr, i, p->prefix, includes,
+                                so->quoted.data, p->ldflags.data,
+                                so->from, so->to, report, arena);
+        if (report < 0) {
+            err("cannot queue test: %s", tr->tests[i].name);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* run what build_tests queued, then keep what later runs go by: each
+ * test's .impact file, and what the shared objects were built from
+ * (sources.d) for --affected. test-obj is kept only for these flags. a
+ * missing depfile leaves sources.d to be recorded the next time it is
+ * needed */
+static void run_tests(const TestPlan *p, TestRun *tr, SharedObjs *so,
+                      Sched *s, Arena *arena) {
+    sched_run(s);
+    if (p->queued == 0) return;
+    record_impact(tr, p->queued, s, &so->objs, arena);
+    if (!shared_objs_built(so, s)) return;
+
+    StrBuf deps;
+    strbuf_init(&deps);
+    int complete = 1;
+    for (int i = 0; complete && i < so->objs.count; i++) {
+        char *dep = arena_strdup(arena, so->objs.items[i]);
+        dep[strlen(dep) - 1] = 'd';
+        FILE *f = fopen(dep, "r");
+        if (!f) {
+            complete = 0;
+            break;
+        }
+        char buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf) - 1, f)) > 0) {
+            buf[n] = '\0';
+            strbuf_printf(&deps, "%s", buf);
+        }
+        fclose(f);
+    }
+    if (!complete || fs_write_file(p->src_dep, deps.data) != 0)
+        remove(p->src_dep);
+    strbuf_free(&deps);
+}
+
+/* write the results files, unless the tests could not be built, and sum
+ * the run up. returns how many tests failed */
+static int report_tests(TestPlan *p, const TestRun *tr, int failed_setup,
+                        const Config *cfg, const GooseFramework *fw,
+                        Arena *arena) {
+    if (!failed_setup) {
+        const char *shard = NULL;
+        if (fw->shard_count > 0)
+            shard = arena_printf(arena, "%d/%d", fw->shard_index,
+                                 fw->shard_count);
+        write_results(tr, p->queued, p->results,
+                      shard ? NULL : p->timings_path, &p->timings);
+        write_json(tr, p->queued, p->json, cfg->name, shard);
+    }
+    int passed = tr->passed, failed = tr->failed + failed_setup;
+
+    printf("\n");
+    report_slowest(tr, p->queued, arena);
+    if (tr->cached > 0)
+        info("Cached", "%d passing test%s unchanged, not run again "
+             "(--no-cache runs them)", tr->cached,
+             tr->cached == 1 ? "" : "s");
+    if (p->skipped > 0)
+        info(p->impacted ? "Impacted" : "Affected",
+             "%d of %d tests, %d unchanged since %s", p->queued,
+             p->queued + p->skipped, p->skipped, p->changes->since);
+    info("Results", "%d passed, %d failed, %d total",
+         passed, failed, passed + failed);
+    return failed;
+}
+
+int c_test(const Config *cfg, int release, const char *build_dir,
+           const char *pkg_dir, const char *config_file, const char *test_dir,
+           void *userdata) {
+    GooseFramework *fw = (GooseFramework *)userdata;
+    CConfig cc = *(CConfig *)fw->custom_data;
+
+    if (!fs_exists(test_dir)) {
+        err("no %s/ directory found", test_dir);
+        return 1;
+    }
+
+    Arena *arena = arena_new();
+    TestPlan p;
+    memset(&p, 0, sizeof(p));
+    p.out_dir = arena_printf(arena, "%s/test", build_dir);
+    p.timings_path = arena_printf(arena, "%s/timings", p.out_dir);
+    p.src_dep = arena_printf(arena, "%s/sources.d", p.out_dir);
+    if (fw->shard_count > 0) {
+        p.results = arena_printf(arena, "%s/results-%d-of-%d.tsv", p.out_dir,
+                                 fw->shard_index, fw->shard_count);
+        p.json = arena_printf(arena, "%s/results-%d-of-%d.json", p.out_dir,
+                              fw->shard_index, fw->shard_count);
+    } else {
+        p.results = arena_printf(arena, "%s/results.tsv", p.out_dir);
+        p.json = arena_printf(arena, "%s/results.json", p.out_dir);
+    }
+    p.changes = fw->changes;
+    p.impacted = p.changes && fw->test_impacted;
+
+    if (select_tests(&p, test_dir, fw, arena) == 0) {
+        arena_destroy(arena);
+        return 0;
+    }
+    if (build_transpile(cfg, build_dir) != 0) {
+        arena_destroy(arena);
+        return 1;
+    }
+
+    /* the same compiler command and include paths as the build, so the
+     * build's objects can be linked into tests as they are */
+    strlist_init(&p.shared_srcs, arena);
+    strbuf_init(&p.includes);
+    strbuf_init(&p.ldflags);
+    p.prefix = linked_sources(cfg, release, build_dir, pkg_dir, config_file,
+                              &cc, &p.shared_srcs, &p.includes, &p.ldflags,
+                              arena, fw);
+
+    info("Testing", "%s v%s", cfg->name, cfg->version);
+    fs_mkdir(build_dir);
+    fs_mkdir(p.out_dir);
+
+    /* compile and run up to -j tests at a time */
+    TestRun tr;
+    memset(&tr, 0, sizeof(tr));
+    tr.tests = arena_alloc(arena, (p.files.count + 2) * sizeof(TestJob));
+    tr.arena = arena;
+    tr.out_dir = p.out_dir;
+    tr.bin_dir = arena_printf(arena, "%s/bin", p.out_dir);
+    fs_mkdir(tr.bin_dir);
+    tr.timeout = cfg->test_timeout;
+    tr.cfg = cfg;
+    tr.no_cache = fw->no_test_cache;
+    select_changed(&p, &tr, cfg, config_file, arena);
+
+    /* the shared sources are compiled once and linked into every test */
+    SharedObjs so;
+    shared_objs_init(&so, build_dir, release, p.prefix, p.includes.data,
+                     arena);
+    Sched *s = sched_new(fw->jobs);
+    int failed_setup = 1;
+    if (!s) {
+        err("out of memory");
+    } else {
+        sched_keep_going(s);
+        failed_setup = build_tests(&p, &tr, &so, s, fw, arena) != 0;
+    }
+    shared_objs_report(&so, "tests");
+    if (!failed_setup) run_tests(&p, &tr, &so, s, arena);
+    sched_free(s);
+
+    int failed = report_tests(&p, &tr, failed_setup, cfg, fw, arena);
+
+    strbuf_free(&p.includes);
+    strbuf_free(&p.ldflags);
+    strbuf_free(&so.quoted);
+    arena_destroy(arena);
+    *(CConfig *)fw->custom_data = cc;
+    return failed > 0 ? 1 : 0;
+}
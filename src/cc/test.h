@@ -0,0 +1,71 @@
+#ifndef GOOSE_CC_TEST_H
+#define GOOSE_CC_TEST_H
+
+#include <stddef.h>
+#include "config.h"
+#include "../headers/config.h"
+#include "../headers/framework.h"
+#include "../headers/sched.h"
+#include "../headers/sha256.h"
+
+/* goose test: build the tests in test_dir and run them */
+int c_test(const Config *cfg, int release, const char *build_dir,
+           const char *pkg_dir, const char *config_file, const char *test_dir,
+           void *userdata);
+
+/* what goose bench shares with goose test: the names and logs of
+ * what it runs, and the objects it links */
+
+/* copy a captured log to stdout */
+void print_file(const char *path);
+
+/* the name a test or benchmark file runs under: its file name without
+ * extension */
+void test_name(const char *file, char *out, size_t size);
+
+/* s as a JSON string, quotes included */
+void json_string(StrBuf *out, const char *s);
+
+/* what tests and benchmarks link besides their own files: the project's
+ * sources but main.c, generated sources and package sources, into srcs.
+ * includes and ldflags get the build's, so objects the build left behind
+ * link as they are. returns the compile command prefix. loading package
+ * configs overwrites custom_data, so the caller keeps its own cc */
+const char *linked_sources(const Config *cfg, int release,
+                           const char *build_dir, const char *pkg_dir,
+                           const char *config_file, const CConfig *cc,
+                           StrList *srcs, StrBuf *includes,
+                           StrBuf *ldflags, Arena *arena,
+                           GooseFramework *fw);
+
+/* the objects of the linked sources. one the build left behind with the
+ * same flags is taken as it is while it is newer than everything it was
+ * built from; the rest go to test-obj, which keeps them for the next
+ * run of goose test or goose bench */
+typedef struct {
+    const char *build_obj;
+    const char *test_obj;
+    char key[SHA256_HEX_LEN];
+    int build_match;
+    StrList objs;
+    StrBuf quoted;      /* objs, quoted for a command line */
+    int from, to;       /* the jobs compiling them */
+    int compiled;
+    int reused;
+} SharedObjs;
+
+void shared_objs_init(SharedObjs *so, const char *build_dir,
+                      int release, const char *prefix,
+                      const char *includes, Arena *arena);
+
+/* queue compiling what has no fresh object yet. returns -1 if a job
+ * cannot be queued */
+int shared_objs_queue(SharedObjs *so, Sched *s, const StrList *srcs,
+                      const char *prefix, const char *includes,
+                      Arena *arena);
+
+/* once the scheduler ran: whether every object got built */
+int shared_objs_built(SharedObjs *so, const Sched *s);
+void shared_objs_report(const SharedObjs *so, const char *what);
+
+#endif
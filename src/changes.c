@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "headers/changes.h"
+#include "headers/color.h"
+
+/* absolute form of path for comparing against git's output. a deleted file
+ * has no realpath of its own, so its directory's is used */
+static void abs_path(const char *path, char *out, size_t size) {
+    char rp[4096];
+    if (realpath(path, rp)) {
+        snprintf(out, size, "%s", rp);
+        return;
+    }
+
+    char dir[4096];
+    snprintf(dir, sizeof(dir), "%s", path);
+    char *slash = strrchr(dir, '/');
+    const char *base = path;
+    if (slash) {
+        *slash = '\0';
+        base = path + (slash - dir) + 1;
+        if (!dir[0]) snprintf(dir, sizeof(dir), "/");
+    } else {
+        snprintf(dir, sizeof(dir), ".");
+    }
+    if (realpath(dir, rp)) {
+        snprintf(out, size, "%s%s%s", rp, strcmp(rp, "/") ? "/" : "", base);
+        return;
+    }
+    snprintf(out, size, "%s", path);
+}
+
+/* run cmd and add each output line, prefixed with top/, to the set */
+static int collect(ChangeSet *c, const char *cmd, const char *top) {
+    FILE *p = popen(cmd, "r");
+    if (!p) return -1;
+    char line[4096];
+    while (fgets(line, sizeof(line), p)) {
+        line[strcspn(line, "\n")] = '\0';
+        if (!line[0]) continue;
+        char path[8192];
+        snprintf(path, sizeof(path), "%s/%s", top, line);
+        if (!strlist_contains(&c->paths, path))
+            strlist_push(&c->paths, path);
+    }
+    return pclose(p) == 0 ? 0 : -1;
+}
+
+int changes_since(const char *rev, ChangeSet *out) {
+    memset(out, 0, sizeof(*out));
+    snprintf(out->since, sizeof(out->since), "%s", rev);
+
+    char top[4096] = "";
+    FILE *p = popen("git rev-parse --show-toplevel 2>/dev/null", "r");
+    if (p) {
+        if (!fgets(top, sizeof(top), p)) top[0] = '\0';
+        pclose(p);
+    }
+    top[strcspn(top, "\n")] = '\0';
+    if (!top[0]) {
+        err("--affected needs a git checkout");
+        return -1;
+    }
+
+    char cmd[8192];
+    snprintf(cmd, sizeof(cmd),
+             "git rev-parse --verify --quiet '%s^{commit}' >/dev/null", rev);
+    if (system(cmd) != 0) {
+        err("unknown revision: %s", rev);
+        return -1;
+    }
+
+    out->arena = arena_new();
+    strlist_init(&out->paths, out->arena);
+
+    /* committed and uncommitted changes, both sides of a rename, and new
+     * files git does not know about yet */
+    snprintf(cmd, sizeof(cmd),
+             "git diff --name-only --no-renames '%s' -- 2>/dev/null", rev);
+    int rc = collect(out, cmd, top);
+    if (rc == 0)
+        rc = collect(out, "git ls-files --others --exclude-standard "
+                          "--full-name 2>/dev/null", top);
+    if (rc != 0) {
+        err("cannot list changes since %s", rev);
+        changes_free(out);
+        return -1;
+    }
+    return 0;
+}
+
+void changes_free(ChangeSet *c) {
+    if (c->arena) arena_destroy(c->arena);
+    memset(c, 0, sizeof(*c));
+}
+
+int changes_has(const ChangeSet *c, const char *path) {
+    char abs[4096];
+    abs_path(path, abs, sizeof(abs));
+    return strlist_contains(&c->paths, abs);
+}
+
+int changes_under_ext(const ChangeSet *c, const char *dir, const char *ext) {
+    char abs[4096];
+    abs_path(dir, abs, sizeof(abs));
+    size_t n = strlen(abs);
+    size_t elen = ext ? strlen(ext) : 0;
+    for (int i = 0; i < c->paths.count; i++) {
+        const char *f = c->paths.items[i];
+        size_t flen = strlen(f);
+        if (strncmp(f, abs, n) != 0 || (f[n] != '/' && strcmp(abs, "/")))
+            continue;
+        if (elen && (flen < elen || strcmp(f + flen - elen, ext) != 0))
+            continue;
+        return 1;
+    }
+    return 0;
+}
+
+int changes_under(const ChangeSet *c, const char *dir) {
+    return changes_under_ext(c, dir, NULL);
+}
+
+int depfile_each(const char *depfile, int (*fn)(const char *, void *),
+                 void *ctx) {
+    FILE *f = fopen(depfile, "r");
+    if (!f) return -1;
+
+    /* "target: prereq prereq \" lines; a backslash also escapes spaces */
+    char tok[4096];
+    int len = 0, in_prereqs = 0, rc = 0, ch;
+    while (!rc && (ch = fgetc(f)) != EOF) {
+        if (ch == '\\') {
+            int next = fgetc(f);
+            if (next == '\n' || next == EOF) {
+                ch = ' ';
+            } else if (next == ' ') {
+                if (len < (int)sizeof(tok) - 1) tok[len++] = ' ';
+                continue;
+            } else {
+                ungetc(next, f);
+            }
+        }
+        if (ch == ':' && !in_prereqs) {
+            in_prereqs = 1;
+            len = 0;
+            continue;
+        }
+        if (ch == ' ' || ch == '\t' || ch == '\n') {
+            if (len && in_prereqs) {
+                tok[len] = '\0';
+                rc = fn(tok, ctx);
+            }
+            len = 0;
+            if (ch == '\n') in_prereqs = 0;
+            continue;
+        }
+        if (len < (int)sizeof(tok) - 1) tok[len++] = (char)ch;
+    }
+    if (!rc && len && in_prereqs) {
+        tok[len] = '\0';
+        rc = fn(tok, ctx);
+    }
+    fclose(f);
+    return rc;
+}
+
+static int prereq_changed(const char *prereq, void *ctx) {
+    return changes_has(ctx, prereq);
+}
+
+int changes_depfile(const ChangeSet *c, const char *depfile) {
+    return depfile_each(depfile, prereq_changed, (void *)c);
+}
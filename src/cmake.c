@@ -212,8 +212,6 @@ static int has_include(const Config *cfg, const char *path) {
 }
 
 static void add_include(Config *cfg, const char *path) {
-    if (cfg->include_count >= MAX_INCLUDES) return;
-
     /* skip absolute paths and cmake variables */
     if (path[0] == '/' || strstr(path, "${") != NULL)
         return;
@@ -229,8 +227,7 @@ static void add_include(Config *cfg, const char *path) {
     /* deduplicate after normalization */
     if (has_include(cfg, p)) return;
 
-    strncpy(cfg->includes[cfg->include_count], p, MAX_PATH_LEN - 1);
-    cfg->include_count++;
+    config_add_include(cfg, p);
 }
 
 /* append to ldflags, space-separated */
@@ -284,8 +281,6 @@ static void infer_src_dir(const char *src_file, char *dir, int dir_size) {
 
 /* add a source file to cfg->sources[] */
 static void add_source(Config *cfg, const char *prefix, const char *file) {
-    if (cfg->source_count >= MAX_SRC_FILES) return;
-
     /* skip non-.c files */
     const char *dot = strrchr(file, '.');
     if (!dot || strcmp(dot, ".c") != 0) return;
@@ -302,8 +297,7 @@ static void add_source(Config *cfg, const char *prefix, const char *file) {
             return;
     }
 
-    strncpy(cfg->sources[cfg->source_count], path, MAX_PATH_LEN - 1);
-    cfg->source_count++;
+    config_add_source(cfg, path);
 }
 
 /* ---- conditional evaluation ---- */
@@ -607,7 +601,7 @@ static int parse_cmake_file(const char *cmake_path, const char *base_dir,
                     char dir[MAX_PATH_LEN];
                     infer_src_dir(src, dir, sizeof(dir));
                     if (strcmp(dir, ".") != 0 && strcmp(cfg->src_dir, "src") == 0)
-                        strncpy(cfg->src_dir, dir, MAX_PATH_LEN - 1);
+                        config_set_src_dir(cfg, dir);
                 }
 
                 /* add source with base_dir prefix */
@@ -628,7 +622,7 @@ static int parse_cmake_file(const char *cmake_path, const char *base_dir,
                 char dir[MAX_PATH_LEN];
                 infer_src_dir(args[i], dir, sizeof(dir));
                 if (strcmp(dir, ".") != 0 && strcmp(cfg->src_dir, "src") == 0)
-                    strncpy(cfg->src_dir, dir, MAX_PATH_LEN - 1);
+                    config_set_src_dir(cfg, dir);
                 break;
             }
         }
@@ -802,6 +796,7 @@ int cmake_to_config(const char *cmake_path, Config *cfg, CmakeBuildInfo *bi) {
 
     if (parse_cmake_file(cmake_path, ".", cfg, &vt) != 0) {
         s_bi = NULL;
+        config_free(cfg);
         return -1;
     }
 
@@ -834,7 +829,10 @@ int cmake_convert_file(const char *cmake_path, const char *yaml_path) {
 
     /* write config with C-specific build fields */
     FILE *f = fopen(yaml_path, "w");
-    if (!f) return -1;
+    if (!f) {
+        config_free(&cfg);
+        return -1;
+    }
 
     fprintf(f, "project:\n");
     fprintf(f, "  name: \"%s\"\n", cfg.name);
@@ -859,5 +857,6 @@ int cmake_convert_file(const char *cmake_path, const char *yaml_path) {
     }
     fprintf(f, "\ndependencies:\n");
     fclose(f);
+    config_free(&cfg);
     return 0;
 }
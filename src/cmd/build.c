@@ -10,6 +10,7 @@
 #include "../headers/lock.h"
 #include "../headers/color.h"
 #include "../headers/fs.h"
+#include "../headers/workspace.h"
 
 static int parse_release(int argc, char **argv) {
     for (int i = 1; i < argc; i++) {
@@ -19,9 +20,255 @@ static int parse_release(int argc, char **argv) {
     return 0;
 }
 
-/* build a single member at member_dir, return 0 on success */
-static int build_member(const char *member_dir, int release,
-                        GooseFramework *fw) {
+/* -j N / --jobs N: parallel fetch and compile jobs */
+int cmd_parse_jobs(int argc, char **argv, GooseFramework *fw) {
+    for (int i = 1; i < argc; i++) {
+        const char *val = NULL;
+        if ((strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jobs") == 0) &&
+            i + 1 < argc)
+            val = argv[i + 1];
+        else if (strncmp(argv[i], "-j", 2) == 0 && argv[i][2])
+            val = argv[i] + 2;
+        if (!val) continue;
+
+        char *end;
+        long n = strtol(val, &end, 10);
+        if (*end || n < 1) {
+            err("invalid job count: %s", val);
+            return -1;
+        }
+        fw->jobs = (int)n;
+    }
+    return 0;
+}
+
+/* --affected (or test's --impacted) [--since <rev>]: work only on what
+ * changed since rev, HEAD (uncommitted changes) unless given. returns the
+ * revision, NULL when no flag is set */
+static const char *parse_affected(int argc, char **argv) {
+    const char *since = NULL;
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "--affected") == 0 ||
+             strcmp(argv[i], "--impacted") == 0) && !since)
+            since = "HEAD";
+        else if (strcmp(argv[i], "--since") == 0 && i + 1 < argc)
+            since = argv[++i];
+    }
+    return since;
+}
+
+/* --shard K/N, --filter <glob>, --no-cache and --impacted for goose
+ * test. returns -1 on a malformed shard */
+static int parse_test_select(int argc, char **argv, GooseFramework *fw) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-cache") == 0) {
+            fw->no_test_cache = 1;
+        } else if (strcmp(argv[i], "--impacted") == 0) {
+            fw->test_impacted = 1;
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            fw->test_filter = argv[++i];
+        } else if (strcmp(argv[i], "--shard") == 0 && i + 1 < argc) {
+            const char *val = argv[++i];
+            char *end;
+            long k = strtol(val, &end, 10), n = 0;
+            if (*end == '/') n = strtol(end + 1, &end, 10);
+            if (*end || k < 1 || n < 1 || k > n) {
+                err("invalid shard: %s (expected K/N with 1 <= K <= N)", val);
+                return -1;
+            }
+            fw->shard_index = (int)k;
+            fw->shard_count = (int)n;
+        }
+    }
+    return 0;
+}
+
+/* fetch the full dependency graph, sync the lock, and flatten every resolved
+ * package into cfg's dependency list so the build phase sees each one once */
+static int resolve_deps(Config *cfg, GooseFramework *fw, int save_lock) {
+    LockFile lf;
+    lock_load(fw->lock_file, &lf);
+
+    DepGraph g;
+    int rc = pkg_resolve(cfg, &lf, fw, &g);
+    if (rc == 0) {
+        if (save_lock) lock_save(fw->lock_file, &lf);
+        rc = dep_graph_flatten(&g, cfg);
+    }
+    dep_graph_free(&g);
+    lock_free(&lf);
+    return rc;
+}
+
+/* state shared by the jobs of one pipelined build. loading a package config
+ * overwrites custom_data, so the project's copy is put back before each
+ * consumer callback */
+typedef struct {
+    const Config *cfg;
+    int release;
+    GooseFramework *fw;
+    char custom_data[sizeof(((GooseFramework *)0)->custom_data)];
+} BuildPipeline;
+
+static void restore_project(BuildPipeline *bp) {
+    memcpy(bp->fw->custom_data, bp->custom_data, sizeof(bp->custom_data));
+}
+
+static int transpile_job(Sched *s, void *ctx, int arg) {
+    (void)s; (void)arg;
+    BuildPipeline *bp = ctx;
+    GooseFramework *fw = bp->fw;
+    restore_project(bp);
+    fw->on_transpile(bp->cfg, fw->build_dir, fw->userdata);
+    return 0;
+}
+
+static int schedule_job(Sched *s, void *ctx, int arg) {
+    (void)arg;
+    BuildPipeline *bp = ctx;
+    GooseFramework *fw = bp->fw;
+    restore_project(bp);
+    return fw->on_schedule(bp->cfg, bp->release, fw->build_dir, fw->pkg_dir,
+                           fw->config_file, s, fw->userdata);
+}
+
+static int pkg_ready(const Dependency *dep, Sched *s, void *ctx) {
+    BuildPipeline *bp = ctx;
+    GooseFramework *fw = bp->fw;
+    if (!fw->on_pkg_ready) return 0;
+    restore_project(bp);
+    return fw->on_pkg_ready(bp->cfg, dep, bp->release, fw->build_dir,
+                            fw->pkg_dir, fw->config_file, s, fw->userdata);
+}
+
+/* fetch, transpile and build the project in cwd. fetching, converting,
+ * transpiling and whatever the consumer queues all run on one scheduler,
+ * so project sources compile while packages are still being cloned, then
+ * on_build finishes the rest against the resolved graph. workspace members
+ * read the root's lock but leave writing it to the root */
+static int build_project(Config *cfg, int release, GooseFramework *fw,
+                         int save_lock) {
+    BuildPipeline bp;
+    bp.cfg = cfg;
+    bp.release = release;
+    bp.fw = fw;
+    memcpy(bp.custom_data, fw->custom_data, sizeof(bp.custom_data));
+
+    LockFile lf;
+    lock_load(fw->lock_file, &lf);
+
+    Sched *s = sched_new(fw->jobs);
+    DepGraph g;
+    memset(&g, 0, sizeof(g));
+    PkgResolve *r = NULL;
+    if (s)
+        r = pkg_resolve_start(cfg, &lf, fw, &g, s, pkg_ready, &bp);
+
+    int sched_rc = -1;
+    if (r) {
+        int t = -1;
+        if (fw->on_transpile)
+            t = sched_fn(s, transpile_job, &bp, 0);
+        if (fw->on_schedule) {
+            int plan = sched_fn(s, schedule_job, &bp, 0);
+            if (t >= 0) sched_after(s, plan, t);
+        }
+        sched_rc = sched_run(s);
+    }
+    restore_project(&bp);
+
+    int rc = pkg_resolve_finish(r, sched_rc);
+    if (rc == 0) {
+        if (save_lock) lock_save(fw->lock_file, &lf);
+        rc = dep_graph_flatten(&g, cfg);
+    }
+    dep_graph_free(&g);
+    lock_free(&lf);
+    sched_free(s);
+    if (rc != 0) return 1;
+
+    if (!fw->on_build) {
+        err("no build callback registered");
+        return 1;
+    }
+    return fw->on_build(cfg, release, fw->build_dir, fw->pkg_dir,
+                        fw->config_file, fw->userdata) != 0;
+}
+
+/* narrow the selection to members with a changed file and, since they
+ * build against those, the members depending on them. a change to the
+ * root config or lock reaches every member. returns how many remain */
+static int ws_affected(const WsGraph *g, const GooseFramework *fw,
+                       int *selected) {
+    const ChangeSet *c = fw->changes;
+    int all = changes_has(c, fw->config_file) || changes_has(c, fw->lock_file);
+
+    int *hit = calloc(g->n ? g->n : 1, sizeof(int));
+    if (!hit) {
+        err("out of memory");
+        return -1;
+    }
+    for (int i = 0; i < g->n; i++)
+        hit[i] = all || changes_under(c, g->dirs[i]);
+
+    for (int changed = 1; changed;) {
+        changed = 0;
+        for (int i = 0; i < g->n; i++) {
+            if (hit[i]) continue;
+            for (int j = 0; j < g->n; j++) {
+                if (g->dep[i * g->n + j] && hit[j]) {
+                    hit[i] = 1;
+                    changed = 1;
+                    break;
+                }
+            }
+        }
+    }
+
+    int count = 0;
+    for (int i = 0; i < g->n; i++) {
+        selected[i] = selected[i] && hit[i] ? 2 : 0;
+        if (selected[i]) count++;
+    }
+    free(hit);
+    return count;
+}
+
+/* resolve the dependencies of every member as one graph into the root's
+ * packages/ and lock, so each package is fetched once and all members
+ * build against the same revision */
+static int resolve_workspace(const Config *root, GooseFramework *fw) {
+    Config all;
+    if (pkg_workspace_deps(root, fw, &all) != 0)
+        return -1;
+
+    LockFile lf;
+    lock_load(fw->lock_file, &lf);
+
+    DepGraph g;
+    int rc = pkg_resolve(&all, &lf, fw, &g);
+    if (rc == 0)
+        lock_save(fw->lock_file, &lf);
+    dep_graph_free(&g);
+    lock_free(&lf);
+    config_free(&all);
+    return rc;
+}
+
+/* path under the workspace root, usable from inside a member */
+static void root_path(char *buf, size_t size, const char *root,
+                      const char *path) {
+    if (path[0] == '/')
+        snprintf(buf, size, "%s", path);
+    else
+        snprintf(buf, size, "%s/%s", root, path);
+}
+
+enum { WS_BUILD, WS_TEST, WS_RUN };
+
+/* build, test or run one member from inside its directory */
+static int member_action(const char *member_dir, int action, int release,
+                         GooseFramework *fw, int argc, char **argv) {
     char cwd[1024];
     if (!getcwd(cwd, sizeof(cwd))) {
         err("cannot read working directory");
@@ -36,21 +283,30 @@ static int build_member(const char *member_dir, int release,
     int rc = 1;
     Config cfg;
     if (config_load(fw->config_file, &cfg, fw) == 0) {
-        info("Building", "%s v%s (%s)", cfg.name, cfg.version,
-             release ? "release" : "debug");
-
-        LockFile lf;
-        lock_load(fw->lock_file, &lf);
-        if (pkg_fetch_all(&cfg, &lf, fw) == 0) {
-            lock_save(fw->lock_file, &lf);
-            if (fw->on_transpile)
-                fw->on_transpile(&cfg, fw->build_dir, fw->userdata);
-            if (fw->on_build)
-                rc = fw->on_build(&cfg, release, fw->build_dir, fw->pkg_dir,
-                                  fw->config_file, fw->userdata) != 0 ? 1 : 0;
+        if (action == WS_BUILD) {
+            info("Building", "%s v%s (%s)", cfg.name, cfg.version,
+                 release ? "release" : "debug");
+            rc = build_project(&cfg, release, fw, 0);
+        } else if (resolve_deps(&cfg, fw, 0) != 0) {
+            rc = 1;
+        } else if (action == WS_TEST && !fs_exists(fw->test_dir)) {
+            info("Skipping", "%s (no %s/)", cfg.name, fw->test_dir);
+            rc = 0;
+        } else if (action == WS_TEST) {
+            info("Testing", "%s", cfg.name);
+            if (fw->on_test)
+                rc = fw->on_test(&cfg, release, fw->build_dir, fw->pkg_dir,
+                                 fw->config_file, fw->test_dir, fw->userdata);
             else
-                err("no build callback registered");
+                err("no test callback registered");
+        } else {
+            if (fw->on_run)
+                rc = fw->on_run(&cfg, release, fw->build_dir, fw->pkg_dir,
+                                fw->config_file, argc, argv, fw->userdata);
+            else
+                err("no run callback registered");
         }
+        config_free(&cfg);
     }
 
     if (chdir(cwd) != 0) {
@@ -60,74 +316,106 @@ static int build_member(const char *member_dir, int release,
     return rc;
 }
 
-/* does member `a` depend (via a path: dep) on member `b`? */
-static int member_depends_on(const char *a_dir, const char *b_dir,
-                             const char *config_file, GooseFramework *fw) {
-    char cfg_path[1024];
-    snprintf(cfg_path, sizeof(cfg_path), "%s/%s", a_dir, config_file);
-    if (!fs_exists(cfg_path)) return 0;
+/* build or test the selected workspace members in dependency order, or
+ * run the one named with -p after building what it depends on. members
+ * share the root's packages/ and lock */
+static int workspace_each(const Config *root, int action, int release,
+                          GooseFramework *fw, int argc, char **argv) {
+    WsGraph g;
+    if (ws_graph_load(root, fw, &g) != 0)
+        return 1;
 
-    Config cfg;
-    if (config_load(cfg_path, &cfg, fw) != 0) return 0;
-
-    for (int i = 0; i < cfg.dep_count; i++) {
-        if (!cfg.deps[i].path[0]) continue;
-        char resolved[1024];
-        snprintf(resolved, sizeof(resolved), "%s/%s", a_dir, cfg.deps[i].path);
-        /* compare canonical paths */
-        char rp_a[1024], rp_b[1024];
-        const char *ca = realpath(resolved, rp_a) ? rp_a : resolved;
-        const char *cb = realpath(b_dir, rp_b) ? rp_b : b_dir;
-        if (strcmp(ca, cb) == 0) return 1;
+    int *selected = calloc(g.n ? g.n : 1, sizeof(int));
+    int *order = calloc(g.n ? g.n : 1, sizeof(int));
+    int named = -1, ordered = -1;
+    if (selected && order) {
+        named = ws_select(&g, argc, argv, selected);
+        if (named >= 0) ordered = ws_order(&g, selected, order);
+    } else {
+        err("out of memory");
     }
-    return 0;
-}
 
-/* build all workspace members in dependency order (topological by inter-member
- * path deps). returns 0 if every member built. */
-static int build_workspace(const Config *root, int release,
-                           GooseFramework *fw) {
-    int n = root->ws_member_count;
-    info("Workspace", "%d member%s", n, n == 1 ? "" : "s");
-
-    int built[MAX_WS_MEMBERS] = {0};
-    int order[MAX_WS_MEMBERS];
-    int ordered = 0;
-
-    /* repeatedly pick members whose member-deps are all already built */
-    for (int pass = 0; pass < n && ordered < n; pass++) {
-        int progress = 0;
-        for (int i = 0; i < n; i++) {
-            if (built[i]) continue;
-            int ready = 1;
-            for (int j = 0; j < n; j++) {
-                if (i == j || built[j]) continue;
-                if (member_depends_on(root->ws_members[i], root->ws_members[j],
-                                      fw->config_file, fw)) {
-                    ready = 0;
-                    break;
-                }
-            }
-            if (ready) {
-                order[ordered++] = i;
-                built[i] = 1;
-                progress = 1;
-            }
+    if (action == WS_RUN && named != 1 && named >= 0) {
+        err("run in a workspace needs one member: %s run -p <member>",
+            fw->tool_name);
+        ordered = -1;
+    }
+
+    /* --affected: only changed members and those that build on them; the
+     * members they depend on are compiled into them anyway */
+    if (fw->changes && action != WS_RUN && ordered >= 0) {
+        int count = ws_affected(&g, fw, selected);
+        if (count == 0) {
+            info("Affected", "no member changed since %s",
+                 fw->changes->since);
+            free(selected);
+            free(order);
+            ws_graph_free(&g);
+            return 0;
         }
-        if (!progress) break; /* cycle: fall back to declared order */
+        named = count;
+        ordered = count < 0 ? -1 : ws_order(&g, selected, order);
+    }
+
+    char cwd[1024];
+    if (ordered < 0 || !getcwd(cwd, sizeof(cwd)) ||
+        resolve_workspace(root, fw) != 0) {
+        free(selected);
+        free(order);
+        ws_graph_free(&g);
+        return 1;
     }
-    /* append any leftover (cycle) members in declared order */
-    for (int i = 0; i < n; i++) {
-        int seen = 0;
-        for (int k = 0; k < ordered; k++)
-            if (order[k] == i) { seen = 1; break; }
-        if (!seen) order[ordered++] = i;
+
+    if (named > 0)
+        info("Workspace", "%d of %d members", ordered, g.n);
+    else
+        info("Workspace", "%d member%s", g.n, g.n == 1 ? "" : "s");
+
+    /* members resolve against the root's packages and lock from their own
+     * directories */
+    char pkg_dir[sizeof(fw->pkg_dir)], lock_file[sizeof(fw->lock_file)];
+    memcpy(pkg_dir, fw->pkg_dir, sizeof(pkg_dir));
+    memcpy(lock_file, fw->lock_file, sizeof(lock_file));
+    root_path(fw->pkg_dir, sizeof(fw->pkg_dir), cwd, pkg_dir);
+    root_path(fw->lock_file, sizeof(fw->lock_file), cwd, lock_file);
+    root_path(fw->shared_build_dir, sizeof(fw->shared_build_dir), cwd,
+              fw->build_dir);
+
+    /* the program's own arguments: everything but the member selection */
+    char **run_argv = NULL;
+    int run_argc = 0;
+    if (action == WS_RUN && (run_argv = calloc(argc + 1, sizeof(char *)))) {
+        for (int i = 0; i < argc; i++) {
+            if ((strcmp(argv[i], "-p") == 0 ||
+                 strcmp(argv[i], "--package") == 0) && i + 1 < argc) {
+                i++;
+                continue;
+            }
+            run_argv[run_argc++] = argv[i];
+        }
     }
 
-    int failed = 0;
+    int failed = 0, rc = 0;
     for (int k = 0; k < ordered; k++) {
-        const char *m = root->ws_members[order[k]];
-        if (build_member(m, release, fw) == 0) {
+        const char *m = g.dirs[order[k]];
+        if (action == WS_RUN) {
+            /* the member being run is last: everything before it is a
+             * dependency to build */
+            if (selected[order[k]] != 2) {
+                if (member_action(m, WS_BUILD, release, fw, 0, NULL) != 0) {
+                    err("member failed: %s", m);
+                    rc = 1;
+                    break;
+                }
+                continue;
+            }
+            rc = run_argv ? member_action(m, WS_RUN, release, fw, run_argc,
+                                          run_argv)
+                          : 1;
+            break;
+        }
+
+        if (member_action(m, action, release, fw, 0, NULL) == 0) {
             info("Member", "%s ok", m);
         } else {
             err("member failed: %s", m);
@@ -135,41 +423,88 @@ static int build_workspace(const Config *root, int release,
         }
     }
 
-    info("Workspace", "%d ok, %d failed", ordered - failed, failed);
-    return failed > 0 ? 1 : 0;
+    memcpy(fw->pkg_dir, pkg_dir, sizeof(pkg_dir));
+    memcpy(fw->lock_file, lock_file, sizeof(lock_file));
+    fw->shared_build_dir[0] = '\0';
+
+    if (action != WS_RUN) {
+        info("Workspace", "%d ok, %d failed", ordered - failed, failed);
+        rc = failed > 0 ? 1 : 0;
+    }
+    free(run_argv);
+    free(selected);
+    free(order);
+    ws_graph_free(&g);
+    return rc;
+}
+
+/* -p outside a workspace root is a mistake worth saying out loud */
+static int reject_select(const Config *cfg, int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--package") == 0) {
+            err("-p selects workspace members, but %s is not a workspace",
+                cfg->name);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* the files changed since the --since revision, for fw->changes. returns
+ * -1 when they cannot be listed */
+static int load_changes(int argc, char **argv, ChangeSet *c) {
+    const char *since = parse_affected(argc, argv);
+    memset(c, 0, sizeof(*c));
+    if (!since) return 0;
+    return changes_since(since, c);
+}
+
+/* whether a change reaches the project in cwd: its own files or those of
+ * a path dependency, which is compiled from where it lies */
+static int project_changed(const Config *cfg, const ChangeSet *c) {
+    if (changes_under(c, "."))
+        return 1;
+    for (int i = 0; i < cfg->dep_count; i++)
+        if (cfg->deps[i].path[0] && changes_under(c, cfg->deps[i].path))
+            return 1;
+    return 0;
 }
 
 int cmd_build(int argc, char **argv, GooseFramework *fw) {
     int release = parse_release(argc, argv);
+    if (cmd_parse_jobs(argc, argv, fw) != 0)
+        return 1;
 
     Config cfg;
     if (config_load(fw->config_file, &cfg, fw) != 0)
         return 1;
 
-    if (cfg.ws_member_count > 0)
-        return build_workspace(&cfg, release, fw);
-
-    info("Building", "%s v%s (%s)", cfg.name, cfg.version,
-         release ? "release" : "debug");
-
-    LockFile lf;
-    lock_load(fw->lock_file, &lf);
-
-    if (pkg_fetch_all(&cfg, &lf, fw) != 0)
+    ChangeSet changes;
+    if (load_changes(argc, argv, &changes) != 0) {
+        config_free(&cfg);
         return 1;
+    }
+    fw->changes = changes.arena ? &changes : NULL;
 
-    lock_save(fw->lock_file, &lf);
-
-    if (fw->on_transpile)
-        fw->on_transpile(&cfg, fw->build_dir, fw->userdata);
-
-    if (!fw->on_build) {
-        err("no build callback registered");
-        return 1;
+    int rc = 1;
+    if (cfg.ws_member_count > 0) {
+        rc = workspace_each(&cfg, WS_BUILD, release, fw, argc, argv);
+    } else if (reject_select(&cfg, argc, argv) != 0) {
+        rc = 1;
+    } else if (fw->changes && !project_changed(&cfg, fw->changes)) {
+        info("Affected", "%s has not changed since %s", cfg.name,
+             changes.since);
+        rc = 0;
+    } else {
+        info("Building", "%s v%s (%s)", cfg.name, cfg.version,
+             release ? "release" : "debug");
+        rc = build_project(&cfg, release, fw, 1);
     }
 
-    return fw->on_build(&cfg, release, fw->build_dir, fw->pkg_dir,
-                        fw->config_file, fw->userdata) != 0;
+    fw->changes = NULL;
+    changes_free(&changes);
+    config_free(&cfg);
+    return rc;
 }
 
 int cmd_run(int argc, char **argv, GooseFramework *fw) {
@@ -179,24 +514,27 @@ int cmd_run(int argc, char **argv, GooseFramework *fw) {
     if (config_load(fw->config_file, &cfg, fw) != 0)
         return 1;
 
+    /* outside a workspace every argument belongs to the program */
+    if (cfg.ws_member_count > 0) {
+        int rc = workspace_each(&cfg, WS_RUN, release, fw, argc, argv);
+        config_free(&cfg);
+        return rc;
+    }
+
     info("Building", "%s v%s (%s)", cfg.name, cfg.version,
          release ? "release" : "debug");
 
-    LockFile lf;
-    lock_load(fw->lock_file, &lf);
-
-    if (pkg_fetch_all(&cfg, &lf, fw) != 0)
-        return 1;
-
-    lock_save(fw->lock_file, &lf);
-
-    if (!fw->on_run) {
-        err("no run callback registered");
-        return 1;
+    int rc = 1;
+    if (resolve_deps(&cfg, fw, 1) == 0) {
+        if (fw->on_run)
+            rc = fw->on_run(&cfg, release, fw->build_dir, fw->pkg_dir,
+                            fw->config_file, argc, argv, fw->userdata);
+        else
+            err("no run callback registered");
     }
 
-    return fw->on_run(&cfg, release, fw->build_dir, fw->pkg_dir,
-                      fw->config_file, argc, argv, fw->userdata);
+    config_free(&cfg);
+    return rc;
 }
 
 int cmd_clean(int argc, char **argv, GooseFramework *fw) {
@@ -214,24 +552,126 @@ int cmd_clean(int argc, char **argv, GooseFramework *fw) {
 
 int cmd_test(int argc, char **argv, GooseFramework *fw) {
     int release = parse_release(argc, argv);
+    if (cmd_parse_jobs(argc, argv, fw) != 0 ||
+        parse_test_select(argc, argv, fw) != 0)
+        return 1;
 
     Config cfg;
     if (config_load(fw->config_file, &cfg, fw) != 0)
         return 1;
 
-    LockFile lf;
-    lock_load(fw->lock_file, &lf);
-    if (pkg_fetch_all(&cfg, &lf, fw) != 0)
+    ChangeSet changes;
+    if (load_changes(argc, argv, &changes) != 0) {
+        config_free(&cfg);
+        return 1;
+    }
+    fw->changes = changes.arena ? &changes : NULL;
+
+    int rc = 1;
+    if (cfg.ws_member_count > 0) {
+        rc = workspace_each(&cfg, WS_TEST, release, fw, argc, argv);
+    } else if (reject_select(&cfg, argc, argv) != 0) {
+        rc = 1;
+    } else if (resolve_deps(&cfg, fw, 1) == 0) {
+        if (fw->on_test)
+            rc = fw->on_test(&cfg, release, fw->build_dir, fw->pkg_dir,
+                             fw->config_file, fw->test_dir, fw->userdata);
+        else
+            err("no test callback registered");
+    }
+
+    fw->changes = NULL;
+    fw->shard_index = fw->shard_count = 0;
+    fw->test_filter = NULL;
+    fw->no_test_cache = 0;
+    fw->test_impacted = 0;
+    changes_free(&changes);
+    config_free(&cfg);
+    return rc;
+}
+
+/* the options of goose bench only last for one run */
+static void bench_reset(GooseFramework *fw) {
+    fw->bench_filter = NULL;
+    fw->bench_time = 0;
+    fw->bench_baseline = NULL;
+    fw->bench_save_baseline = NULL;
+    fw->bench_fail_above = 0;
+    fw->bench_counters = 0;
+}
+
+int cmd_bench(int argc, char **argv, GooseFramework *fw) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            fw->bench_filter = argv[++i];
+        } else if (strcmp(argv[i], "--time") == 0 && i + 1 < argc) {
+            char *end;
+            fw->bench_time = strtod(argv[++i], &end);
+            if (*end || fw->bench_time <= 0) {
+                err("invalid --time: %s (expected seconds > 0)", argv[i]);
+                bench_reset(fw);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--counters") == 0) {
+            fw->bench_counters = 1;
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            fw->bench_baseline = argv[++i];
+        } else if (strcmp(argv[i], "--save-baseline") == 0 &&
+                   i + 1 < argc) {
+            fw->bench_save_baseline = argv[++i];
+        } else if (strcmp(argv[i], "--fail-above") == 0 && i + 1 < argc) {
+            /* a percentage, with or without the sign */
+            char *end;
+            fw->bench_fail_above = strtod(argv[++i], &end) / 100;
+            if (end == argv[i] || (*end && strcmp(end, "%") != 0) ||
+                fw->bench_fail_above <= 0) {
+                err("invalid --fail-above: %s (expected a percentage > 0)",
+                    argv[i]);
+                bench_reset(fw);
+                return 1;
+            }
+        }
+    }
+
+    /* baselines are files under build/bench/baselines/ */
+    const char *names[] = {fw->bench_baseline, fw->bench_save_baseline};
+    const char *bad = NULL;
+    for (int i = 0; i < 2; i++)
+        if (names[i] && (!names[i][0] || names[i][0] == '.' ||
+                         strchr(names[i], '/')))
+            bad = names[i];
+    if (bad)
+        err("invalid baseline name: '%s'", bad);
+    else if (fw->bench_fail_above > 0 && !fw->bench_baseline)
+        err("--fail-above needs a --baseline to compare against");
+    if (bad || (fw->bench_fail_above > 0 && !fw->bench_baseline) ||
+        cmd_parse_jobs(argc, argv, fw) != 0) {
+        bench_reset(fw);
         return 1;
-    lock_save(fw->lock_file, &lf);
+    }
 
-    if (!fw->on_test) {
-        err("no test callback registered");
+    Config cfg;
+    if (config_load(fw->config_file, &cfg, fw) != 0) {
+        bench_reset(fw);
         return 1;
     }
 
-    return fw->on_test(&cfg, release, fw->build_dir, fw->pkg_dir,
-                       fw->config_file, fw->test_dir, fw->userdata);
+    /* benchmarks build in release, the way the code ships */
+    int rc = 1;
+    if (cfg.ws_member_count > 0) {
+        err("%s is a workspace; run %s bench in a member", cfg.name,
+            fw->tool_name);
+    } else if (resolve_deps(&cfg, fw, 1) == 0) {
+        if (fw->on_bench)
+            rc = fw->on_bench(&cfg, fw->build_dir, fw->pkg_dir,
+                              fw->config_file, fw->bench_dir, fw->userdata);
+        else
+            err("no bench callback registered");
+    }
+
+    bench_reset(fw);
+    config_free(&cfg);
+    return rc;
 }
 
 int cmd_install(int argc, char **argv, GooseFramework *fw) {
@@ -248,17 +688,15 @@ int cmd_install(int argc, char **argv, GooseFramework *fw) {
 
     info("Building", "%s v%s (release)", cfg.name, cfg.version);
 
-    LockFile lf;
-    lock_load(fw->lock_file, &lf);
-    if (pkg_fetch_all(&cfg, &lf, fw) != 0)
-        return 1;
-    lock_save(fw->lock_file, &lf);
-
-    if (!fw->on_install) {
-        err("no install callback registered");
-        return 1;
+    int rc = 1;
+    if (resolve_deps(&cfg, fw, 1) == 0) {
+        if (fw->on_install)
+            rc = fw->on_install(&cfg, prefix, fw->build_dir, fw->pkg_dir,
+                                fw->config_file, fw->userdata);
+        else
+            err("no install callback registered");
     }
 
-    return fw->on_install(&cfg, prefix, fw->build_dir, fw->pkg_dir,
-                          fw->config_file, fw->userdata);
+    config_free(&cfg);
+    return rc;
 }
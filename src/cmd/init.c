@@ -39,6 +39,7 @@ int cmd_init(int argc, char **argv, GooseFramework *fw) {
     }
 
     config_save(fw->config_file, &cfg, fw);
+    config_free(&cfg);
     info("Created", "%s project '%s'", fw->tool_name, name);
     return 0;
 }
@@ -68,6 +69,7 @@ int cmd_new(int argc, char **argv, GooseFramework *fw) {
     char cfg_path[512];
     snprintf(cfg_path, sizeof(cfg_path), "%s/%s", name, fw->config_file);
     config_save(cfg_path, &cfg, fw);
+    config_free(&cfg);
 
     /* use consumer init template */
     if (fw->on_init_template) {
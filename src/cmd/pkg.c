@@ -9,8 +9,8 @@
 
 int cmd_add(int argc, char **argv, GooseFramework *fw) {
     if (argc < 2) {
-        err("usage: %s add <git-url> [--name <name>] [--version <tag>]",
-            fw->tool_name);
+        err("usage: %s add <git-url|archive-url> [--name <name>] [--version <tag>] "
+            "[--sha256 <digest>] [--subdir <dir>]", fw->tool_name);
         return 1;
     }
 
@@ -21,46 +21,70 @@ int cmd_add(int argc, char **argv, GooseFramework *fw) {
     const char *git_url = argv[1];
     const char *name = NULL;
     const char *version = "";
+    const char *sha256 = NULL;
+    const char *subdir = "";
 
     for (int i = 2; i < argc; i++) {
         if (strcmp(argv[i], "--name") == 0 && i + 1 < argc)
             name = argv[++i];
         else if (strcmp(argv[i], "--version") == 0 && i + 1 < argc)
             version = argv[++i];
+        else if (strcmp(argv[i], "--sha256") == 0 && i + 1 < argc)
+            sha256 = argv[++i];
+        else if (strcmp(argv[i], "--subdir") == 0 && i + 1 < argc)
+            subdir = argv[++i];
     }
 
+    /* a monorepo subtree is named after its last path component */
+    if (!name && subdir[0]) {
+        const char *slash = strrchr(subdir, '/');
+        name = slash && slash[1] ? slash + 1 : subdir;
+    }
     if (!name)
         name = pkg_name_from_git(git_url);
 
     for (int i = 0; i < cfg.dep_count; i++) {
         if (strcmp(cfg.deps[i].name, name) == 0) {
             err("dependency '%s' already exists", name);
+            config_free(&cfg);
             return 1;
         }
     }
 
-    if (cfg.dep_count >= MAX_DEPS) {
-        err("too many dependencies (max %d)", MAX_DEPS);
-        return 1;
-    }
-
-    Dependency *dep = &cfg.deps[cfg.dep_count];
-    memset(dep, 0, sizeof(Dependency));
+    Dependency *dep = config_add_dep(&cfg);
     strncpy(dep->name, name, MAX_NAME_LEN - 1);
-    strncpy(dep->git, git_url, MAX_PATH_LEN - 1);
-    strncpy(dep->version, version, 63);
-    cfg.dep_count++;
+    if (sha256 || pkg_is_archive_url(git_url)) {
+        strncpy(dep->url, git_url, MAX_PATH_LEN - 1);
+        if (sha256)
+            strncpy(dep->sha256, sha256, sizeof(dep->sha256) - 1);
+    } else {
+        strncpy(dep->git, git_url, MAX_PATH_LEN - 1);
+        strncpy(dep->version, version, 63);
+    }
+    strncpy(dep->subdir, subdir, MAX_PATH_LEN - 1);
 
     info("Adding", "%s", name);
 
     LockFile lf;
     lock_load(fw->lock_file, &lf);
 
-    if (pkg_fetch(dep, fw->pkg_dir, &lf, fw) != 0)
+    if (pkg_fetch(dep, fw->pkg_dir, &lf, fw) != 0) {
+        lock_free(&lf);
+        config_free(&cfg);
         return 1;
+    }
+
+    /* pin a freshly downloaded archive by the digest it was fetched at */
+    if (dep->url[0] && !dep->sha256[0]) {
+        const char *digest = lock_find_sha256(&lf, dep->name);
+        if (digest)
+            strncpy(dep->sha256, digest, sizeof(dep->sha256) - 1);
+    }
 
     lock_save(fw->lock_file, &lf);
+    lock_free(&lf);
     config_save(fw->config_file, &cfg, fw);
+    config_free(&cfg);
     info("Added", "%s to %s", name, fw->config_file);
     return 0;
 }
@@ -87,6 +111,7 @@ int cmd_remove(int argc, char **argv, GooseFramework *fw) {
 
     if (found < 0) {
         err("dependency '%s' not found in %s", name, fw->config_file);
+        config_free(&cfg);
         return 1;
     }
 
@@ -97,12 +122,14 @@ int cmd_remove(int argc, char **argv, GooseFramework *fw) {
     cfg.dep_count--;
 
     config_save(fw->config_file, &cfg, fw);
+    config_free(&cfg);
     info("Removed", "%s from %s", name, fw->config_file);
     return 0;
 }
 
 int cmd_update(int argc, char **argv, GooseFramework *fw) {
-    (void)argc; (void)argv;
+    if (cmd_parse_jobs(argc, argv, fw) != 0)
+        return 1;
 
     Config cfg;
     if (config_load(fw->config_file, &cfg, fw) != 0)
@@ -113,10 +140,70 @@ int cmd_update(int argc, char **argv, GooseFramework *fw) {
     LockFile lf;
     lock_load(fw->lock_file, &lf);
 
-    if (pkg_update_all(&cfg, &lf, fw) != 0)
+    int failed = 0;
+    int changed = pkg_update_all(&cfg, &lf, fw, &failed);
+    config_free(&cfg);
+    if (changed < 0) {
+        lock_free(&lf);
         return 1;
+    }
 
-    lock_save(fw->lock_file, &lf);
-    info("Updated", "lock file written to %s", fw->lock_file);
+    /* written once, and only when a revision moved. packages that did
+     * update are checked out at their new revision even if others failed,
+     * so the lock records them either way */
+    if (changed > 0) {
+        lock_save(fw->lock_file, &lf);
+        info("Updated", "%d package%s, lock file written to %s", changed,
+             changed == 1 ? "" : "s", fw->lock_file);
+    } else {
+        info("Unchanged", "%s (%s)", fw->lock_file,
+             failed ? "no package moved" : "all packages up to date");
+    }
+    lock_free(&lf);
+    if (failed > 0) {
+        err("%d package%s could not be updated", failed,
+            failed == 1 ? "" : "s");
+        return 1;
+    }
     return 0;
 }
+
+int cmd_vendor(int argc, char **argv, GooseFramework *fw) {
+    if (cmd_parse_jobs(argc, argv, fw) != 0)
+        return 1;
+
+    Config cfg;
+    if (config_load(fw->config_file, &cfg, fw) != 0)
+        return 1;
+
+    info("Vendoring", "%s dependencies", cfg.name);
+
+    LockFile lf;
+    lock_load(fw->lock_file, &lf);
+
+    /* a workspace vendors what all of its members need */
+    int rc = 0;
+    if (cfg.ws_member_count > 0) {
+        Config all;
+        rc = pkg_workspace_deps(&cfg, fw, &all);
+        config_free(&cfg);
+        if (rc != 0) {
+            lock_free(&lf);
+            return 1;
+        }
+        cfg = all;
+    }
+
+    /* everything locked must be on disk before it can be packed */
+    DepGraph g;
+    rc = pkg_resolve(&cfg, &lf, fw, &g);
+    if (rc == 0) {
+        lock_save(fw->lock_file, &lf);
+        rc = pkg_vendor(&g, fw);
+    }
+
+    dep_graph_free(&g);
+    lock_free(&lf);
+    config_free(&cfg);
+    return rc == 0 ? 0 : 1;
+}
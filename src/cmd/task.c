@@ -1,40 +1,240 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include <sys/wait.h>
 #include "../headers/cmd.h"
 #include "../headers/config.h"
 #include "../headers/framework.h"
+#include "../headers/workspace.h"
+#include "../headers/sched.h"
+#include "../headers/fs.h"
 #include "../headers/color.h"
 
+/* the command of task name in a member, NULL if it has none. loading the
+ * config overwrites custom_data, so the caller's copy is put back */
+static char *member_task(const char *dir, const char *name,
+                         GooseFramework *fw) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", dir, fw->config_file);
+    if (!fs_exists(path)) return NULL;
+
+    char saved[sizeof(fw->custom_data)];
+    memcpy(saved, fw->custom_data, sizeof(saved));
+    char *cmd = NULL;
+    Config cfg;
+    if (config_load(path, &cfg, fw) == 0) {
+        for (int i = 0; i < cfg.task_count && !cmd; i++)
+            if (strcmp(cfg.tasks[i].name, name) == 0)
+                cmd = strdup(cfg.tasks[i].command);
+        config_free(&cfg);
+    }
+    memcpy(fw->custom_data, saved, sizeof(saved));
+    return cmd;
+}
+
+/* print a finished member's buffered output in one piece */
+static void print_log(const char *dir, const char *log) {
+    FILE *f = fopen(log, "r");
+    if (!f) return;
+    char buf[4096];
+    size_t n = fread(buf, 1, sizeof(buf), f);
+    if (n > 0) {
+        info("Output", "%s", dir);
+        do {
+            fwrite(buf, 1, n, stdout);
+        } while ((n = fread(buf, 1, sizeof(buf), f)) > 0);
+    }
+    fclose(f);
+}
+
+/* run task name in every member that defines it, -j at a time. each
+ * member's output goes to build/task/<name>/ and is printed once it is
+ * done, so concurrent members do not interleave. with --ordered a member
+ * starts only after the members it depends on, directly or not */
+static int task_workspace(const Config *root, const char *name, int ordered,
+                          GooseFramework *fw) {
+    WsGraph g;
+    if (ws_graph_load(root, fw, &g) != 0)
+        return 1;
+
+    char cwd[1024];
+    if (!getcwd(cwd, sizeof(cwd))) {
+        err("cannot read working directory");
+        ws_graph_free(&g);
+        return 1;
+    }
+    Arena *arena = arena_new();
+    const char *log_dir = arena_printf(arena, "%s/%s/task/%s", cwd,
+                                       fw->build_dir, name);
+
+    int n = g.n ? g.n : 1;
+    char **cmds = calloc(n, sizeof(char *));
+    const char **logs = calloc(n, sizeof(char *));
+    int *job = malloc(n * sizeof(int));
+    unsigned char *reach = malloc((size_t)n * n);
+    Sched *s = cmds && logs && job && reach ? sched_new(fw->jobs) : NULL;
+    int rc = 1, count = 0;
+    if (!s) {
+        err("out of memory");
+        goto done;
+    }
+    sched_keep_going(s);
+
+    for (int i = 0; i < g.n; i++) {
+        job[i] = -1;
+        cmds[i] = member_task(g.dirs[i], name, fw);
+        if (cmds[i]) count++;
+    }
+    if (count == 0) {
+        err("no workspace member defines task '%s'", name);
+        goto done;
+    }
+    if (fs_mkdir_p(log_dir) != 0) {
+        err("cannot create %s", log_dir);
+        goto done;
+    }
+
+    for (int i = 0; i < g.n; i++) {
+        if (!cmds[i]) continue;
+        char *file = arena_strdup(arena, g.dirs[i]);
+        for (char *p = file; *p; p++)
+            if (*p == '/') *p = '_';
+        logs[i] = arena_printf(arena, "%s/%s.log", log_dir, file);
+
+        StrBuf cmd;
+        strbuf_init(&cmd);
+        strbuf_printf(&cmd, "cd '%s' && ( %s ) > '%s' 2>&1 < /dev/null",
+                      g.dirs[i], cmds[i], logs[i]);
+        job[i] = sched_cmd(s, cmd.data, NULL);
+        strbuf_free(&cmd);
+        if (job[i] < 0) {
+            err("out of memory");
+            goto done;
+        }
+    }
+
+    /* a member between two others may not define the task, so order by
+     * reachability rather than direct edges */
+    if (ordered) {
+        memcpy(reach, g.dep, (size_t)g.n * g.n);
+        for (int k = 0; k < g.n; k++)
+            for (int i = 0; i < g.n; i++)
+                for (int j = 0; j < g.n; j++)
+                    if (reach[i * g.n + k] && reach[k * g.n + j])
+                        reach[i * g.n + j] = 1;
+        for (int i = 0; i < g.n; i++)
+            for (int j = 0; j < g.n; j++)
+                if (i != j && job[i] >= 0 && job[j] >= 0 &&
+                    reach[i * g.n + j])
+                    sched_after(s, job[i], job[j]);
+    }
+
+    info("Running", "%s in %d of %d members (%d at a time)", name, count, g.n,
+         sched_jobs(s));
+    sched_run(s);
+
+    int ok = 0, failed = 0, skipped = 0;
+    for (int i = 0; i < g.n; i++)
+        if (job[i] >= 0 && sched_status(s, job[i]) != SCHED_PENDING)
+            print_log(g.dirs[i], logs[i]);
+
+    printf("\n");
+    for (int i = 0; i < g.n; i++) {
+        if (job[i] < 0) continue;
+        switch (sched_status(s, job[i])) {
+        case SCHED_DONE:
+            cprintf(CLR_GREEN, "      PASS ");
+            printf("%-24s %.2fs\n", g.dirs[i], sched_seconds(s, job[i]));
+            ok++;
+            break;
+        case SCHED_FAILED:
+            cprintf(CLR_RED, "      FAIL ");
+            printf("%-24s %.2fs\n", g.dirs[i], sched_seconds(s, job[i]));
+            failed++;
+            break;
+        default:
+            cprintf(CLR_YELLOW, "      SKIP ");
+            printf("%-24s (a member it depends on failed)\n", g.dirs[i]);
+            skipped++;
+        }
+    }
+    printf("\n");
+    info("Results", "%d passed, %d failed, %d skipped", ok, failed, skipped);
+    rc = failed + skipped > 0 ? 1 : 0;
+
+done:
+    if (cmds)
+        for (int i = 0; i < g.n; i++) free(cmds[i]);
+    free(cmds);
+    free(logs);
+    free(job);
+    free(reach);
+    sched_free(s);
+    arena_destroy(arena);
+    ws_graph_free(&g);
+    return rc;
+}
+
 int cmd_task(int argc, char **argv, GooseFramework *fw) {
+    /* the task name is the first argument that is not an option */
+    const char *name = NULL;
+    int workspace = 0, ordered = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--workspace") == 0 || strcmp(argv[i], "-w") == 0)
+            workspace = 1;
+        else if (strcmp(argv[i], "--ordered") == 0)
+            ordered = 1;
+        else if (strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jobs") == 0)
+            i++;
+        else if (argv[i][0] != '-' && !name)
+            name = argv[i];
+    }
+    if (cmd_parse_jobs(argc, argv, fw) != 0)
+        return 1;
+
     Config cfg;
     if (config_load(fw->config_file, &cfg, fw) != 0)
         return 1;
 
-    if (argc < 2) {
-        if (cfg.task_count == 0) {
+    if (workspace) {
+        int rc = 1;
+        if (cfg.ws_member_count == 0)
+            err("--workspace runs a task in every member, but %s is not a "
+                "workspace", cfg.name);
+        else if (!name)
+            err("usage: %s task <name> --workspace [-j N] [--ordered]",
+                fw->tool_name);
+        else
+            rc = task_workspace(&cfg, name, ordered, fw);
+        config_free(&cfg);
+        return rc;
+    }
+
+    if (!name) {
+        if (cfg.task_count == 0)
             info("Tasks", "none defined in %s", fw->config_file);
-            return 0;
-        }
-        printf("Available tasks:\n");
+        else
+            printf("Available tasks:\n");
         for (int i = 0; i < cfg.task_count; i++) {
             cprintf(CLR_CYAN, "  %-16s", cfg.tasks[i].name);
             printf(" %s\n", cfg.tasks[i].command);
         }
+        config_free(&cfg);
         return 0;
     }
 
-    const char *name = argv[1];
     for (int i = 0; i < cfg.task_count; i++) {
         if (strcmp(cfg.tasks[i].name, name) == 0) {
             info("Running", "%s", name);
             int ret = system(cfg.tasks[i].command);
+            config_free(&cfg);
             if (WIFEXITED(ret)) return WEXITSTATUS(ret);
             return 1;
         }
     }
 
     err("unknown task '%s'", name);
+    config_free(&cfg);
     return 1;
 }
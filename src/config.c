@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <yaml.h>
 #include "headers/config.h"
@@ -8,34 +9,99 @@
 
 void config_default(Config *cfg, const char *name, GooseFramework *fw) {
     memset(cfg, 0, sizeof(Config));
+    cfg->arena = arena_new();
     strncpy(cfg->name, name, MAX_NAME_LEN - 1);
     strncpy(cfg->version, "0.1.0", 63);
     strncpy(cfg->description, "", 255);
     strncpy(cfg->author, "", MAX_NAME_LEN - 1);
     strncpy(cfg->license, "MIT", 63);
-    strncpy(cfg->src_dir, "src", MAX_PATH_LEN - 1);
+    config_set_src_dir(cfg, "src");
     /* default include: src */
-    strncpy(cfg->includes[0], "src", MAX_PATH_LEN - 1);
-    cfg->include_count = 1;
-    cfg->source_count = 0;
-    cfg->dep_count = 0;
-    cfg->plugin_count = 0;
+    config_add_include(cfg, "src");
 
     if (fw && fw->on_config_defaults)
         fw->on_config_defaults(cfg, fw->custom_data, fw->userdata);
 }
 
+void config_free(Config *cfg) {
+    arena_destroy(cfg->arena);
+    memset(cfg, 0, sizeof(Config));
+}
+
+void config_add_include(Config *cfg, const char *path) {
+    cfg->includes = arena_grow(cfg->arena, cfg->includes, cfg->include_count,
+                               &cfg->include_cap, sizeof(char *));
+    cfg->includes[cfg->include_count++] = arena_intern(cfg->arena, path);
+}
+
+void config_add_source(Config *cfg, const char *path) {
+    cfg->sources = arena_grow(cfg->arena, cfg->sources, cfg->source_count,
+                              &cfg->source_cap, sizeof(char *));
+    cfg->sources[cfg->source_count++] = arena_intern(cfg->arena, path);
+}
+
+void config_add_ws_member(Config *cfg, const char *path) {
+    cfg->ws_members = arena_grow(cfg->arena, cfg->ws_members,
+                                 cfg->ws_member_count, &cfg->ws_member_cap,
+                                 sizeof(char *));
+    cfg->ws_members[cfg->ws_member_count++] = arena_intern(cfg->arena, path);
+}
+
+void config_add_test_data(Config *cfg, const char *path) {
+    cfg->test_data = arena_grow(cfg->arena, cfg->test_data,
+                                cfg->test_data_count, &cfg->test_data_cap,
+                                sizeof(char *));
+    cfg->test_data[cfg->test_data_count++] = arena_intern(cfg->arena, path);
+}
+
+void config_add_test_env(Config *cfg, const char *name) {
+    cfg->test_env = arena_grow(cfg->arena, cfg->test_env, cfg->test_env_count,
+                               &cfg->test_env_cap, sizeof(char *));
+    cfg->test_env[cfg->test_env_count++] = arena_intern(cfg->arena, name);
+}
+
+void config_set_src_dir(Config *cfg, const char *path) {
+    cfg->src_dir = arena_intern(cfg->arena, path);
+}
+
+Dependency *config_add_dep(Config *cfg) {
+    cfg->deps = arena_grow(cfg->arena, cfg->deps, cfg->dep_count,
+                           &cfg->dep_cap, sizeof(Dependency));
+    Dependency *dep = &cfg->deps[cfg->dep_count++];
+    memset(dep, 0, sizeof(Dependency));
+    return dep;
+}
+
+Plugin *config_add_plugin(Config *cfg) {
+    cfg->plugins = arena_grow(cfg->arena, cfg->plugins, cfg->plugin_count,
+                              &cfg->plugin_cap, sizeof(Plugin));
+    Plugin *plugin = &cfg->plugins[cfg->plugin_count++];
+    memset(plugin, 0, sizeof(Plugin));
+    plugin->command = "";
+    return plugin;
+}
+
+Task *config_add_task(Config *cfg) {
+    cfg->tasks = arena_grow(cfg->arena, cfg->tasks, cfg->task_count,
+                            &cfg->task_cap, sizeof(Task));
+    Task *task = &cfg->tasks[cfg->task_count++];
+    memset(task, 0, sizeof(Task));
+    task->command = "";
+    return task;
+}
+
 /* --- YAML Loading --- */
 
 typedef enum {
     S_NONE, S_PROJECT, S_DEPS, S_DEP_ENTRY, S_BUILD, S_PLUGINS, S_PLUGIN_ENTRY, S_TASKS,
-    S_WORKSPACE
+    S_WORKSPACE, S_TEST
 } Section;
 
 int config_load(const char *path, Config *cfg, GooseFramework *fw) {
     FILE *f = fopen(path, "r");
     if (!f) {
         err("cannot open %s (are you in a goose project?)", path);
+        memset(cfg, 0, sizeof(Config));
         return -1;
     }
 
@@ -54,6 +120,8 @@ int config_load(const char *path, Config *cfg, GooseFramework *fw) {
     int parsed_includes = 0;
     int in_sources = 0;
     int in_ws_members = 0;
+    int in_test_data = 0;
+    int in_test_env = 0;
     Dependency *cur_dep = NULL;
     Plugin *cur_plugin = NULL;
 
@@ -62,6 +130,7 @@ int config_load(const char *path, Config *cfg, GooseFramework *fw) {
             err("YAML parse error in %s (line %lu)", path, parser.problem_mark.line + 1);
             yaml_parser_delete(&parser);
             fclose(f);
+            config_free(cfg);
             return -1;
         }
 
@@ -84,6 +153,10 @@ int config_load(const char *path, Config *cfg, GooseFramework *fw) {
             } else if (section == S_WORKSPACE && strcmp(key, "members") == 0) {
                 in_ws_members = 1;
                 cfg->ws_member_count = 0;
+            } else if (section == S_TEST && strcmp(key, "data") == 0) {
+                in_test_data = 1;
+            } else if (section == S_TEST && strcmp(key, "env") == 0) {
+                in_test_env = 1;
             }
             break;
 
@@ -91,6 +164,8 @@ int config_load(const char *path, Config *cfg, GooseFramework *fw) {
             in_includes = 0;
             in_sources = 0;
             in_ws_members = 0;
+            in_test_data = 0;
+            in_test_env = 0;
             in_key = 0;
             break;
 
@@ -109,20 +184,16 @@ int config_load(const char *path, Config *cfg, GooseFramework *fw) {
                 section = S_TASKS;
             else if (depth == 2 && strcmp(key, "workspace") == 0)
                 section = S_WORKSPACE;
+            else if (depth == 2 && strcmp(key, "test") == 0)
+                section = S_TEST;
             else if (section == S_DEPS && depth == 3) {
                 section = S_DEP_ENTRY;
-                if (cfg->dep_count < MAX_DEPS) {
-                    cur_dep = &cfg->deps[cfg->dep_count];
-                    memset(cur_dep, 0, sizeof(Dependency));
-                    strncpy(cur_dep->name, key, MAX_NAME_LEN - 1);
-                }
+                cur_dep = config_add_dep(cfg);
+                strncpy(cur_dep->name, key, MAX_NAME_LEN - 1);
             } else if (section == S_PLUGINS && depth == 3) {
                 section = S_PLUGIN_ENTRY;
-                if (cfg->plugin_count < MAX_PLUGINS) {
-                    cur_plugin = &cfg->plugins[cfg->plugin_count];
-                    memset(cur_plugin, 0, sizeof(Plugin));
-                    strncpy(cur_plugin->name, key, MAX_NAME_LEN - 1);
-                }
+                cur_plugin = config_add_plugin(cfg);
+                strncpy(cur_plugin->name, key, MAX_NAME_LEN - 1);
             }
             break;
 
@@ -130,14 +201,10 @@ int config_load(const char *path, Config *cfg, GooseFramework *fw) {
             depth--;
             in_key = 0;
             if (section == S_DEP_ENTRY && depth == 2) {
-                if (cfg->dep_count < MAX_DEPS)
-                    cfg->dep_count++;
                 cur_dep = NULL;
                 section = S_DEPS;
             }
             if (section == S_PLUGIN_ENTRY && depth == 2) {
-                if (cfg->plugin_count < MAX_PLUGINS)
-                    cfg->plugin_count++;
                 cur_plugin = NULL;
                 section = S_PLUGINS;
             }
@@ -149,28 +216,29 @@ int config_load(const char *path, Config *cfg, GooseFramework *fw) {
 
             /* items inside includes sequence */
             if (in_includes) {
-                if (cfg->include_count < MAX_INCLUDES) {
-                    strncpy(cfg->includes[cfg->include_count], val, MAX_PATH_LEN - 1);
-                    cfg->include_count++;
-                }
+                config_add_include(cfg, val);
                 break;
             }
 
             /* items inside sources sequence */
             if (in_sources) {
-                if (cfg->source_count < MAX_SRC_FILES) {
-                    strncpy(cfg->sources[cfg->source_count], val, MAX_PATH_LEN - 1);
-                    cfg->source_count++;
-                }
+                config_add_source(cfg, val);
                 break;
             }
 
             /* items inside workspace members sequence */
             if (in_ws_members) {
-                if (cfg->ws_member_count < MAX_WS_MEMBERS) {
-                    strncpy(cfg->ws_members[cfg->ws_member_count], val, MAX_PATH_LEN - 1);
-                    cfg->ws_member_count++;
-                }
+                config_add_ws_member(cfg, val);
+                break;
+            }
+
+            /* items inside the test data and env sequences */
+            if (in_test_data) {
+                config_add_test_data(cfg, val);
+                break;
+            }
+            if (in_test_env) {
+                config_add_test_env(cfg, val);
                 break;
             }
 
@@ -199,22 +267,36 @@ int config_load(const char *path, Config *cfg, GooseFramework *fw) {
                         strncpy(cur_dep->version, val, 63);
                     else if (strcmp(key, "path") == 0)
                         strncpy(cur_dep->path, val, MAX_PATH_LEN - 1);
+                    else if (strcmp(key, "url") == 0)
+                        strncpy(cur_dep->url, val, MAX_PATH_LEN - 1);
+                    else if (strcmp(key, "sha256") == 0)
+                        strncpy(cur_dep->sha256, val, sizeof(cur_dep->sha256) - 1);
+                    else if (strcmp(key, "subdir") == 0)
+                        strncpy(cur_dep->subdir, val, MAX_PATH_LEN - 1);
                 } else if (section == S_PLUGIN_ENTRY && cur_plugin) {
                     if (strcmp(key, "ext") == 0)
                         strncpy(cur_plugin->ext, val, MAX_EXT_LEN - 1);
                     else if (strcmp(key, "command") == 0)
-                        strncpy(cur_plugin->command, val, MAX_CMD_LEN - 1);
+                        cur_plugin->command = arena_strdup(cfg->arena, val);
                 } else if (section == S_BUILD) {
                     if (strcmp(key, "src_dir") == 0)
-                        strncpy(cfg->src_dir, val, MAX_PATH_LEN - 1);
+                        config_set_src_dir(cfg, val);
                     else if (fw && fw->on_config_parse)
                         fw->on_config_parse("build", key, val,
                                             fw->custom_data, fw->userdata);
                 } else if (section == S_TASKS) {
-                    if (cfg->task_count < MAX_TASKS) {
-                        strncpy(cfg->tasks[cfg->task_count].name, key, MAX_NAME_LEN - 1);
-                        strncpy(cfg->tasks[cfg->task_count].command, val, MAX_TASK_CMD - 1);
-                        cfg->task_count++;
+                    Task *task = config_add_task(cfg);
+                    strncpy(task->name, key, MAX_NAME_LEN - 1);
+                    task->command = arena_strdup(cfg->arena, val);
+                } else if (section == S_TEST) {
+                    if (strcmp(key, "timeout") == 0) {
+                        char *end;
+                        double t = strtod(val, &end);
+                        if (*end || t < 0)
+                            warn("Config", "ignoring test timeout \"%s\" in %s",
+                                 val, path);
+                        else
+                            cfg->test_timeout = t;
                     }
                 }
                 in_key = 0;
@@ -281,11 +363,17 @@ int config_save(const char *path, const Config *cfg, const GooseFramework *fw) {
         fprintf(f, "  %s:\n", cfg->deps[i].name);
         if (strlen(cfg->deps[i].path) > 0) {
             fprintf(f, "    path: \"%s\"\n", cfg->deps[i].path);
+        } else if (strlen(cfg->deps[i].url) > 0) {
+            fprintf(f, "    url: \"%s\"\n", cfg->deps[i].url);
+            if (strlen(cfg->deps[i].sha256) > 0)
+                fprintf(f, "    sha256: \"%s\"\n", cfg->deps[i].sha256);
         } else {
             fprintf(f, "    git: \"%s\"\n", cfg->deps[i].git);
             if (strlen(cfg->deps[i].version) > 0)
                 fprintf(f, "    version: \"%s\"\n", cfg->deps[i].version);
         }
+        if (!cfg->deps[i].path[0] && cfg->deps[i].subdir[0])
+            fprintf(f, "    subdir: \"%s\"\n", cfg->deps[i].subdir);
     }
 
     if (cfg->plugin_count > 0) {
@@ -297,6 +385,23 @@ int config_save(const char *path, const Config *cfg, const GooseFramework *fw) {
         }
     }
 
+    if (cfg->test_timeout > 0 || cfg->test_data_count > 0 ||
+        cfg->test_env_count > 0) {
+        fprintf(f, "\ntest:\n");
+        if (cfg->test_timeout > 0)
+            fprintf(f, "  timeout: %g\n", cfg->test_timeout);
+        if (cfg->test_data_count > 0) {
+            fprintf(f, "  data:\n");
+            for (int i = 0; i < cfg->test_data_count; i++)
+                fprintf(f, "    - \"%s\"\n", cfg->test_data[i]);
+        }
+        if (cfg->test_env_count > 0) {
+            fprintf(f, "  env:\n");
+            for (int i = 0; i < cfg->test_env_count; i++)
+                fprintf(f, "    - \"%s\"\n", cfg->test_env[i]);
+        }
+    }
+
     if (cfg->task_count > 0) {
         fprintf(f, "\ntasks:\n");
         for (int i = 0; i < cfg->task_count; i++)
@@ -39,6 +39,10 @@ void goose_framework_set_lock_file(GooseFramework *fw, const char *filename) {
     strncpy(fw->lock_file, filename, sizeof(fw->lock_file) - 1);
 }
 
+void goose_framework_set_vendor_file(GooseFramework *fw, const char *filename) {
+    strncpy(fw->vendor_file, filename, sizeof(fw->vendor_file) - 1);
+}
+
 void goose_framework_set_pkg_dir(GooseFramework *fw, const char *dir) {
     strncpy(fw->pkg_dir, dir, sizeof(fw->pkg_dir) - 1);
 }
@@ -55,6 +59,10 @@ void goose_framework_set_test_dir(GooseFramework *fw, const char *dir) {
     strncpy(fw->test_dir, dir, sizeof(fw->test_dir) - 1);
 }
 
+void goose_framework_set_bench_dir(GooseFramework *fw, const char *dir) {
+    strncpy(fw->bench_dir, dir, sizeof(fw->bench_dir) - 1);
+}
+
 void goose_framework_set_init_filename(GooseFramework *fw, const char *filename) {
     strncpy(fw->init_filename, filename, sizeof(fw->init_filename) - 1);
 }
@@ -63,6 +71,10 @@ void goose_framework_set_gitignore_extra(GooseFramework *fw, const char *extra)
     strncpy(fw->gitignore_extra, extra, sizeof(fw->gitignore_extra) - 1);
 }
 
+void goose_framework_set_jobs(GooseFramework *fw, int jobs) {
+    fw->jobs = jobs;
+}
+
 /* --- callback registration --- */
 
 void goose_framework_on_build(GooseFramework *fw, goose_build_fn fn) {
@@ -73,6 +85,10 @@ void goose_framework_on_test(GooseFramework *fw, goose_test_fn fn) {
     fw->on_test = fn;
 }
 
+void goose_framework_on_bench(GooseFramework *fw, goose_bench_fn fn) {
+    fw->on_bench = fn;
+}
+
 void goose_framework_on_clean(GooseFramework *fw, goose_clean_fn fn) {
     fw->on_clean = fn;
 }
@@ -89,6 +105,14 @@ void goose_framework_on_transpile(GooseFramework *fw, goose_transpile_fn fn) {
     fw->on_transpile = fn;
 }
 
+void goose_framework_on_schedule(GooseFramework *fw, goose_schedule_fn fn) {
+    fw->on_schedule = fn;
+}
+
+void goose_framework_on_pkg_ready(GooseFramework *fw, goose_pkg_ready_fn fn) {
+    fw->on_pkg_ready = fn;
+}
+
 void goose_framework_on_init_template(GooseFramework *fw, goose_init_template_fn fn) {
     fw->on_init_template = fn;
 }
@@ -146,10 +170,12 @@ static BuiltinCmd builtins[] = {
     {"build",   "Build the project",                      cmd_build},
     {"run",     "Build and run the project",              cmd_run},
     {"test",    "Build and run tests",                    cmd_test},
+    {"bench",   "Build and run benchmarks",               cmd_bench},
     {"clean",   "Remove build artifacts",                 cmd_clean},
     {"add",     "Add a dependency",                       cmd_add},
     {"remove",  "Remove a dependency",                    cmd_remove},
     {"update",  "Update all dependencies",                cmd_update},
+    {"vendor",  "Pack locked dependencies for offline use", cmd_vendor},
     {"install", "Install binary to system",               cmd_install},
     {"convert", "Convert CMakeLists.txt to config",       cmd_convert},
     {"task",    "Run a project task",                     cmd_task},
@@ -169,11 +195,26 @@ static void fw_usage(const GooseFramework *fw) {
         cprintf(CLR_CYAN, "  %-10s", fw->extra_cmds[i].name);
         printf(" %s\n", fw->extra_cmds[i].desc);
     }
-    printf("\n  --version  Print version\n");
+    printf("\n  --offline  Use only vendored and checked-out packages\n");
+    printf("  --version  Print version\n");
     printf("  --help     Print this help\n");
 }
 
 int goose_main(GooseFramework *fw, int argc, char **argv) {
+    /* --offline applies to every command, wherever it appears */
+    const char *env = getenv("GOOSE_OFFLINE");
+    if (env && env[0] && strcmp(env, "0") != 0)
+        fw->offline = 1;
+    int kept = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--offline") == 0)
+            fw->offline = 1;
+        else
+            argv[kept++] = argv[i];
+    }
+    argc = kept;
+    argv[argc] = NULL;
+
     if (argc < 2) {
         fw_usage(fw);
         return 1;
@@ -208,10 +249,12 @@ int goose_main(GooseFramework *fw, int argc, char **argv) {
             if (strcmp(argv[1], cfg.tasks[i].name) == 0) {
                 info("Running", "%s", cfg.tasks[i].name);
                 int ret = system(cfg.tasks[i].command);
+                config_free(&cfg);
                 if (WIFEXITED(ret)) return WEXITSTATUS(ret);
                 return 1;
             }
         }
+        config_free(&cfg);
     }
 
     err("unknown command '%s'", argv[1]);
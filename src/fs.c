@@ -5,6 +5,7 @@
 #include <dirent.h>
 #include <unistd.h>
 #include "headers/fs.h"
+#include "headers/sha256.h"
 
 int fs_mkdir(const char *path) {
     struct stat st;
@@ -13,6 +14,19 @@ int fs_mkdir(const char *path) {
     return mkdir(path, 0755);
 }
 
+/* create path and any missing parents */
+int fs_mkdir_p(const char *path) {
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s", path);
+    for (char *p = tmp + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (fs_mkdir(tmp) != 0) return -1;
+        *p = '/';
+    }
+    return fs_mkdir(tmp);
+}
+
 int fs_exists(const char *path) {
     struct stat st;
     return stat(path, &st) == 0;
@@ -39,44 +53,118 @@ int fs_write_file(const char *path, const char *content) {
 }
 
 static int collect_recursive_ext(const char *dir, const char *ext,
-                                 char files[][512], int max, int *count) {
+                                 StrList *out) {
     DIR *d = opendir(dir);
     if (!d) return -1;
 
     size_t ext_len = strlen(ext);
     struct dirent *ent;
-    while ((ent = readdir(d)) != NULL && *count < max) {
+    while ((ent = readdir(d)) != NULL) {
         if (ent->d_name[0] == '.') continue;
 
-        char full[512];
+        char full[1024];
         snprintf(full, sizeof(full), "%s/%s", dir, ent->d_name);
 
         struct stat st;
         if (stat(full, &st) != 0) continue;
 
         if (S_ISDIR(st.st_mode)) {
-            collect_recursive_ext(full, ext, files, max, count);
+            collect_recursive_ext(full, ext, out);
         } else {
             size_t len = strlen(ent->d_name);
             if (len > ext_len &&
-                strcmp(ent->d_name + len - ext_len, ext) == 0) {
-                strncpy(files[*count], full, 511);
-                files[*count][511] = '\0';
-                (*count)++;
-            }
+                strcmp(ent->d_name + len - ext_len, ext) == 0)
+                strlist_push(out, full);
         }
     }
     closedir(d);
     return 0;
 }
 
-int fs_collect_sources(const char *dir, char files[][512], int max, int *count) {
-    *count = 0;
-    return collect_recursive_ext(dir, ".c", files, max, count);
+int fs_collect_sources(const char *dir, StrList *out) {
+    return collect_recursive_ext(dir, ".c", out);
+}
+
+int fs_collect_ext(const char *dir, const char *ext, StrList *out) {
+    return collect_recursive_ext(dir, ext, out);
+}
+
+static int cmp_str(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
 }
 
-int fs_collect_ext(const char *dir, const char *ext,
-                   char files[][512], int max, int *count) {
-    *count = 0;
-    return collect_recursive_ext(dir, ext, files, max, count);
+/* feed every file under dir (sorted, dot-entries skipped) into ctx as
+ * relative path, then content */
+static int tree_hash_dir(const char *root, const char *rel, Sha256 *ctx) {
+    char dir[1024];
+    if (rel[0])
+        snprintf(dir, sizeof(dir), "%s/%s", root, rel);
+    else
+        snprintf(dir, sizeof(dir), "%s", root);
+
+    DIR *d = opendir(dir);
+    if (!d) return -1;
+
+    char **names = NULL;
+    int count = 0, cap = 0;
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        if (ent->d_name[0] == '.') continue;
+        if (count == cap) {
+            cap = cap ? cap * 2 : 32;
+            char **grown = realloc(names, cap * sizeof(char *));
+            if (!grown) break;
+            names = grown;
+        }
+        names[count++] = strdup(ent->d_name);
+    }
+    closedir(d);
+    qsort(names, count, sizeof(char *), cmp_str);
+
+    int rc = 0;
+    for (int i = 0; i < count && rc == 0; i++) {
+        char sub[1024], full[2048];
+        if (rel[0])
+            snprintf(sub, sizeof(sub), "%s/%s", rel, names[i]);
+        else
+            snprintf(sub, sizeof(sub), "%s", names[i]);
+        if ((size_t)snprintf(full, sizeof(full), "%s/%s", root, sub) >=
+            sizeof(full)) {
+            rc = -1;
+            break;
+        }
+
+        struct stat st;
+        if (lstat(full, &st) != 0) continue;
+
+        if (S_ISDIR(st.st_mode)) {
+            rc = tree_hash_dir(root, sub, ctx);
+        } else if (S_ISREG(st.st_mode)) {
+            sha256_update(ctx, sub, strlen(sub) + 1);
+            FILE *f = fopen(full, "rb");
+            if (!f) {
+                rc = -1;
+                break;
+            }
+            char buf[65536];
+            size_t n;
+            while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+                sha256_update(ctx, buf, n);
+            fclose(f);
+        }
+    }
+
+    for (int i = 0; i < count; i++)
+        free(names[i]);
+    free(names);
+    return rc;
+}
+
+int fs_tree_hash(const char *dir, char out[65]) {
+    Sha256 ctx;
+    sha256_init(&ctx);
+    if (tree_hash_dir(dir, "", &ctx) != 0)
+        return -1;
+    sha256_final_hex(&ctx, out);
+    return 0;
 }
@@ -0,0 +1,50 @@
+#ifndef GOOSE_ARENA_H
+#define GOOSE_ARENA_H
+
+#include <stddef.h>
+
+/* bump allocator: many small allocations, one free. strings can be interned
+ * so repeated paths share a single copy. */
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct {
+    ArenaBlock *head;
+    const char **interned; /* open-addressing set of interned strings */
+    int intern_count;
+    int intern_cap;
+} Arena;
+
+Arena      *arena_new(void);
+void        arena_destroy(Arena *a);
+void       *arena_alloc(Arena *a, size_t size);
+char       *arena_strdup(Arena *a, const char *s);
+const char *arena_intern(Arena *a, const char *s);
+const char *arena_printf(Arena *a, const char *fmt, ...);
+
+/* grow an arena-backed array so it can hold count + 1 items */
+void *arena_grow(Arena *a, void *items, int count, int *cap, size_t size);
+
+/* growable list of interned strings, owned by an arena */
+typedef struct {
+    const char **items;
+    int count;
+    int cap;
+    Arena *arena;
+} StrList;
+
+void strlist_init(StrList *l, Arena *a);
+void strlist_push(StrList *l, const char *s);
+int  strlist_contains(const StrList *l, const char *s);
+
+/* growable heap string for command lines and flag sets */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} StrBuf;
+
+void strbuf_init(StrBuf *sb);
+void strbuf_printf(StrBuf *sb, const char *fmt, ...);
+void strbuf_free(StrBuf *sb);
+
+#endif
@@ -9,13 +9,28 @@ typedef struct GooseFramework GooseFramework;
 /* framework utilities for consumers */
 int  build_transpile(const Config *cfg, const char *build_dir);
 void build_include_flags(const Config *cfg, const char *pkg_dir,
-                         const char *config_file, char *buf, int bufsz,
+                         const char *config_file, StrBuf *out,
                          GooseFramework *fw);
 int  build_collect_pkg_sources(const Config *cfg, const char *pkg_dir,
-                               const char *config_file,
-                               char files[][512], int max, int *count,
+                               const char *config_file, StrList *files,
                                GooseFramework *fw);
+/* directory a dependency builds from: its path, or its checkout under
+ * pkg_dir narrowed to subdir when one is set */
 void build_dep_base(const Dependency *dep, const char *pkg_dir,
                     char *buf, int bufsz);
 
+/* commands longer than this pass their arguments through a response file */
+#define BUILD_RSP_THRESHOLD 32768
+
+/* run `prefix args suffix` through the shell. when the command would exceed
+ * BUILD_RSP_THRESHOLD, args are written to rsp_path and passed as @rsp_path.
+ * args must be quoted the same way for both (e.g. '-Idir' 'file.c').
+ * returns the system() status */
+int  build_run(const char *prefix, const char *args, const char *suffix,
+               const char *rsp_path);
+/* the command build_run would run, appended to out (for queuing it on a
+ * scheduler). returns -1 if the response file cannot be written */
+int  build_command(const char *prefix, const char *args, const char *suffix,
+                   const char *rsp_path, StrBuf *out);
+
 #endif
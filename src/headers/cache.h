@@ -0,0 +1,23 @@
+#ifndef GOOSE_CACHE_H
+#define GOOSE_CACHE_H
+
+#include "sha256.h"
+
+/* machine-wide store of build artifacts shared by every project, rooted at
+ * $GOOSE_CACHE_DIR, $XDG_CACHE_HOME/goose or ~/.cache/goose. entries are
+ * grouped by kind (e.g. "artifacts") and addressed by a content key */
+int  cache_root(char *buf, int bufsz);
+
+/* feed one NUL-terminated field into a cache key */
+void cache_key_field(Sha256 *ctx, const char *field);
+
+/* copy file from the entry for key to dest. returns 0 on a hit */
+int  cache_fetch(const char *kind, const char *key, const char *file,
+                 const char *dest);
+
+/* publish src as file in the entry for key. the entry appears
+ * atomically; an existing entry is left alone */
+int  cache_store(const char *kind, const char *key, const char *src,
+                 const char *file);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef GOOSE_CHANGES_H
+#define GOOSE_CHANGES_H
+
+#include "arena.h"
+
+/* files changed in a git checkout since a revision: what `git diff` sees
+ * against the working tree plus untracked files, as absolute paths. used
+ * by --affected to build and test only what a change can reach */
+typedef struct {
+    Arena *arena;
+    StrList paths;
+    char since[256];
+} ChangeSet;
+
+/* collect the changes of the checkout holding cwd since rev. returns -1
+ * outside a git checkout or for an unknown revision */
+int  changes_since(const char *rev, ChangeSet *out);
+void changes_free(ChangeSet *c);
+
+/* whether path (resolved against cwd) changed */
+int  changes_has(const ChangeSet *c, const char *path);
+/* whether anything under dir changed */
+int  changes_under(const ChangeSet *c, const char *dir);
+/* whether a changed file with extension ext lies under dir */
+int  changes_under_ext(const ChangeSet *c, const char *dir, const char *ext);
+/* whether a prerequisite of a make-style depfile changed: 1 if so, 0 if
+ * not, -1 if the depfile cannot be read (nothing is known about it) */
+int  changes_depfile(const ChangeSet *c, const char *depfile);
+
+/* call fn with each prerequisite of a make-style depfile until it returns
+ * non-zero, and return that. -1 if the depfile cannot be read */
+int  depfile_each(const char *depfile, int (*fn)(const char *, void *),
+                  void *ctx);
+
+#endif
@@ -11,9 +11,14 @@ int cmd_clean(int argc, char **argv, GooseFramework *fw);
 int cmd_add(int argc, char **argv, GooseFramework *fw);
 int cmd_remove(int argc, char **argv, GooseFramework *fw);
 int cmd_update(int argc, char **argv, GooseFramework *fw);
+int cmd_vendor(int argc, char **argv, GooseFramework *fw);
 int cmd_test(int argc, char **argv, GooseFramework *fw);
+int cmd_bench(int argc, char **argv, GooseFramework *fw);
 int cmd_install(int argc, char **argv, GooseFramework *fw);
 int cmd_convert(int argc, char **argv, GooseFramework *fw);
 int cmd_task(int argc, char **argv, GooseFramework *fw);
 
+/* shared option parsing: -j N / --jobs N sets fw->jobs */
+int cmd_parse_jobs(int argc, char **argv, GooseFramework *fw);
+
 #endif
@@ -1,57 +1,70 @@
 #ifndef GOOSE_CONFIG_H
 #define GOOSE_CONFIG_H
 
-#define MAX_DEPS      64
+#include "arena.h"
+
 #define MAX_NAME_LEN  128
 #define MAX_PATH_LEN  512
-#define MAX_SRC_FILES 256
-#define MAX_INCLUDES  32
 
 typedef struct {
     char name[MAX_NAME_LEN];
     char git[MAX_PATH_LEN];
     char version[64];
     char path[MAX_PATH_LEN];
+    char url[MAX_PATH_LEN];
+    char sha256[72];
+    char subdir[MAX_PATH_LEN]; /* build from this subtree of a git/url package */
 } Dependency;
 
-#define MAX_PLUGINS   16
 #define MAX_EXT_LEN   16
-#define MAX_CMD_LEN   256
-#define MAX_TASKS     32
-#define MAX_TASK_CMD  512
-#define MAX_WS_MEMBERS 32
 
 typedef struct {
     char name[MAX_NAME_LEN];
     char ext[MAX_EXT_LEN];
-    char command[MAX_CMD_LEN];
+    const char *command;
 } Plugin;
 
 typedef struct {
     char name[MAX_NAME_LEN];
-    char command[MAX_TASK_CMD];
+    const char *command;
 } Task;
 
+/* every list and string below lives in cfg->arena; config_free releases
+ * them all at once */
 typedef struct {
     char name[MAX_NAME_LEN];
     char version[64];
     char description[256];
     char author[MAX_NAME_LEN];
     char license[64];
-    char src_dir[MAX_PATH_LEN];
-    char includes[MAX_INCLUDES][MAX_PATH_LEN];
+    const char *src_dir;
+    const char **includes;
     int include_count;
-    char sources[MAX_SRC_FILES][MAX_PATH_LEN];
+    int include_cap;
+    const char **sources;
     int source_count;
-    Dependency deps[MAX_DEPS];
+    int source_cap;
+    Dependency *deps;
     int dep_count;
-    Plugin plugins[MAX_PLUGINS];
+    int dep_cap;
+    Plugin *plugins;
     int plugin_count;
-    Task tasks[MAX_TASKS];
+    int plugin_cap;
+    Task *tasks;
     int task_count;
+    int task_cap;
     char type[16];
-    char ws_members[MAX_WS_MEMBERS][MAX_PATH_LEN];
+    const char **ws_members;
     int ws_member_count;
+    int ws_member_cap;
+    double test_timeout;  /* test: timeout, seconds per test; 0 = none */
+    const char **test_data;   /* files and dirs tests read */
+    int test_data_count;
+    int test_data_cap;
+    const char **test_env;    /* variables tests read */
+    int test_env_count;
+    int test_env_cap;
+    Arena *arena;
 } Config;
 
 /* forward declaration */
@@ -60,5 +73,17 @@ typedef struct GooseFramework GooseFramework;
 int  config_load(const char *path, Config *cfg, GooseFramework *fw);
 int  config_save(const char *path, const Config *cfg, const GooseFramework *fw);
 void config_default(Config *cfg, const char *name, GooseFramework *fw);
+void config_free(Config *cfg);
+
+/* append to the growable lists; strings are interned in cfg->arena */
+void        config_add_include(Config *cfg, const char *path);
+void        config_add_source(Config *cfg, const char *path);
+void        config_add_ws_member(Config *cfg, const char *path);
+void        config_add_test_data(Config *cfg, const char *path);
+void        config_add_test_env(Config *cfg, const char *name);
+void        config_set_src_dir(Config *cfg, const char *path);
+Dependency *config_add_dep(Config *cfg);
+Plugin     *config_add_plugin(Config *cfg);
+Task       *config_add_task(Config *cfg);
 
 #endif
@@ -3,6 +3,8 @@
 
 #include "config.h"
 #include "lock.h"
+#include "sched.h"
+#include "changes.h"
 #include <stdio.h>
 
 /* forward declaration */
@@ -16,6 +18,22 @@ typedef int  (*goose_test_fn)(const Config *cfg, int release,
                               const char *build_dir, const char *pkg_dir,
                               const char *config_file, const char *test_dir,
                               void *userdata);
+typedef int  (*goose_bench_fn)(const Config *cfg, const char *build_dir,
+                               const char *pkg_dir, const char *config_file,
+                               const char *bench_dir, void *userdata);
+/* pipelined build: on_schedule queues work that needs no package before
+ * dependencies are fetched, on_pkg_ready queues work for one package as
+ * soon as it and its own dependencies are on disk. on_build then finishes
+ * whatever they left */
+typedef int  (*goose_schedule_fn)(const Config *cfg, int release,
+                                  const char *build_dir, const char *pkg_dir,
+                                  const char *config_file, Sched *s,
+                                  void *userdata);
+typedef int  (*goose_pkg_ready_fn)(const Config *cfg, const Dependency *dep,
+                                   int release, const char *build_dir,
+                                   const char *pkg_dir,
+                                   const char *config_file, Sched *s,
+                                   void *userdata);
 typedef int  (*goose_clean_fn)(const char *build_dir, void *userdata);
 typedef int  (*goose_install_fn)(const Config *cfg, const char *prefix,
                                  const char *build_dir, const char *pkg_dir,
@@ -54,22 +72,27 @@ struct GooseFramework {
     char tool_description[256];
     char config_file[512];
     char lock_file[512];
+    char vendor_file[512];
     char pkg_dir[512];
     char build_dir[512];
     char src_dir[512];
     char test_dir[512];
+    char bench_dir[512];
     char init_filename[512];
     char gitignore_extra[1024];
 
     /* lifecycle callbacks */
     goose_build_fn          on_build;
     goose_test_fn           on_test;
+    goose_bench_fn          on_bench;
     goose_clean_fn          on_clean;
     goose_install_fn        on_install;
     goose_run_fn            on_run;
     goose_transpile_fn      on_transpile;
     goose_init_template_fn  on_init_template;
     goose_config_defaults_fn on_config_defaults;
+    goose_schedule_fn       on_schedule;
+    goose_pkg_ready_fn      on_pkg_ready;
 
     /* config extension */
     goose_config_parse_fn   on_config_parse;
@@ -78,6 +101,53 @@ struct GooseFramework {
     /* package hooks */
     goose_pkg_convert_fn    on_pkg_convert;
 
+    /* parallel jobs for fetching and compiling, 0 = one per CPU */
+    int jobs;
+
+    /* never reach the network: packages come from the vendor archive or
+     * what is already checked out (--offline, GOOSE_OFFLINE=1) */
+    int offline;
+
+    /* set while building workspace members: the root's build directory,
+     * where objects every member needs are built once */
+    char shared_build_dir[512];
+
+    /* set by --affected: files changed since the base revision. on_test
+     * may skip tests whose recorded dependencies miss all of them */
+    const ChangeSet *changes;
+
+    /* set by goose test: run only shard shard_index (1-based) of
+     * shard_count (0 = all tests), and only tests whose name matches
+     * test_filter (NULL = all) */
+    int shard_index;
+    int shard_count;
+    const char *test_filter;
+
+    /* set by goose test --no-cache: run tests that passed before with
+     * the same binary and inputs */
+    int no_test_cache;
+
+    /* set by goose test --impacted: with changes, pick tests by the
+     * sources and headers each binary was built from */
+    int test_impacted;
+
+    /* set by goose bench: only benchmarks whose name matches bench_filter
+     * (NULL = all), sampled for about bench_time seconds each (0 = the
+     * default) */
+    const char *bench_filter;
+    double bench_time;
+
+    /* set by goose bench: compare against the baseline of that name and
+     * fail if a benchmark got slower by more than bench_fail_above (a
+     * fraction, 0 = never), and save this run as bench_save_baseline */
+    const char *bench_baseline;
+    const char *bench_save_baseline;
+    double bench_fail_above;
+
+    /* set by goose bench --counters: read hardware and software counters
+     * of each benchmark with perf_event_open */
+    int bench_counters;
+
     /* custom data buffer for language-specific config storage */
     char custom_data[8192];
 
@@ -100,22 +170,28 @@ void goose_framework_set_tool_version(GooseFramework *fw, const char *version);
 void goose_framework_set_tool_description(GooseFramework *fw, const char *desc);
 void goose_framework_set_config_file(GooseFramework *fw, const char *filename);
 void goose_framework_set_lock_file(GooseFramework *fw, const char *filename);
+void goose_framework_set_vendor_file(GooseFramework *fw, const char *filename);
 void goose_framework_set_pkg_dir(GooseFramework *fw, const char *dir);
 void goose_framework_set_build_dir(GooseFramework *fw, const char *dir);
 void goose_framework_set_src_dir(GooseFramework *fw, const char *dir);
 void goose_framework_set_test_dir(GooseFramework *fw, const char *dir);
+void goose_framework_set_bench_dir(GooseFramework *fw, const char *dir);
 void goose_framework_set_init_filename(GooseFramework *fw, const char *filename);
 void goose_framework_set_gitignore_extra(GooseFramework *fw, const char *extra);
+void goose_framework_set_jobs(GooseFramework *fw, int jobs);
 
 /* callback registration */
 void goose_framework_on_build(GooseFramework *fw, goose_build_fn fn);
 void goose_framework_on_test(GooseFramework *fw, goose_test_fn fn);
+void goose_framework_on_bench(GooseFramework *fw, goose_bench_fn fn);
 void goose_framework_on_clean(GooseFramework *fw, goose_clean_fn fn);
 void goose_framework_on_install(GooseFramework *fw, goose_install_fn fn);
 void goose_framework_on_run(GooseFramework *fw, goose_run_fn fn);
 void goose_framework_on_transpile(GooseFramework *fw, goose_transpile_fn fn);
 void goose_framework_on_init_template(GooseFramework *fw, goose_init_template_fn fn);
 void goose_framework_on_config_defaults(GooseFramework *fw, goose_config_defaults_fn fn);
+void goose_framework_on_schedule(GooseFramework *fw, goose_schedule_fn fn);
+void goose_framework_on_pkg_ready(GooseFramework *fw, goose_pkg_ready_fn fn);
 void goose_framework_on_config_parse(GooseFramework *fw, goose_config_parse_fn fn);
 void goose_framework_on_config_write(GooseFramework *fw, goose_config_write_fn fn);
 void goose_framework_on_pkg_convert(GooseFramework *fw, goose_pkg_convert_fn fn);
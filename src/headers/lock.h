@@ -2,23 +2,48 @@
 #define GOOSE_LOCK_H
 
 #include "config.h"
+#include "sha256.h"
 
 #define MAX_SHA_LEN 64
+#define LOCK_VERSION 2
 
 typedef struct {
     char name[MAX_NAME_LEN];
     char git[MAX_PATH_LEN];
+    char version[64];
     char sha[MAX_SHA_LEN];
+    char url[MAX_PATH_LEN];
+    char sha256[SHA256_HEX_LEN];
+    char path[MAX_PATH_LEN];
+    char subdir[MAX_PATH_LEN];  /* subtree of the checkout that is built */
+    char tree[SHA256_HEX_LEN];  /* content hash of the package tree */
+    char **deps;                /* names of the packages this one requires */
+    int dep_count;
+    int dep_cap;
 } LockEntry;
 
 typedef struct {
-    LockEntry entries[MAX_DEPS];
+    int version;                /* format version the file was read as */
+    LockEntry root;             /* the locking project and its direct deps */
+    LockEntry *entries;
     int count;
+    int cap;
+    int *index;                 /* open-addressing hash of entry names */
+    int index_cap;
 } LockFile;
 
 int  lock_load(const char *path, LockFile *lf);
 int  lock_save(const char *path, const LockFile *lf);
+void lock_free(LockFile *lf);
+LockEntry  *lock_find(const LockFile *lf, const char *name);
 const char *lock_find_sha(const LockFile *lf, const char *name);
 int  lock_update_entry(LockFile *lf, const char *name, const char *git, const char *sha);
+const char *lock_find_sha256(const LockFile *lf, const char *name);
+int  lock_update_archive(LockFile *lf, const char *name, const char *url,
+                         const char *sha256);
+LockEntry *lock_upsert(LockFile *lf, const char *name);
+int  lock_add_dep(LockEntry *e, const char *name);
+void lock_clear_deps(LockEntry *e);
+void lock_remove(LockFile *lf, const char *name);
 
 #endif
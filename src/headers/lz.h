@@ -0,0 +1,22 @@
+#ifndef GOOSE_LZ_H
+#define GOOSE_LZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* small LZ77 codec for vendored sources: a control byte flags the next
+ * eight items as a literal byte or a (distance, length) back-reference
+ * into the previous 64 KiB. fast to decode, no dependencies. */
+
+/* largest output lz_compress can produce for n input bytes */
+size_t lz_bound(size_t n);
+
+/* compress n bytes into out (at least lz_bound(n) bytes); returns the
+ * compressed size, 0 on allocation failure */
+size_t lz_compress(const uint8_t *in, size_t n, uint8_t *out);
+
+/* decompress exactly out_size bytes; returns 0, -1 on corrupt input */
+int    lz_decompress(const uint8_t *in, size_t n, uint8_t *out,
+                     size_t out_size);
+
+#endif
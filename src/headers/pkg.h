@@ -3,6 +3,8 @@
 
 #include "config.h"
 #include "lock.h"
+#include "resolve.h"
+#include "sched.h"
 
 /* forward declaration */
 typedef struct GooseFramework GooseFramework;
@@ -11,8 +13,29 @@ int   pkg_fetch(const Dependency *dep, const char *pkg_dir, LockFile *lf,
                 GooseFramework *fw);
 int   pkg_remove(const char *name, const char *pkg_dir);
 int   pkg_fetch_all(const Config *cfg, LockFile *lf, GooseFramework *fw);
-int   pkg_update_all(const Config *cfg, LockFile *lf, GooseFramework *fw);
+int   pkg_resolve(const Config *cfg, LockFile *lf, GooseFramework *fw,
+                  DepGraph *g);
+/* resolving on a caller's scheduler, so fetching overlaps other work.
+ * start queues the fetch jobs; once the scheduler has run, finish orders
+ * the graph and records it in the lock. on_ready, if set, runs as a job
+ * once a package and every package it depends on are on disk */
+typedef struct PkgResolve PkgResolve;
+typedef int (*pkg_ready_fn)(const Dependency *dep, Sched *s, void *ctx);
+PkgResolve *pkg_resolve_start(const Config *cfg, LockFile *lf,
+                              GooseFramework *fw, DepGraph *g, Sched *s,
+                              pkg_ready_fn on_ready, void *ctx);
+int   pkg_resolve_finish(PkgResolve *r, int sched_rc);
+int   pkg_update_all(const Config *cfg, LockFile *lf, GooseFramework *fw,
+                     int *failed);
+/* every workspace member's dependencies as one config to resolve in the
+ * root. fails if two members want one package from different sources */
+int   pkg_workspace_deps(const Config *root, GooseFramework *fw, Config *out);
+/* pack every resolved git/archive package of g into fw->vendor_file */
+int   pkg_vendor(const DepGraph *g, GooseFramework *fw);
 char *pkg_name_from_git(const char *git_url);
 int   pkg_get_sha(const char *pkg_path, char *sha, int sha_size);
+int   pkg_content_id(const Dependency *dep, const char *pkg_dir,
+                     char *buf, int bufsz);
+int   pkg_is_archive_url(const char *url);
 
 #endif
@@ -0,0 +1,37 @@
+#ifndef GOOSE_RESOLVE_H
+#define GOOSE_RESOLVE_H
+
+#include "config.h"
+
+/* one package in the resolved dependency graph. node 0 is always the root
+ * project; every other node is a dependency, deduplicated by name and
+ * source. */
+typedef struct {
+    Dependency dep;              /* as declared, path rebased onto the root */
+    char base[MAX_PATH_LEN];     /* directory the package lives in */
+    char key[MAX_PATH_LEN + 80]; /* source identity used for dedupe */
+    int parent;                  /* node that first requested this one */
+    int *children;
+    int child_count;
+    int child_cap;
+} DepNode;
+
+typedef struct {
+    DepNode *nodes;
+    int count;
+    int cap;
+    int *order;      /* dependency nodes, dependencies before dependents */
+    int order_count;
+} DepGraph;
+
+int  dep_graph_init(DepGraph *g, const Config *root, const char *root_dir,
+                    const char *pkg_dir);
+int  dep_graph_add(DepGraph *g, int parent, const Dependency *dep,
+                   const char *pkg_dir);
+int  dep_graph_add_rebased(DepGraph *g, int parent, const Dependency *dep,
+                           const char *pkg_dir);
+int  dep_graph_order(DepGraph *g);
+int  dep_graph_flatten(const DepGraph *g, Config *cfg);
+void dep_graph_free(DepGraph *g);
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef GOOSE_SCHED_H
+#define GOOSE_SCHED_H
+
+/* a job graph run to completion by one scheduler. command jobs run as child
+ * shells, up to `jobs` at a time; function jobs run inline between them and
+ * may queue more jobs, so a phase can expand the graph as it learns what
+ * comes next (e.g. a package's own dependencies once it is fetched). */
+typedef struct Sched Sched;
+
+typedef int (*sched_job_fn)(Sched *s, void *ctx, int arg);
+
+/* jobs <= 0 means one per online CPU */
+Sched *sched_new(int jobs);
+void   sched_free(Sched *s);
+
+/* queue a shell command; fail_msg is reported if it exits non-zero.
+ * returns the job id, -1 on allocation failure */
+int  sched_cmd(Sched *s, const char *cmd, const char *fail_msg);
+/* queue fn(s, ctx, arg); a non-zero return fails the job */
+int  sched_fn(Sched *s, sched_job_fn fn, void *ctx, int arg);
+
+/* job waits for prereq (a no-op once prereq is done) */
+int  sched_after(Sched *s, int job, int prereq);
+/* job waits for every job in [from, to) */
+int  sched_after_range(Sched *s, int job, int from, int to);
+/* start job ahead of ordinary jobs once it is runnable */
+void sched_first(Sched *s, int job);
+
+/* number of jobs queued so far; the id the next job will get */
+int  sched_size(const Sched *s);
+int  sched_jobs(const Sched *s);
+
+/* run until every job finished. after the first failure nothing new
+ * starts, running commands are waited for, and -1 is returned. returns -2
+ * if jobs remain that wait on each other */
+int  sched_run(Sched *s);
+
+/* let sched_run start independent jobs after a failure. jobs waiting on
+ * a failed one never start; sched_run still returns -1 */
+void sched_keep_going(Sched *s);
+/* with keep_going: job runs once its prerequisites finished, whether
+ * they succeeded, failed or were skipped (e.g. to report on them) */
+void sched_always(Sched *s, int job);
+
+enum { SCHED_PENDING, SCHED_DONE, SCHED_FAILED };
+
+/* how a job ended, SCHED_PENDING if it never ran */
+int    sched_status(const Sched *s, int job);
+/* wall-clock seconds a command job ran for */
+double sched_seconds(const Sched *s, int job);
+/* wait status of a finished command job, as waitpid reports it */
+int    sched_exit_status(const Sched *s, int job);
+/* peak resident memory of a finished command job in KiB */
+long   sched_max_rss(const Sched *s, int job);
+
+/* kill command job once it ran for seconds. it gets a process group of
+ * its own, so whatever it started dies with it */
+void   sched_timeout(Sched *s, int job, double seconds);
+/* whether job was killed by its timeout */
+int    sched_timed_out(const Sched *s, int job);
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef GOOSE_STATS_H
+#define GOOSE_STATS_H
+
+/* robust summaries of benchmark samples. medians and the median absolute
+ * deviation shrug off the odd preempted sample that would drag a mean
+ * and standard deviation along */
+typedef struct {
+    int    n;
+    double min;
+    double median;
+    double mad;     /* median of |x - median| */
+    double p99;
+    double mean;
+} Stats;
+
+/* the q-quantile (0..1) of n sorted values, interpolating between the two
+ * nearest ranks */
+double stats_quantile(const double *sorted, int n, double q);
+
+/* summarize n samples; they are not modified. returns -1 if n is 0 or
+ * memory runs out */
+int    stats_summary(const double *samples, int n, Stats *out);
+
+/* how the median moved from a baseline to a new set of samples, as a
+ * fraction of the baseline's (0.05 = 5% slower), with a bootstrap
+ * confidence interval around it */
+typedef struct {
+    double change;
+    double lo;
+    double hi;
+} StatsChange;
+
+/* compare base and cur by resampling both with replacement and taking
+ * the central `level` (e.g. 0.95) of the resampled changes. the resampling
+ * is seeded, so the same samples always give the same interval. returns
+ * -1 if either side is empty, has a zero median or memory runs out */
+int    stats_compare(const double *base, int nb, const double *cur, int nc,
+                     double level, StatsChange *out);
+
+#endif
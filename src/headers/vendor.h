@@ -0,0 +1,41 @@
+#ifndef GOOSE_VENDOR_H
+#define GOOSE_VENDOR_H
+
+#include "config.h"
+#include "sha256.h"
+
+/* a vendor archive holds a snapshot of every locked package in one file.
+ * each distinct file content is stored once, compressed, and an index at
+ * the end maps packages to their files, so one package can be unpacked
+ * without reading the others. */
+
+/* one package snapshot: where it came from and which revision it is */
+typedef struct {
+    char name[MAX_NAME_LEN];
+    char git[MAX_PATH_LEN];
+    char url[MAX_PATH_LEN];
+    char version[64];
+    char subdir[MAX_PATH_LEN];
+    char rev[SHA256_HEX_LEN];   /* git commit or archive digest */
+    int  first_file;            /* index entries, set when reading */
+    int  file_count;
+} VendorPkg;
+
+typedef struct Vendor Vendor;
+
+/* pack pkg_dir/<name> of each package into path. the output only depends
+ * on the package contents, so the same lock gives the same archive */
+int  vendor_write(const char *path, const VendorPkg *pkgs, int count,
+                  const char *pkg_dir);
+
+/* NULL if path does not exist or is not a vendor archive */
+Vendor *vendor_open(const char *path);
+void    vendor_close(Vendor *v);
+
+/* the snapshot of dep at revision rev ("" accepts any), NULL if none */
+const VendorPkg *vendor_find(const Vendor *v, const Dependency *dep,
+                             const char *rev);
+/* unpack a snapshot into dest, which must not exist yet */
+int  vendor_extract(Vendor *v, const VendorPkg *p, const char *dest);
+
+#endif
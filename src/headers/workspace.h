@@ -0,0 +1,27 @@
+#ifndef GOOSE_WORKSPACE_H
+#define GOOSE_WORKSPACE_H
+
+#include "config.h"
+#include "framework.h"
+
+/* members of a workspace and the path dependencies between them */
+typedef struct {
+    int n;
+    const char **dirs;           /* as declared, owned by the root config */
+    char (*names)[MAX_NAME_LEN]; /* project names */
+    unsigned char *dep;          /* dep[i * n + j]: member i needs member j */
+} WsGraph;
+
+/* the member graph of root, cached in build/workspace.graph until a
+ * member config changes */
+int  ws_graph_load(const Config *root, GooseFramework *fw, WsGraph *g);
+void ws_graph_free(WsGraph *g);
+
+/* mark members named with -p / --package as 2 and what they depend on as
+ * 1, or every member as 1 without -p. returns how many were named, -1
+ * for an unknown member */
+int  ws_select(const WsGraph *g, int argc, char **argv, int *selected);
+/* selected members, dependencies first. returns how many were ordered */
+int  ws_order(const WsGraph *g, const int *selected, int *order);
+
+#endif
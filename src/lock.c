@@ -1,16 +1,157 @@
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
 #include "headers/lock.h"
 #include "headers/main.h"
 
+/* --- name index --- */
+
+static uint32_t name_hash(const char *s) {
+    uint32_t h = 2166136261u;
+    for (; *s; s++) {
+        h ^= (unsigned char)*s;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int index_rebuild(LockFile *lf) {
+    int cap = 16;
+    while (cap < lf->count * 2) cap *= 2;
+
+    if (cap != lf->index_cap) {
+        int *index = realloc(lf->index, cap * sizeof(int));
+        if (!index) return -1;
+        lf->index = index;
+        lf->index_cap = cap;
+    }
+    for (int i = 0; i < cap; i++) lf->index[i] = -1;
+
+    for (int i = 0; i < lf->count; i++) {
+        uint32_t slot = name_hash(lf->entries[i].name) & (cap - 1);
+        while (lf->index[slot] >= 0)
+            slot = (slot + 1) & (cap - 1);
+        lf->index[slot] = i;
+    }
+    return 0;
+}
+
+LockEntry *lock_find(const LockFile *lf, const char *name) {
+    if (lf->index_cap == 0) return NULL;
+
+    uint32_t slot = name_hash(name) & (lf->index_cap - 1);
+    while (lf->index[slot] >= 0) {
+        LockEntry *e = &lf->entries[lf->index[slot]];
+        if (strcmp(e->name, name) == 0) return e;
+        slot = (slot + 1) & (lf->index_cap - 1);
+    }
+    return NULL;
+}
+
+LockEntry *lock_upsert(LockFile *lf, const char *name) {
+    LockEntry *e = lock_find(lf, name);
+    if (e) return e;
+
+    if (lf->count == lf->cap) {
+        int cap = lf->cap ? lf->cap * 2 : 16;
+        LockEntry *entries = realloc(lf->entries, cap * sizeof(LockEntry));
+        if (!entries) return NULL;
+        lf->entries = entries;
+        lf->cap = cap;
+    }
+
+    e = &lf->entries[lf->count++];
+    memset(e, 0, sizeof(LockEntry));
+    strncpy(e->name, name, MAX_NAME_LEN - 1);
+
+    /* keep the table at most half full */
+    if (lf->count * 2 > lf->index_cap) {
+        if (index_rebuild(lf) != 0) return NULL;
+    } else {
+        uint32_t slot = name_hash(e->name) & (lf->index_cap - 1);
+        while (lf->index[slot] >= 0)
+            slot = (slot + 1) & (lf->index_cap - 1);
+        lf->index[slot] = lf->count - 1;
+    }
+    return e;
+}
+
+int lock_add_dep(LockEntry *e, const char *name) {
+    for (int i = 0; i < e->dep_count; i++)
+        if (strcmp(e->deps[i], name) == 0) return 0;
+
+    if (e->dep_count == e->dep_cap) {
+        int cap = e->dep_cap ? e->dep_cap * 2 : 4;
+        char **deps = realloc(e->deps, cap * sizeof(char *));
+        if (!deps) return -1;
+        e->deps = deps;
+        e->dep_cap = cap;
+    }
+    e->deps[e->dep_count] = strdup(name);
+    if (!e->deps[e->dep_count]) return -1;
+    e->dep_count++;
+    return 0;
+}
+
+void lock_clear_deps(LockEntry *e) {
+    for (int i = 0; i < e->dep_count; i++)
+        free(e->deps[i]);
+    free(e->deps);
+    e->deps = NULL;
+    e->dep_count = 0;
+    e->dep_cap = 0;
+}
+
+void lock_remove(LockFile *lf, const char *name) {
+    LockEntry *e = lock_find(lf, name);
+    if (!e) return;
+
+    lock_clear_deps(e);
+    int idx = (int)(e - lf->entries);
+    memmove(&lf->entries[idx], &lf->entries[idx + 1],
+            (lf->count - idx - 1) * sizeof(LockEntry));
+    lf->count--;
+    index_rebuild(lf);
+}
+
+void lock_free(LockFile *lf) {
+    for (int i = 0; i < lf->count; i++)
+        lock_clear_deps(&lf->entries[i]);
+    lock_clear_deps(&lf->root);
+    free(lf->entries);
+    free(lf->index);
+    memset(lf, 0, sizeof(LockFile));
+}
+
+/* --- parsing --- */
+
+/* parse a `["a", "b"]` list into e's dependency names */
+static void parse_list(const char *val, LockEntry *e) {
+    const char *p = val;
+    while ((p = strchr(p, '"')) != NULL) {
+        const char *end = strchr(++p, '"');
+        if (!end) break;
+        char name[MAX_NAME_LEN];
+        int len = (int)(end - p);
+        if (len >= MAX_NAME_LEN) len = MAX_NAME_LEN - 1;
+        memcpy(name, p, len);
+        name[len] = '\0';
+        lock_add_dep(e, name);
+        p = end + 1;
+    }
+}
+
 int lock_load(const char *path, LockFile *lf) {
     memset(lf, 0, sizeof(LockFile));
+    lf->version = 1;
+    index_rebuild(lf);
 
     FILE *f = fopen(path, "r");
     if (!f)
         return -1;
 
-    char line[1024];
+    char line[8192];
     LockEntry *cur = NULL;
 
     while (fgets(line, sizeof(line), f)) {
@@ -18,13 +159,15 @@ int lock_load(const char *path, LockFile *lf) {
         line[strcspn(line, "\n")] = '\0';
 
         if (strncmp(line, "[[package]]", 11) == 0) {
-            if (lf->count >= MAX_DEPS) break;
-            cur = &lf->entries[lf->count++];
-            memset(cur, 0, sizeof(LockEntry));
+            /* entries are keyed by name, so start a scratch record and
+             * insert it once the name line arrives */
+            cur = NULL;
+            continue;
+        }
+        if (strncmp(line, "[root]", 6) == 0) {
+            cur = &lf->root;
             continue;
         }
-
-        if (!cur) continue;
 
         char *eq = strchr(line, '=');
         if (!eq) continue;
@@ -36,62 +179,184 @@ int lock_load(const char *path, LockFile *lf) {
         char *kend = eq - 1;
         while (kend > key && *kend == ' ') *kend-- = '\0';
 
+        char *raw = eq + 1;
+        while (*raw == ' ') raw++;
+
+        if (!cur && strcmp(key, "version") == 0) {
+            lf->version = atoi(raw);
+            continue;
+        }
+
+        /* list values keep their quotes for parse_list */
+        if (strcmp(key, "dependencies") == 0) {
+            if (cur) parse_list(raw, cur);
+            continue;
+        }
+        if (strcmp(key, "dependents") == 0)
+            continue; /* derived from dependencies on save */
+
         /* trim value (strip quotes) */
-        char *val = eq + 1;
-        while (*val == ' ' || *val == '"') val++;
+        char *val = raw;
+        while (*val == '"') val++;
         char *vend = val + strlen(val) - 1;
-        while (vend > val && (*vend == '"' || *vend == ' ')) *vend-- = '\0';
+        while (vend >= val && (*vend == '"' || *vend == ' ')) *vend-- = '\0';
+
+        if (strcmp(key, "name") == 0) {
+            if (cur == &lf->root)
+                strncpy(cur->name, val, MAX_NAME_LEN - 1);
+            else
+                cur = lock_upsert(lf, val);
+            continue;
+        }
+        if (!cur) continue;
 
-        if (strcmp(key, "name") == 0)
-            strncpy(cur->name, val, MAX_NAME_LEN - 1);
-        else if (strcmp(key, "git") == 0)
+        if (strcmp(key, "git") == 0)
             strncpy(cur->git, val, MAX_PATH_LEN - 1);
+        else if (strcmp(key, "version") == 0)
+            strncpy(cur->version, val, sizeof(cur->version) - 1);
         else if (strcmp(key, "sha") == 0)
             strncpy(cur->sha, val, MAX_SHA_LEN - 1);
+        else if (strcmp(key, "url") == 0)
+            strncpy(cur->url, val, MAX_PATH_LEN - 1);
+        else if (strcmp(key, "sha256") == 0)
+            strncpy(cur->sha256, val, SHA256_HEX_LEN - 1);
+        else if (strcmp(key, "path") == 0)
+            strncpy(cur->path, val, MAX_PATH_LEN - 1);
+        else if (strcmp(key, "subdir") == 0)
+            strncpy(cur->subdir, val, MAX_PATH_LEN - 1);
+        else if (strcmp(key, "tree") == 0)
+            strncpy(cur->tree, val, SHA256_HEX_LEN - 1);
     }
 
     fclose(f);
     return 0;
 }
 
+/* --- saving --- */
+
+static int cmp_entry_name(const void *a, const void *b) {
+    const LockEntry *ea = *(const LockEntry *const *)a;
+    const LockEntry *eb = *(const LockEntry *const *)b;
+    return strcmp(ea->name, eb->name);
+}
+
+static void write_list(FILE *f, const char *key, char **names, int count) {
+    fprintf(f, "%s = [", key);
+    for (int i = 0; i < count; i++)
+        fprintf(f, "%s\"%s\"", i ? ", " : "", names[i]);
+    fprintf(f, "]\n");
+}
+
+static int entry_requires(const LockEntry *e, const char *name) {
+    for (int i = 0; i < e->dep_count; i++)
+        if (strcmp(e->deps[i], name) == 0) return 1;
+    return 0;
+}
+
 int lock_save(const char *path, const LockFile *lf) {
     FILE *f = fopen(path, "w");
     if (!f) return -1;
 
-    fprintf(f, "# goose.lock - auto-generated, do not edit\n\n");
+    fprintf(f, "# goose.lock - auto-generated, do not edit\n");
+    fprintf(f, "version = %d\n\n", LOCK_VERSION);
+
+    if (lf->root.name[0]) {
+        fprintf(f, "[root]\n");
+        fprintf(f, "name = \"%s\"\n", lf->root.name);
+        write_list(f, "dependencies", lf->root.deps, lf->root.dep_count);
+        fprintf(f, "\n");
+    }
+
+    /* sorted by name so the file diffs cleanly */
+    const LockEntry **sorted = malloc((lf->count + 1) * sizeof(LockEntry *));
+    if (!sorted) {
+        fclose(f);
+        return -1;
+    }
+    for (int i = 0; i < lf->count; i++)
+        sorted[i] = &lf->entries[i];
+    qsort(sorted, lf->count, sizeof(LockEntry *), cmp_entry_name);
+
+    char **parents = malloc((lf->count + 1) * sizeof(char *));
     for (int i = 0; i < lf->count; i++) {
+        const LockEntry *e = sorted[i];
         fprintf(f, "[[package]]\n");
-        fprintf(f, "name = \"%s\"\n", lf->entries[i].name);
-        fprintf(f, "git = \"%s\"\n", lf->entries[i].git);
-        fprintf(f, "sha = \"%s\"\n\n", lf->entries[i].sha);
+        fprintf(f, "name = \"%s\"\n", e->name);
+        if (e->path[0]) {
+            fprintf(f, "path = \"%s\"\n", e->path);
+        } else if (e->url[0]) {
+            /* archive dependency: pinned by content digest */
+            fprintf(f, "url = \"%s\"\n", e->url);
+            fprintf(f, "sha256 = \"%s\"\n", e->sha256);
+        } else {
+            fprintf(f, "git = \"%s\"\n", e->git);
+            if (e->version[0])
+                fprintf(f, "version = \"%s\"\n", e->version);
+            fprintf(f, "sha = \"%s\"\n", e->sha);
+        }
+        if (!e->path[0] && e->subdir[0])
+            fprintf(f, "subdir = \"%s\"\n", e->subdir);
+        if (e->tree[0])
+            fprintf(f, "tree = \"%s\"\n", e->tree);
+
+        /* the graph is stored both ways so either direction is a lookup */
+        write_list(f, "dependencies", e->deps, e->dep_count);
+        int np = 0;
+        if (parents) {
+            if (lf->root.name[0] && entry_requires(&lf->root, e->name))
+                parents[np++] = (char *)lf->root.name;
+            for (int j = 0; j < lf->count; j++)
+                if (entry_requires(sorted[j], e->name))
+                    parents[np++] = (char *)sorted[j]->name;
+        }
+        write_list(f, "dependents", parents, np);
+        fprintf(f, "\n");
     }
 
+    free(parents);
+    free(sorted);
     fclose(f);
     return 0;
 }
 
+/* --- lookups and updates --- */
+
 const char *lock_find_sha(const LockFile *lf, const char *name) {
-    for (int i = 0; i < lf->count; i++) {
-        if (strcmp(lf->entries[i].name, name) == 0)
-            return lf->entries[i].sha;
-    }
-    return NULL;
+    LockEntry *e = lock_find(lf, name);
+    return e ? e->sha : NULL;
 }
 
 int lock_update_entry(LockFile *lf, const char *name, const char *git, const char *sha) {
-    for (int i = 0; i < lf->count; i++) {
-        if (strcmp(lf->entries[i].name, name) == 0) {
-            strncpy(lf->entries[i].sha, sha, MAX_SHA_LEN - 1);
-            strncpy(lf->entries[i].git, git, MAX_PATH_LEN - 1);
-            return 0;
-        }
-    }
-    if (lf->count >= MAX_DEPS) return -1;
+    LockEntry *e = lock_upsert(lf, name);
+    if (!e) return -1;
 
-    LockEntry *e = &lf->entries[lf->count++];
-    memset(e, 0, sizeof(LockEntry));
-    strncpy(e->name, name, MAX_NAME_LEN - 1);
-    strncpy(e->git, git, MAX_PATH_LEN - 1);
+    /* a different revision invalidates the recorded tree hash */
+    if (strcmp(e->sha, sha) != 0)
+        e->tree[0] = '\0';
     strncpy(e->sha, sha, MAX_SHA_LEN - 1);
+    strncpy(e->git, git, MAX_PATH_LEN - 1);
+    e->url[0] = '\0';
+    e->sha256[0] = '\0';
+    e->path[0] = '\0';
+    return 0;
+}
+
+const char *lock_find_sha256(const LockFile *lf, const char *name) {
+    LockEntry *e = lock_find(lf, name);
+    return e ? e->sha256 : NULL;
+}
+
+int lock_update_archive(LockFile *lf, const char *name, const char *url,
+                        const char *sha256) {
+    LockEntry *e = lock_upsert(lf, name);
+    if (!e) return -1;
+
+    if (strcmp(e->sha256, sha256) != 0)
+        e->tree[0] = '\0';
+    strncpy(e->url, url, MAX_PATH_LEN - 1);
+    strncpy(e->sha256, sha256, SHA256_HEX_LEN - 1);
+    e->git[0] = '\0';
+    e->sha[0] = '\0';
+    e->path[0] = '\0';
     return 0;
 }
@@ -0,0 +1,108 @@
+#include <stdlib.h>
+#include <string.h>
+#include "headers/lz.h"
+
+#define LZ_WINDOW    65536
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_MATCH (LZ_MIN_MATCH + 255)
+#define LZ_HASH_BITS 15
+#define LZ_CHAIN     32
+
+size_t lz_bound(size_t n) {
+    /* all literals: one control byte per eight */
+    return n + n / 8 + 16;
+}
+
+static uint32_t hash4(const uint8_t *p) {
+    uint32_t v = (uint32_t)p[0] | (uint32_t)p[1] << 8 |
+                 (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+size_t lz_compress(const uint8_t *in, size_t n, uint8_t *out) {
+    int32_t *head = malloc(((size_t)1 << LZ_HASH_BITS) * sizeof(int32_t));
+    int32_t *prev = malloc(LZ_WINDOW * sizeof(int32_t));
+    if (!head || !prev) {
+        free(head);
+        free(prev);
+        return 0;
+    }
+    memset(head, 0xff, ((size_t)1 << LZ_HASH_BITS) * sizeof(int32_t));
+
+    size_t o = 0, ctrl = 0, i = 0;
+    int bit = 8;
+    while (i < n) {
+        if (bit == 8) {
+            ctrl = o++;
+            out[ctrl] = 0;
+            bit = 0;
+        }
+
+        /* longest earlier match along the hash chain */
+        size_t best_len = 0, best_dist = 0;
+        if (i + LZ_MIN_MATCH <= n) {
+            size_t max = n - i < LZ_MAX_MATCH ? n - i : LZ_MAX_MATCH;
+            int32_t cand = head[hash4(in + i)];
+            for (int chain = LZ_CHAIN;
+                 cand >= 0 && i - (size_t)cand <= LZ_WINDOW && chain > 0;
+                 chain--) {
+                size_t l = 0;
+                while (l < max && in[cand + l] == in[i + l]) l++;
+                if (l > best_len) {
+                    best_len = l;
+                    best_dist = i - (size_t)cand;
+                    if (l == max) break;
+                }
+                cand = prev[cand & (LZ_WINDOW - 1)];
+            }
+        }
+
+        size_t step = 1;
+        if (best_len >= LZ_MIN_MATCH) {
+            out[ctrl] |= (uint8_t)(1 << bit);
+            out[o++] = (uint8_t)((best_dist - 1) & 0xff);
+            out[o++] = (uint8_t)((best_dist - 1) >> 8);
+            out[o++] = (uint8_t)(best_len - LZ_MIN_MATCH);
+            step = best_len;
+        } else {
+            out[o++] = in[i];
+        }
+        bit++;
+
+        for (size_t end = i + step; i < end; i++) {
+            if (i + LZ_MIN_MATCH > n) continue;
+            uint32_t h = hash4(in + i);
+            prev[i & (LZ_WINDOW - 1)] = head[h];
+            head[h] = (int32_t)i;
+        }
+    }
+
+    free(head);
+    free(prev);
+    return o;
+}
+
+int lz_decompress(const uint8_t *in, size_t n, uint8_t *out,
+                  size_t out_size) {
+    size_t i = 0, o = 0;
+    while (o < out_size) {
+        if (i >= n) return -1;
+        uint8_t ctrl = in[i++];
+        for (int bit = 0; bit < 8 && o < out_size; bit++) {
+            if (!(ctrl & (1 << bit))) {
+                if (i >= n) return -1;
+                out[o++] = in[i++];
+                continue;
+            }
+            if (i + 3 > n) return -1;
+            size_t dist = ((size_t)in[i] | (size_t)in[i + 1] << 8) + 1;
+            size_t len = (size_t)in[i + 2] + LZ_MIN_MATCH;
+            i += 3;
+            if (dist > o || len > out_size - o) return -1;
+            /* byte by byte: a match may overlap what it produces */
+            for (size_t k = 0; k < len; k++, o++)
+                out[o] = out[o - dist];
+        }
+    }
+    return i == n ? 0 : -1;
+}
@@ -1,10 +1,17 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <strings.h>
+#include <dirent.h>
+#include <signal.h>
+#include <sys/stat.h>
 #include "headers/pkg.h"
 #include "headers/framework.h"
 #include "headers/fs.h"
 #include "headers/color.h"
+#include "headers/sha256.h"
+#include "headers/resolve.h"
+#include "headers/vendor.h"
 
 char *pkg_name_from_git(const char *git_url) {
     static char name[128];
@@ -18,6 +25,18 @@ char *pkg_name_from_git(const char *git_url) {
     if (dot && dot[4] == '\0')
         *dot = '\0';
 
+    /* release archives: strip the archive extension */
+    static const char *exts[] = {".tar.gz", ".tgz", ".tar.xz", ".txz",
+                                 ".tar.bz2", ".tbz2", ".tar", NULL};
+    size_t len = strlen(name);
+    for (int i = 0; exts[i]; i++) {
+        size_t el = strlen(exts[i]);
+        if (len > el && strcmp(name + len - el, exts[i]) == 0) {
+            name[len - el] = '\0';
+            break;
+        }
+    }
+
     return name;
 }
 
@@ -37,88 +56,388 @@ int pkg_get_sha(const char *pkg_path, char *sha, int sha_size) {
     return 0;
 }
 
+static int has_commit(const char *pkg_path, const char *sha) {
+    char cmd[1024];
+    snprintf(cmd, sizeof(cmd),
+        "git -C '%s' cat-file -e '%s^{commit}' 2>/dev/null", pkg_path, sha);
+    return system(cmd) == 0;
+}
+
+/* move a checkout to exactly sha. only that commit is fetched (shallow,
+ * like the clone) unless it is already present; servers that refuse
+ * fetching by id get a plain fetch of origin instead. returns 0 once HEAD
+ * is sha */
 static int checkout_sha(const char *pkg_path, const char *sha) {
     char cmd[1024];
+    if (!has_commit(pkg_path, sha)) {
+        snprintf(cmd, sizeof(cmd),
+            "git -C '%s' fetch --quiet --depth 1 origin '%s' 2>/dev/null",
+            pkg_path, sha);
+        if (system(cmd) != 0 || !has_commit(pkg_path, sha)) {
+            snprintf(cmd, sizeof(cmd),
+                "git -C '%s' fetch --quiet origin 2>&1", pkg_path);
+            system(cmd);
+        }
+    }
+
     snprintf(cmd, sizeof(cmd),
-        "git -C '%s' fetch --quiet origin && git -C '%s' checkout --quiet '%s' 2>&1",
-        pkg_path, pkg_path, sha);
+        "git -C '%s' checkout --quiet '%s' 2>&1", pkg_path, sha);
+    char head[MAX_SHA_LEN] = {0};
+    if (system(cmd) != 0 || pkg_get_sha(pkg_path, head, sizeof(head)) != 0 ||
+        strcmp(head, sha) != 0)
+        return -1;
+    return 0;
+}
+
+/* move a checkout to the tip of ref (the remote's HEAD when empty) of
+ * git, which becomes its origin. shallow, like the clone */
+static int checkout_ref(const char *pkg_path, const char *git,
+                        const char *ref) {
+    char cmd[2048];
+    snprintf(cmd, sizeof(cmd),
+        "git -C '%s' remote set-url origin '%s' && "
+        "git -C '%s' fetch --quiet --depth 1 origin '%s' && "
+        "git -C '%s' checkout --quiet --detach FETCH_HEAD 2>&1",
+        pkg_path, git, pkg_path, ref[0] ? ref : "HEAD", pkg_path);
+    return system(cmd) == 0 ? 0 : -1;
+}
+
+/* limit a sparse checkout to one subtree (cone mode) */
+static int sparse_set(const char *pkg_path, const char *subdir) {
+    char cmd[2048];
+    snprintf(cmd, sizeof(cmd),
+        "git -C '%s' sparse-checkout set -- '%s' 2>&1", pkg_path, subdir);
     return system(cmd);
 }
 
-int pkg_fetch(const Dependency *dep, const char *pkg_dir, LockFile *lf,
-              GooseFramework *fw) {
-    const char *config_file = fw ? fw->config_file : "goose.yaml";
+/* marker recording the content identity of a non-git package checkout */
+#define REV_MARKER ".goose-rev"
 
-    /* path dependencies are local -- skip git operations */
-    if (dep->path[0]) {
-        if (!fs_exists(dep->path)) {
-            err("path dependency '%s' not found at %s", dep->name, dep->path);
-            return -1;
-        }
-        /* resolve transitive deps from path dep's config */
-        char sub_cfg_path[512];
-        snprintf(sub_cfg_path, sizeof(sub_cfg_path), "%s/%s", dep->path, config_file);
-        if (fs_exists(sub_cfg_path)) {
-            Config sub;
-            if (config_load(sub_cfg_path, &sub, fw) == 0 && sub.dep_count > 0) {
-                info("Resolving", "transitive dependencies for %s", dep->name);
-                for (int i = 0; i < sub.dep_count; i++)
-                    pkg_fetch(&sub.deps[i], pkg_dir, lf, fw);
-            }
+static int read_rev_marker(const char *pkg_path, char *buf, int bufsz) {
+    char marker[512];
+    snprintf(marker, sizeof(marker), "%s/%s", pkg_path, REV_MARKER);
+
+    FILE *f = fopen(marker, "r");
+    if (!f) return -1;
+    if (!fgets(buf, bufsz, f)) {
+        fclose(f);
+        return -1;
+    }
+    buf[strcspn(buf, "\n")] = '\0';
+    fclose(f);
+    return 0;
+}
+
+/* fixed identity of a fetched package's content: the commit of a git
+ * checkout or the digest of an archive. path packages are live trees and
+ * have none (-1) */
+int pkg_content_id(const Dependency *dep, const char *pkg_dir,
+                   char *buf, int bufsz) {
+    if (dep->path[0]) return -1;
+
+    char dest[1024];
+    snprintf(dest, sizeof(dest), "%s/%s", pkg_dir, dep->name);
+    if (dep->url[0])
+        return read_rev_marker(dest, buf, bufsz);
+
+    /* only trust HEAD of the package's own repository; a vendored
+     * snapshot has none and carries its commit in the marker */
+    char git_dir[1100];
+    snprintf(git_dir, sizeof(git_dir), "%s/.git", dest);
+    if (!fs_exists(git_dir))
+        return read_rev_marker(dest, buf, bufsz);
+
+    buf[0] = '\0';
+    if (pkg_get_sha(dest, buf, bufsz) != 0 || !buf[0]) return -1;
+    return 0;
+}
+
+/* tar decompression flag from the archive's extension, NULL if unsupported */
+static const char *archive_tar_flag(const char *url) {
+    static const struct { const char *ext; const char *flag; } kinds[] = {
+        {".tar.gz", "z"}, {".tgz", "z"},
+        {".tar.xz", "J"}, {".txz", "J"},
+        {".tar.bz2", "j"}, {".tbz2", "j"},
+        {".tar", ""},
+    };
+    /* ignore any query string on the URL */
+    size_t len = strcspn(url, "?#");
+    for (size_t i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i++) {
+        size_t el = strlen(kinds[i].ext);
+        if (len > el && strncmp(url + len - el, kinds[i].ext, el) == 0)
+            return kinds[i].flag;
+    }
+    return NULL;
+}
+
+/* move the extracted tree into place, unwrapping a single top-level
+ * directory (the usual "name-1.2.3/" layout of release tarballs) */
+static int archive_install(const char *tmp, const char *dest) {
+    DIR *d = opendir(tmp);
+    if (!d) return -1;
+
+    char only[256] = {0};
+    int entries = 0;
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
+            continue;
+        if (entries++ == 0)
+            strncpy(only, ent->d_name, sizeof(only) - 1);
+    }
+    closedir(d);
+
+    if (entries == 1) {
+        char inner[1024];
+        snprintf(inner, sizeof(inner), "%s/%s", tmp, only);
+        DIR *id = opendir(inner);
+        if (id) {
+            closedir(id);
+            if (rename(inner, dest) != 0) return -1;
+            return fs_rmrf(tmp);
         }
-        return 0;
+    }
+    return rename(tmp, dest);
+}
+
+/* append s to out as one shell word: single-quoted, with each ' in it
+ * closed, escaped and reopened */
+static void shell_quote(StrBuf *out, const char *s) {
+    strbuf_printf(out, "'");
+    for (; *s; s++) {
+        if (*s == '\'')
+            strbuf_printf(out, "'\\''");
+        else
+            strbuf_printf(out, "%c", *s);
+    }
+    strbuf_printf(out, "'");
+}
+
+/* download (or copy from file://) and extract an archive dependency into
+ * dest. the archive is hashed as it streams into tar, so verification costs
+ * no second pass; extraction happens in a scratch directory that is only
+ * moved into place once the digest matches. */
+static int fetch_archive(const Dependency *dep, const char *pkg_dir,
+                         const char *dest, const char *expect,
+                         char digest[SHA256_HEX_LEN]) {
+    const char *flag = archive_tar_flag(dep->url);
+    if (!flag) {
+        err("unsupported archive type for '%s': %s", dep->name, dep->url);
+        return -1;
+    }
+
+    FILE *in;
+    int in_is_pipe = 0;
+    if (strncmp(dep->url, "file://", 7) == 0) {
+        in = fopen(dep->url + 7, "rb");
+    } else if (strstr(dep->url, "://") == NULL) {
+        in = fopen(dep->url, "rb");
+    } else {
+        /* the URL comes from a config, maybe a dependency's */
+        StrBuf cmd;
+        strbuf_init(&cmd);
+        strbuf_printf(&cmd, "curl -fsSL ");
+        shell_quote(&cmd, dep->url);
+        in = popen(cmd.data, "r");
+        strbuf_free(&cmd);
+        in_is_pipe = 1;
+    }
+    if (!in) {
+        err("cannot open archive for '%s': %s", dep->name, dep->url);
+        return -1;
+    }
+
+    char tmp[512];
+    snprintf(tmp, sizeof(tmp), "%s/.%s.partial", pkg_dir, dep->name);
+    fs_rmrf(tmp);
+    fs_mkdir(pkg_dir);
+    if (fs_mkdir(tmp) != 0) {
+        err("cannot create %s", tmp);
+        if (in_is_pipe) pclose(in); else fclose(in);
+        return -1;
+    }
+
+    char tarcmd[1024];
+    snprintf(tarcmd, sizeof(tarcmd), "tar -x%sf - -C '%s'", flag, tmp);
+    FILE *tar = popen(tarcmd, "w");
+    if (!tar) {
+        err("cannot run tar for '%s'", dep->name);
+        if (in_is_pipe) pclose(in); else fclose(in);
+        fs_rmrf(tmp);
+        return -1;
+    }
+
+    /* a tar that dies early must surface as an error, not kill goose */
+    void (*old_pipe)(int) = signal(SIGPIPE, SIG_IGN);
+
+    Sha256 ctx;
+    sha256_init(&ctx);
+    char buf[65536];
+    size_t n;
+    int write_failed = 0;
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+        sha256_update(&ctx, buf, n);
+        if (!write_failed && fwrite(buf, 1, n, tar) != n)
+            write_failed = 1;
+    }
+    int read_failed = ferror(in);
+    sha256_final_hex(&ctx, digest);
+
+    int in_rc = in_is_pipe ? pclose(in) : (fclose(in), 0);
+    int tar_rc = pclose(tar);
+    signal(SIGPIPE, old_pipe);
+
+    if (read_failed || in_rc != 0) {
+        err("failed to download '%s' from %s", dep->name, dep->url);
+        fs_rmrf(tmp);
+        return -1;
+    }
+
+    if (expect && expect[0] && strcasecmp(expect, digest) != 0) {
+        err("sha256 mismatch for '%s'", dep->name);
+        fprintf(stderr, "    expected %s\n    got      %s\n", expect, digest);
+        fs_rmrf(tmp);
+        return -1;
+    }
+
+    if (write_failed || tar_rc != 0) {
+        err("failed to extract '%s' from %s", dep->name, dep->url);
+        fs_rmrf(tmp);
+        return -1;
     }
 
+    if (archive_install(tmp, dest) != 0) {
+        err("cannot move extracted '%s' into %s", dep->name, dest);
+        fs_rmrf(tmp);
+        return -1;
+    }
+
+    char marker[512];
+    snprintf(marker, sizeof(marker), "%s/%s", dest, REV_MARKER);
+    char line[SHA256_HEX_LEN + 1];
+    snprintf(line, sizeof(line), "%s\n", digest);
+    fs_write_file(marker, line);
+    return 0;
+}
+
+static int fetch_url_dep(const Dependency *dep, const char *pkg_dir,
+                         LockFile *lf, GooseFramework *fw) {
+    const char *config_file = fw ? fw->config_file : "goose.yaml";
+
     char dest[512];
     snprintf(dest, sizeof(dest), "%s/%s", pkg_dir, dep->name);
 
-    if (fs_exists(dest)) {
-        /* if lock has a SHA, ensure we're on it */
-        if (lf) {
-            const char *locked = lock_find_sha(lf, dep->name);
-            if (locked && strlen(locked) > 0) {
-                char cur_sha[MAX_SHA_LEN] = {0};
-                pkg_get_sha(dest, cur_sha, sizeof(cur_sha));
-                if (strcmp(cur_sha, locked) != 0) {
-                    info("Syncing", "%s to locked revision", dep->name);
-                    fflush(stdout);
-                    checkout_sha(dest, locked);
-                }
-            }
-        }
+    /* the digest to enforce: goose.yaml wins, otherwise whatever the lock
+     * pinned on first fetch */
+    const char *expect = dep->sha256;
+    if (!expect[0] && lf) {
+        const char *locked = lock_find_sha256(lf, dep->name);
+        if (locked && locked[0]) expect = locked;
+    }
 
-        /* try consumer conversion hook (e.g. CMakeLists.txt) */
-        if (fw && fw->on_pkg_convert) {
-            fw->on_pkg_convert(dest, config_file, fw->userdata);
+    if (fs_exists(dest)) {
+        char have[SHA256_HEX_LEN] = {0};
+        if (read_rev_marker(dest, have, sizeof(have)) == 0 &&
+            (!expect[0] || strcasecmp(have, expect) == 0)) {
+            if (lf) lock_update_archive(lf, dep->name, dep->url, have);
+            if (fw && fw->on_pkg_convert)
+                fw->on_pkg_convert(dest, config_file, fw->userdata);
+            return 0;
         }
+        info("Refetching", "%s (archive digest changed)", dep->name);
+        fs_rmrf(dest);
+    }
 
-        return 0;
+    if (fw && fw->offline && strstr(dep->url, "://") &&
+        strncmp(dep->url, "file://", 7) != 0) {
+        err("'%s' is not vendored and %s is offline", dep->name, fw->tool_name);
+        return -1;
     }
 
-    info("Fetching", "%s from %s", dep->name, dep->git);
+    info("Fetching", "%s from %s", dep->name, dep->url);
     fflush(stdout);
-    fs_mkdir(pkg_dir);
 
-    char cmd[1024];
+    char digest[SHA256_HEX_LEN] = {0};
+    if (fetch_archive(dep, pkg_dir, dest, expect, digest) != 0)
+        return -1;
+
+    if (!expect[0])
+        warn("Warn", "no sha256 for '%s'; pinned %s in lock", dep->name, digest);
+
+    if (lf) lock_update_archive(lf, dep->name, dep->url, digest);
+
+    if (fw && fw->on_pkg_convert)
+        fw->on_pkg_convert(dest, config_file, fw->userdata);
+    return 0;
+}
+
+int pkg_is_archive_url(const char *url) {
+    return archive_tar_flag(url) != NULL;
+}
+
+/* command that clones a git package not yet checked out, written to cmd.
+ * returns 0 when the package needs no clone */
+static int clone_command(const Dependency *dep, const char *pkg_dir,
+                         char *cmd, int cmdsz) {
+    if (dep->path[0] || dep->url[0]) return 0;
+
+    char dest[512];
+    snprintf(dest, sizeof(dest), "%s/%s", pkg_dir, dep->name);
+    if (fs_exists(dest)) return 0;
+
+    /* a subdir dependency only needs that subtree: partial clone without
+     * blobs, then a sparse checkout pulls in just the files under it */
+    char branch[128] = "";
     if (strlen(dep->version) > 0)
-        snprintf(cmd, sizeof(cmd),
-            "git clone --quiet --branch '%s' --depth 1 '%s' '%s' 2>&1",
-            dep->version, dep->git, dest);
+        snprintf(branch, sizeof(branch), "--branch '%s' ", dep->version);
+
+    if (dep->subdir[0])
+        snprintf(cmd, cmdsz,
+            "git clone --quiet --filter=blob:none --sparse %s--depth 1 '%s' '%s' 2>&1",
+            branch, dep->git, dest);
     else
-        snprintf(cmd, sizeof(cmd),
-            "git clone --quiet --depth 1 '%s' '%s' 2>&1",
-            dep->git, dest);
+        snprintf(cmd, cmdsz,
+            "git clone --quiet %s--depth 1 '%s' '%s' 2>&1",
+            branch, dep->git, dest);
+    return 1;
+}
 
-    int ret = system(cmd);
-    if (ret != 0) {
-        err("failed to fetch '%s' from %s", dep->name, dep->git);
-        return -1;
+/* settle a fresh clone: narrow it to its subdir, pin it in the lock and
+ * convert it */
+static int clone_finish(const Dependency *dep, const char *pkg_dir,
+                        LockFile *lf, GooseFramework *fw) {
+    const char *config_file = fw ? fw->config_file : "goose.yaml";
+
+    char dest[512];
+    snprintf(dest, sizeof(dest), "%s/%s", pkg_dir, dep->name);
+
+    if (dep->subdir[0]) {
+        char sub[1024];
+        snprintf(sub, sizeof(sub), "%s/%s", dest, dep->subdir);
+        if (sparse_set(dest, dep->subdir) != 0 || !fs_exists(sub)) {
+            err("'%s' has no directory '%s'", dep->name, dep->subdir);
+            fs_rmrf(dest);
+            return -1;
+        }
     }
 
-    /* record SHA in lock */
+    /* a fresh clone lands on the branch tip; a lock from the same source
+     * pins it back to the recorded commit */
     if (lf) {
         char sha[MAX_SHA_LEN] = {0};
         pkg_get_sha(dest, sha, sizeof(sha));
+        LockEntry *e = lock_find(lf, dep->name);
+        if (e && e->sha[0] && strcmp(e->git, dep->git) == 0 &&
+            strcmp(e->version, dep->version) == 0 && strcmp(e->sha, sha) != 0) {
+            info("Syncing", "%s to locked revision", dep->name);
+            if (checkout_sha(dest, e->sha) != 0) {
+                err("cannot check out locked revision %s of '%s'",
+                    e->sha, dep->name);
+                fs_rmrf(dest);
+                return -1;
+            }
+            snprintf(sha, sizeof(sha), "%s", e->sha);
+        }
         lock_update_entry(lf, dep->name, dep->git, sha);
     }
 
@@ -127,21 +446,581 @@ int pkg_fetch(const Dependency *dep, const char *pkg_dir, LockFile *lf,
         fw->on_pkg_convert(dest, config_file, fw->userdata);
     }
 
-    /* transitive deps: if package has config, fetch its deps */
-    char sub_cfg_path[512];
-    snprintf(sub_cfg_path, sizeof(sub_cfg_path), "%s/%s", dest, config_file);
-    if (fs_exists(sub_cfg_path)) {
-        Config sub;
-        if (config_load(sub_cfg_path, &sub, fw) == 0 && sub.dep_count > 0) {
-            info("Resolving", "transitive dependencies for %s", dep->name);
-            for (int i = 0; i < sub.dep_count; i++)
-                pkg_fetch(&sub.deps[i], pkg_dir, lf, fw);
+    return 0;
+}
+
+/* materialize a single package that needs no clone; its own dependencies
+ * are left to the resolver */
+static int fetch_one(const Dependency *dep, const char *pkg_dir, LockFile *lf,
+                     GooseFramework *fw) {
+    const char *config_file = fw ? fw->config_file : "goose.yaml";
+
+    /* path dependencies are local -- skip git operations */
+    if (dep->path[0]) {
+        if (!fs_exists(dep->path)) {
+            err("path dependency '%s' not found at %s", dep->name, dep->path);
+            return -1;
+        }
+        return 0;
+    }
+
+    /* archive dependencies are pinned by content digest, not a commit */
+    if (dep->url[0])
+        return fetch_url_dep(dep, pkg_dir, lf, fw);
+
+    char dest[512];
+    snprintf(dest, sizeof(dest), "%s/%s", pkg_dir, dep->name);
+
+    /* a vendored snapshot is no repository: nothing to sync, only check
+     * it is the locked revision */
+    char git_dir[1024];
+    snprintf(git_dir, sizeof(git_dir), "%s/.git", dest);
+    if (!fs_exists(git_dir)) {
+        char have[MAX_SHA_LEN] = {0};
+        const char *locked = lf ? lock_find_sha(lf, dep->name) : NULL;
+        if (read_rev_marker(dest, have, sizeof(have)) != 0) {
+            err("'%s' at %s is neither a git checkout nor vendored",
+                dep->name, dest);
+            return -1;
+        }
+        if (locked && locked[0] && strcmp(have, locked) != 0) {
+            err("vendored '%s' is at %s but the lock wants %s",
+                dep->name, have, locked);
+            return -1;
+        }
+        if (lf) lock_update_entry(lf, dep->name, dep->git, have);
+        if (fw && fw->on_pkg_convert)
+            fw->on_pkg_convert(dest, config_file, fw->userdata);
+        return 0;
+    }
+
+    /* subdir added or changed since the clone: widen the sparse set */
+    if (dep->subdir[0]) {
+        char sub[1024];
+        snprintf(sub, sizeof(sub), "%s/%s", dest, dep->subdir);
+        if (!fs_exists(sub) && sparse_set(dest, dep->subdir) != 0) {
+            err("'%s' has no directory '%s'", dep->name, dep->subdir);
+            return -1;
+        }
+    }
+
+    /* a lock from the same source pins the checkout. one for another URL
+     * or version is stale: the ref decides, and the lock follows */
+    const LockEntry *e = lf ? lock_find(lf, dep->name) : NULL;
+    if (e && e->sha[0] &&
+        (strcmp(e->git, dep->git) != 0 ||
+         strcmp(e->version, dep->version) != 0)) {
+        if (fw && fw->offline) {
+            err("'%s' is locked to another source or version and %s is "
+                "offline", dep->name, fw->tool_name);
+            return -1;
+        }
+        info("Syncing", "%s to %s", dep->name,
+             dep->version[0] ? dep->version : "the remote's HEAD");
+        fflush(stdout);
+        char sha[MAX_SHA_LEN] = {0};
+        if (checkout_ref(dest, dep->git, dep->version) != 0 ||
+            pkg_get_sha(dest, sha, sizeof(sha)) != 0) {
+            err("cannot check out %s of '%s' from %s",
+                dep->version[0] ? dep->version : "HEAD", dep->name, dep->git);
+            return -1;
+        }
+        lock_update_entry(lf, dep->name, dep->git, sha);
+    } else if (e && e->sha[0]) {
+        const char *locked = e->sha;
+        char cur_sha[MAX_SHA_LEN] = {0};
+        pkg_get_sha(dest, cur_sha, sizeof(cur_sha));
+        if (strcmp(cur_sha, locked) != 0) {
+            if (fw && fw->offline && !has_commit(dest, locked)) {
+                err("locked revision %s of '%s' is not available offline",
+                    locked, dep->name);
+                return -1;
+            }
+            info("Syncing", "%s to locked revision", dep->name);
+            fflush(stdout);
+            if (checkout_sha(dest, locked) != 0) {
+                err("cannot check out locked revision %s of '%s'",
+                    locked, dep->name);
+                return -1;
+            }
+        }
+    }
+
+    /* try consumer conversion hook (e.g. CMakeLists.txt) */
+    if (fw && fw->on_pkg_convert) {
+        fw->on_pkg_convert(dest, config_file, fw->userdata);
+    }
+
+    return 0;
+}
+
+/* fetching the graph as scheduler jobs. each node gets a fetch job; a git
+ * clone runs as a command beside whatever else is queued, and the package
+ * is settled and its config read once it lands. with a ready callback,
+ * each node also gets a job that fires once the node and everything it
+ * depends on are on disk. */
+struct PkgResolve {
+    DepGraph *g;
+    LockFile *lf;
+    GooseFramework *fw;
+    Sched *s;
+    const char *pkg_dir;
+    int expand;          /* read package configs for their own deps */
+    int *ready;          /* per node: its ready job, -1 if none */
+    int ready_cap;
+    pkg_ready_fn on_ready;
+    void *ready_ctx;
+    Vendor *vendor;      /* opened on first use */
+    int vendor_opened;
+};
+
+static void resolve_free(PkgResolve *r) {
+    if (!r) return;
+    vendor_close(r->vendor);
+    free(r->ready);
+    free(r);
+}
+
+/* the revision a package must be at: the locked commit when the lock has
+ * the same source, or the pinned archive digest. "" if any will do */
+static void wanted_rev(const Dependency *dep, const LockFile *lf,
+                       char *buf, int bufsz) {
+    buf[0] = '\0';
+    if (dep->url[0]) {
+        const char *locked = lf ? lock_find_sha256(lf, dep->name) : NULL;
+        snprintf(buf, bufsz, "%s", dep->sha256[0] ? dep->sha256
+                                  : locked ? locked : "");
+        return;
+    }
+    const LockEntry *e = lf ? lock_find(lf, dep->name) : NULL;
+    if (e && e->sha[0] && strcmp(e->git, dep->git) == 0 &&
+        strcmp(e->version, dep->version) == 0)
+        snprintf(buf, bufsz, "%s", e->sha);
+}
+
+/* unpack a package from the vendor archive when it is missing, or is a
+ * snapshot of another revision. returns 0 once unpacked, 1 if fetching
+ * should go on as usual, -1 on error */
+static int vendor_restore(PkgResolve *r, const Dependency *dep) {
+    if (dep->path[0] || !r->fw || !r->fw->vendor_file[0]) return 1;
+
+    char dest[512];
+    snprintf(dest, sizeof(dest), "%s/%s", r->pkg_dir, dep->name);
+    char want[SHA256_HEX_LEN];
+    wanted_rev(dep, r->lf, want, sizeof(want));
+
+    int present = fs_exists(dest);
+    if (present) {
+        char git_dir[1024];
+        snprintf(git_dir, sizeof(git_dir), "%s/.git", dest);
+        if (!dep->url[0] && fs_exists(git_dir)) return 1;
+        char have[SHA256_HEX_LEN] = {0};
+        if (read_rev_marker(dest, have, sizeof(have)) == 0 &&
+            (!want[0] || strcasecmp(have, want) == 0))
+            return 1;
+    }
+
+    if (!r->vendor_opened) {
+        r->vendor = vendor_open(r->fw->vendor_file);
+        r->vendor_opened = 1;
+    }
+    const VendorPkg *p = r->vendor ? vendor_find(r->vendor, dep, want) : NULL;
+    if (!p) {
+        /* a stale git snapshot makes way for a fresh clone */
+        if (present && !dep->url[0] && !r->fw->offline) fs_rmrf(dest);
+        return 1;
+    }
+
+    info("Unpacking", "%s from %s", dep->name, r->fw->vendor_file);
+    if (present) fs_rmrf(dest);
+    fs_mkdir(r->pkg_dir);
+    if (vendor_extract(r->vendor, p, dest) != 0) return -1;
+
+    /* written last: a snapshot without it is incomplete */
+    char marker[1024];
+    snprintf(marker, sizeof(marker), "%s/%s", dest, REV_MARKER);
+    char line[SHA256_HEX_LEN + 1];
+    snprintf(line, sizeof(line), "%s\n", p->rev);
+    fs_write_file(marker, line);
+
+    if (r->lf) {
+        if (dep->url[0])
+            lock_update_archive(r->lf, dep->name, dep->url, p->rev);
+        else
+            lock_update_entry(r->lf, dep->name, dep->git, p->rev);
+    }
+    if (r->fw->on_pkg_convert)
+        r->fw->on_pkg_convert(dest, r->fw->config_file, r->fw->userdata);
+    return 0;
+}
+
+static int queue_node(PkgResolve *r, int i);
+
+/* read node i's config and queue any package it adds to the graph */
+static int expand_node(PkgResolve *r, int i) {
+    if (!r->expand) return 0;
+    const char *config_file = r->fw ? r->fw->config_file : "goose.yaml";
+
+    char sub_cfg_path[1024];
+    snprintf(sub_cfg_path, sizeof(sub_cfg_path), "%s/%s",
+             r->g->nodes[i].base, config_file);
+    if (!fs_exists(sub_cfg_path)) return 0;
+
+    Config sub;
+    if (config_load(sub_cfg_path, &sub, r->fw) != 0)
+        return 0;
+    if (sub.dep_count > 0)
+        info("Resolving", "transitive dependencies for %s",
+             r->g->nodes[i].dep.name);
+
+    int rc = 0;
+    for (int j = 0; j < sub.dep_count && rc == 0; j++) {
+        int before = r->g->count;
+        int c = dep_graph_add(r->g, i, &sub.deps[j], r->pkg_dir);
+        if (c < 0) {
+            rc = -1;
+            break;
         }
+        if (r->g->count > before)
+            rc = queue_node(r, c);
+        /* a self-edge is left for dep_graph_order to report */
+        if (rc == 0 && r->on_ready && c != i)
+            rc = sched_after(r->s, r->ready[i], r->ready[c]);
+    }
+    config_free(&sub);
+    return rc;
+}
+
+static int cloned_job(Sched *s, void *ctx, int i) {
+    (void)s;
+    PkgResolve *r = ctx;
+    Dependency dep = r->g->nodes[i].dep;
+    if (clone_finish(&dep, r->pkg_dir, r->lf, r->fw) != 0)
+        return -1;
+    return expand_node(r, i);
+}
+
+static int fetch_job(Sched *s, void *ctx, int i) {
+    PkgResolve *r = ctx;
+    Dependency dep = r->g->nodes[i].dep;
+
+    int v = vendor_restore(r, &dep);
+    if (v < 0) return -1;
+    if (v == 0) return expand_node(r, i);
+
+    char cmd[2048];
+    if (!clone_command(&dep, r->pkg_dir, cmd, sizeof(cmd))) {
+        if (fetch_one(&dep, r->pkg_dir, r->lf, r->fw) != 0)
+            return -1;
+        return expand_node(r, i);
+    }
+
+    if (r->fw && r->fw->offline) {
+        err("'%s' is not vendored and %s is offline",
+            dep.name, r->fw->tool_name);
+        return -1;
+    }
+
+    info("Fetching", "%s from %s", dep.name, dep.git);
+    fs_mkdir(r->pkg_dir);
+
+    char msg[1024];
+    snprintf(msg, sizeof(msg), "failed to fetch '%s' from %s",
+             dep.name, dep.git);
+    int clone = sched_cmd(s, cmd, msg);
+    int land = sched_fn(s, cloned_job, r, i);
+    if (clone < 0 || land < 0 || sched_after(s, land, clone) != 0)
+        return -1;
+    sched_first(s, clone);
+    sched_first(s, land);
+    if (r->on_ready)
+        return sched_after(s, r->ready[i], land);
+    return 0;
+}
+
+static int ready_job(Sched *s, void *ctx, int i) {
+    PkgResolve *r = ctx;
+    return r->on_ready(&r->g->nodes[i].dep, s, r->ready_ctx);
+}
+
+static int queue_node(PkgResolve *r, int i) {
+    if (i >= r->ready_cap) {
+        int cap = r->ready_cap ? r->ready_cap * 2 : 16;
+        while (cap <= i) cap *= 2;
+        int *ready = realloc(r->ready, cap * sizeof(int));
+        if (!ready) return -1;
+        r->ready = ready;
+        r->ready_cap = cap;
+    }
+    r->ready[i] = -1;
+
+    int f = sched_fn(r->s, fetch_job, r, i);
+    if (f < 0) return -1;
+    sched_first(r->s, f);
+
+    if (r->on_ready) {
+        r->ready[i] = sched_fn(r->s, ready_job, r, i);
+        if (r->ready[i] < 0 || sched_after(r->s, r->ready[i], f) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+/* queue every node already in the graph, wiring ready jobs along the
+ * edges it already has */
+static int queue_graph(PkgResolve *r) {
+    for (int i = 1; i < r->g->count; i++)
+        if (queue_node(r, i) != 0)
+            return -1;
+    if (!r->on_ready) return 0;
+
+    for (int i = 1; i < r->g->count; i++) {
+        const DepNode *n = &r->g->nodes[i];
+        for (int c = 0; c < n->child_count; c++)
+            if (n->children[c] != i &&
+                sched_after(r->s, r->ready[i], r->ready[n->children[c]]) != 0)
+                return -1;
+    }
+    return 0;
+}
+
+static PkgResolve *resolve_new(DepGraph *g, LockFile *lf, GooseFramework *fw,
+                               Sched *s, pkg_ready_fn on_ready, void *ctx) {
+    PkgResolve *r = calloc(1, sizeof(PkgResolve));
+    if (!r) return NULL;
+    r->g = g;
+    r->lf = lf;
+    r->fw = fw;
+    r->s = s;
+    r->pkg_dir = fw ? fw->pkg_dir : "packages";
+    r->expand = 1;
+    r->on_ready = on_ready;
+    r->ready_ctx = ctx;
+    return r;
+}
+
+/* fetch every node of the graph, expanding each package's own dependencies
+ * as its checkout lands. a package is fetched and its config read once, no
+ * matter how many parents require it. */
+static int fetch_graph(DepGraph *g, LockFile *lf, GooseFramework *fw) {
+    Sched *s = sched_new(fw ? fw->jobs : 0);
+    PkgResolve *r = s ? resolve_new(g, lf, fw, s, NULL, NULL) : NULL;
+
+    int rc = -1;
+    if (r && queue_graph(r) == 0 && sched_run(s) == 0)
+        rc = dep_graph_order(g);
+
+    resolve_free(r);
+    sched_free(s);
+    return rc;
+}
+
+int pkg_fetch(const Dependency *dep, const char *pkg_dir, LockFile *lf,
+              GooseFramework *fw) {
+    Dependency one = *dep;
+    Config root;
+    memset(&root, 0, sizeof(root));
+    root.deps = &one;
+    root.dep_count = 1;
+
+    DepGraph g;
+    int rc = dep_graph_init(&g, &root, ".", pkg_dir);
+    if (rc == 0)
+        rc = fetch_graph(&g, lf, fw);
+    dep_graph_free(&g);
+    return rc;
+}
+
+/* the lock's source for a package matches what the config declares */
+static int lock_matches_dep(const LockEntry *e, const Dependency *dep) {
+    if (dep->path[0])
+        return strcmp(e->path, dep->path) == 0;
+    if (strcmp(e->subdir, dep->subdir) != 0)
+        return 0;
+    if (dep->url[0])
+        return strcmp(e->url, dep->url) == 0 &&
+               (!dep->sha256[0] || strcasecmp(e->sha256, dep->sha256) == 0);
+    return !e->path[0] && !e->url[0] && strcmp(e->git, dep->git) == 0 &&
+           strcmp(e->version, dep->version) == 0;
+}
+
+static void dep_from_lock(const LockEntry *e, Dependency *dep) {
+    memset(dep, 0, sizeof(Dependency));
+    strncpy(dep->name, e->name, MAX_NAME_LEN - 1);
+    strncpy(dep->path, e->path, MAX_PATH_LEN - 1);
+    strncpy(dep->url, e->url, MAX_PATH_LEN - 1);
+    strncpy(dep->sha256, e->sha256, sizeof(dep->sha256) - 1);
+    strncpy(dep->git, e->git, MAX_PATH_LEN - 1);
+    strncpy(dep->version, e->version, sizeof(dep->version) - 1);
+    strncpy(dep->subdir, e->subdir, MAX_PATH_LEN - 1);
+}
+
+/* rebuild the resolved graph straight from a v2 lock, without reading any
+ * package config. only valid when the root's direct deps match the lock,
+ * every package is already on disk, and no path package's config changed
+ * since the lock was written. returns 0 when the graph came from the lock. */
+static int graph_from_lock(const Config *cfg, const LockFile *lf,
+                           const char *lock_path, const char *pkg_dir,
+                           const char *config_file, DepGraph *g) {
+    if (lf->version < 2 || lf->root.dep_count != cfg->dep_count)
+        return 1;
+
+    struct stat lst;
+    if (stat(lock_path, &lst) != 0)
+        return 1;
+
+    for (int i = 0; i < cfg->dep_count; i++) {
+        LockEntry *e = lock_find(lf, cfg->deps[i].name);
+        if (!e || !lock_matches_dep(e, &cfg->deps[i]))
+            return 1;
     }
 
+    /* g holds the root and its direct deps; walk the rest from the lock */
+    for (int i = 1; i < g->count; i++) {
+        if (!fs_exists(g->nodes[i].base))
+            return 1;
+
+        /* mtimes have one-second granularity: a config written in the same
+         * second as the lock counts as changed */
+        if (g->nodes[i].dep.path[0]) {
+            char pcfg[1024];
+            struct stat st;
+            snprintf(pcfg, sizeof(pcfg), "%s/%s", g->nodes[i].base, config_file);
+            if (stat(pcfg, &st) == 0 && st.st_mtime >= lst.st_mtime)
+                return 1;
+        }
+
+        LockEntry *e = lock_find(lf, g->nodes[i].dep.name);
+        if (!e) return 1;
+        for (int j = 0; j < e->dep_count; j++) {
+            LockEntry *ce = lock_find(lf, e->deps[j]);
+            if (!ce) return 1;
+            Dependency d;
+            dep_from_lock(ce, &d);
+            if (dep_graph_add_rebased(g, i, &d, pkg_dir) < 0)
+                return 1;
+        }
+    }
     return 0;
 }
 
+/* record the resolved graph in the lock: the root's direct deps, every
+ * package's edges and tree hash, and nothing that is no longer reachable */
+static void lock_record_graph(LockFile *lf, const DepGraph *g) {
+    memset(lf->root.name, 0, sizeof(lf->root.name));
+    strncpy(lf->root.name, g->nodes[0].dep.name, MAX_NAME_LEN - 1);
+    lock_clear_deps(&lf->root);
+    for (int c = 0; c < g->nodes[0].child_count; c++)
+        lock_add_dep(&lf->root, g->nodes[g->nodes[0].children[c]].dep.name);
+
+    for (int i = 1; i < g->count; i++) {
+        const DepNode *n = &g->nodes[i];
+        LockEntry *e = lock_upsert(lf, n->dep.name);
+        if (!e) continue;
+
+        if (n->dep.path[0]) {
+            /* path packages are live trees: record where, not what */
+            strncpy(e->path, n->dep.path, MAX_PATH_LEN - 1);
+            e->git[0] = e->sha[0] = e->url[0] = e->sha256[0] = '\0';
+            e->version[0] = e->subdir[0] = e->tree[0] = '\0';
+        } else {
+            if (!n->dep.url[0])
+                strncpy(e->version, n->dep.version, sizeof(e->version) - 1);
+            /* the tree hash covers the subtree, so it moves with it */
+            if (strcmp(e->subdir, n->dep.subdir) != 0) {
+                strncpy(e->subdir, n->dep.subdir, MAX_PATH_LEN - 1);
+                e->tree[0] = '\0';
+            }
+        }
+
+        lock_clear_deps(e);
+        for (int c = 0; c < n->child_count; c++)
+            lock_add_dep(e, g->nodes[n->children[c]].dep.name);
+
+        if (!n->dep.path[0] && !e->tree[0])
+            fs_tree_hash(n->base, e->tree);
+    }
+
+    /* drop entries the graph no longer reaches */
+    for (int i = lf->count - 1; i >= 0; i--) {
+        int reached = 0;
+        for (int k = 1; k < g->count && !reached; k++)
+            reached = strcmp(g->nodes[k].dep.name, lf->entries[i].name) == 0;
+        if (!reached) {
+            char name[MAX_NAME_LEN];
+            strncpy(name, lf->entries[i].name, MAX_NAME_LEN);
+            lock_remove(lf, name);
+        }
+    }
+}
+
+PkgResolve *pkg_resolve_start(const Config *cfg, LockFile *lf,
+                              GooseFramework *fw, DepGraph *g, Sched *s,
+                              pkg_ready_fn on_ready, void *ctx) {
+    const char *pkg_dir = fw ? fw->pkg_dir : "packages";
+    const char *config_file = fw ? fw->config_file : "goose.yaml";
+    const char *lock_path = fw ? fw->lock_file : "goose.lock";
+
+    if (dep_graph_init(g, cfg, ".", pkg_dir) != 0)
+        return NULL;
+
+    PkgResolve *r = resolve_new(g, lf, fw, s, on_ready, ctx);
+    if (!r || cfg->dep_count == 0)
+        return r;
+
+    info("Resolving", "dependencies (%d)", cfg->dep_count);
+    if (lf && graph_from_lock(cfg, lf, lock_path, pkg_dir, config_file, g) == 0) {
+        /* graph known: only make sure each checkout matches the lock */
+        r->expand = 0;
+    } else {
+        dep_graph_free(g);
+        if (dep_graph_init(g, cfg, ".", pkg_dir) != 0) {
+            free(r);
+            return NULL;
+        }
+    }
+
+    if (queue_graph(r) != 0) {
+        resolve_free(r);
+        return NULL;
+    }
+    return r;
+}
+
+int pkg_resolve_finish(PkgResolve *r, int sched_rc) {
+    if (!r) return -1;
+
+    int rc = -1;
+    if (sched_rc != -1) {
+        /* jobs left waiting on each other mean a cycle, which the ordering
+         * pass reports */
+        rc = dep_graph_order(r->g);
+        if (rc == 0 && sched_rc != 0) {
+            err("dependency resolution stalled");
+            rc = -1;
+        }
+    }
+
+    if (rc == 0 && r->lf)
+        lock_record_graph(r->lf, r->g);
+    resolve_free(r);
+    return rc;
+}
+
+int pkg_resolve(const Config *cfg, LockFile *lf, GooseFramework *fw,
+                DepGraph *g) {
+    Sched *s = sched_new(fw ? fw->jobs : 0);
+    if (!s) {
+        memset(g, 0, sizeof(DepGraph));
+        return -1;
+    }
+
+    PkgResolve *r = pkg_resolve_start(cfg, lf, fw, g, s, NULL, NULL);
+    int rc = pkg_resolve_finish(r, r ? sched_run(s) : -1);
+    sched_free(s);
+    return rc;
+}
+
 int pkg_remove(const char *name, const char *pkg_dir) {
     char dest[512];
     snprintf(dest, sizeof(dest), "%s/%s", pkg_dir, name);
@@ -156,54 +1035,316 @@ int pkg_remove(const char *name, const char *pkg_dir) {
 }
 
 int pkg_fetch_all(const Config *cfg, LockFile *lf, GooseFramework *fw) {
-    const char *pkg_dir = fw ? fw->pkg_dir : "packages";
+    DepGraph g;
+    int rc = pkg_resolve(cfg, lf, fw, &g);
+    dep_graph_free(&g);
+    return rc;
+}
 
-    if (cfg->dep_count == 0)
-        return 0;
+/* one package of a parallel update: where its output goes while it runs,
+ * and the revisions it moved between */
+typedef struct {
+    const Dependency *dep;
+    const char *dest;
+    const char *log;
+    char old_sha[MAX_SHA_LEN];
+    char new_sha[MAX_SHA_LEN];
+    int commits;     /* -1 when unknown */
+    int fetched;     /* cloned fresh rather than updated */
+    int failed;
+} UpdateJob;
 
-    info("Resolving", "dependencies (%d)", cfg->dep_count);
-    for (int i = 0; i < cfg->dep_count; i++) {
-        if (pkg_fetch(&cfg->deps[i], pkg_dir, lf, fw) != 0)
-            return -1;
+static void print_update_log(const UpdateJob *u) {
+    FILE *f = fopen(u->log, "r");
+    if (!f) return;
+    char line[1024];
+    int first = 1;
+    while (fgets(line, sizeof(line), f)) {
+        if (first) {
+            info("Output", "%s", u->dep->name);
+            first = 0;
+        }
+        printf("    %s", line);
     }
-    return 0;
+    fclose(f);
 }
 
-int pkg_update_all(const Config *cfg, LockFile *lf, GooseFramework *fw) {
+static int count_commits(const char *dest, const char *from, const char *to) {
+    char cmd[1024];
+    snprintf(cmd, sizeof(cmd),
+        "git -C '%s' rev-list --count '%s..%s' 2>/dev/null", dest, from, to);
+    FILE *p = popen(cmd, "r");
+    if (!p) return -1;
+    int n = -1;
+    if (fscanf(p, "%d", &n) != 1) n = -1;
+    pclose(p);
+    return n;
+}
+
+static void print_update_table(const UpdateJob *jobs, int n) {
+    int width = 7;
+    for (int i = 0; i < n; i++) {
+        int len = (int)strlen(jobs[i].dep->name);
+        if (len > width) width = len;
+    }
+
+    printf("\n    %-*s  %-7s  %-7s  %s\n", width, "package", "old", "new",
+           "commits");
+    for (int i = 0; i < n; i++) {
+        const UpdateJob *u = &jobs[i];
+        char commits[32];
+        if (u->failed)
+            snprintf(commits, sizeof(commits), "failed");
+        else if (u->fetched)
+            snprintf(commits, sizeof(commits), "new");
+        else if (strcmp(u->old_sha, u->new_sha) == 0)
+            snprintf(commits, sizeof(commits), "up to date");
+        else if (u->commits >= 0)
+            snprintf(commits, sizeof(commits), "%d", u->commits);
+        else
+            snprintf(commits, sizeof(commits), "?");
+
+        printf("    %-*s  %-7.7s  %-7.7s  %s\n", width, u->dep->name,
+               u->old_sha[0] ? u->old_sha : "-",
+               u->new_sha[0] ? u->new_sha : "-", commits);
+    }
+    printf("\n");
+}
+
+/* update every git dependency to the tip of its version (or the remote's
+ * default branch), fw->jobs at a time. each package's git output is kept
+ * in a log and shown once all are done, followed by a table of what moved.
+ * returns the number of packages whose revision changed, -1 if none could
+ * be tried. *failed gets how many could not be updated: the others have
+ * moved anyway, so their new revisions are in lf all the same */
+int pkg_update_all(const Config *cfg, LockFile *lf, GooseFramework *fw,
+                   int *failed) {
     const char *pkg_dir = fw ? fw->pkg_dir : "packages";
+    *failed = 0;
 
     if (cfg->dep_count == 0) {
         info("Update", "no dependencies to update");
         return 0;
     }
+    if (fw && fw->offline) {
+        err("cannot update dependencies while offline");
+        return -1;
+    }
 
+    UpdateJob *jobs = calloc(cfg->dep_count, sizeof(UpdateJob));
+    Sched *s = sched_new(fw ? fw->jobs : 0);
+    if (!jobs || !s) {
+        free(jobs);
+        sched_free(s);
+        err("out of memory");
+        return -1;
+    }
+    Arena *arena = arena_new();
+    fs_mkdir(pkg_dir);
+
+    int n = 0;
     for (int i = 0; i < cfg->dep_count; i++) {
-        /* skip path dependencies -- they're managed locally */
-        if (cfg->deps[i].path[0]) continue;
+        /* skip path dependencies -- they're managed locally -- and archive
+         * dependencies, which are pinned by digest */
+        const Dependency *dep = &cfg->deps[i];
+        if (dep->path[0] || dep->url[0]) continue;
 
-        char dest[512];
-        snprintf(dest, sizeof(dest), "%s/%s", pkg_dir, cfg->deps[i].name);
+        UpdateJob *u = &jobs[n++];
+        u->dep = dep;
+        u->commits = -1;
+        u->dest = arena_printf(arena, "%s/%s", pkg_dir, dep->name);
+        u->log = arena_printf(arena, "%s/.%s.update.log", pkg_dir,
+                              dep->name);
 
-        if (!fs_exists(dest)) {
-            pkg_fetch(&cfg->deps[i], pkg_dir, lf, fw);
-            continue;
+        /* the command always succeeds so one failure does not stop the
+         * rest; a marker file records it */
+        const char *cmd;
+        if (!fs_exists(u->dest)) {
+            /* not fetched yet: cloned at the tip, beside the updates */
+            u->fetched = 1;
+            char clone[2048];
+            clone_command(dep, pkg_dir, clone, sizeof(clone));
+            cmd = arena_printf(arena,
+                "{ %s; } > '%s' 2>&1 || touch '%s.failed'",
+                clone, u->log, u->log);
+        } else {
+            /* fetch the ref itself (history down to what the shallow
+             * checkout already has, so the commit count is known) and
+             * move to it */
+            pkg_get_sha(u->dest, u->old_sha, sizeof(u->old_sha));
+            const char *ref = dep->version[0] ? dep->version : "HEAD";
+            cmd = arena_printf(arena,
+                "{ git -C '%s' fetch --quiet origin '%s' && "
+                "git -C '%s' checkout --quiet --detach FETCH_HEAD; } "
+                "> '%s' 2>&1 || touch '%s.failed'",
+                u->dest, ref, u->dest, u->log, u->log);
         }
+        if (sched_cmd(s, cmd, NULL) < 0)
+            u->failed = 1;
+    }
 
-        info("Updating", "%s", cfg->deps[i].name);
+    int pending = 0;
+    for (int i = 0; i < n; i++)
+        if (!jobs[i].failed) pending++;
+    if (pending > 0) {
+        info("Updating", "%d package%s (%d at a time)", pending,
+             pending == 1 ? "" : "s", sched_jobs(s));
         fflush(stdout);
+    }
+    sched_run(s);
+    sched_free(s);
 
-        char cmd[1024];
-        snprintf(cmd, sizeof(cmd),
-            "git -C '%s' fetch --quiet origin && git -C '%s' pull --quiet 2>&1",
-            dest, dest);
-        system(cmd);
+    int changed = 0;
+    for (int i = 0; i < n; i++) {
+        UpdateJob *u = &jobs[i];
+        const char *marker = arena_printf(arena, "%s.failed", u->log);
+        if (fs_exists(marker)) u->failed = 1;
+        print_update_log(u);
+        remove(u->log);
+        remove(marker);
+
+        /* a fresh clone stays at the tip: the lock follows below */
+        if (!u->failed && u->fetched &&
+            clone_finish(u->dep, pkg_dir, NULL, fw) != 0)
+            u->failed = 1;
+        if (!u->failed) {
+            pkg_get_sha(u->dest, u->new_sha, sizeof(u->new_sha));
+            if (!u->fetched && strcmp(u->old_sha, u->new_sha) != 0)
+                u->commits = count_commits(u->dest, u->old_sha, u->new_sha);
+        }
 
-        /* update lock SHA */
-        if (lf) {
-            char sha[MAX_SHA_LEN] = {0};
-            pkg_get_sha(dest, sha, sizeof(sha));
-            lock_update_entry(lf, cfg->deps[i].name, cfg->deps[i].git, sha);
+        if (u->failed) {
+            (*failed)++;
+            fflush(stdout);
+            err("failed to update '%s'", u->dep->name);
+            continue;
+        }
+
+        /* the lock changes only for a package that moved */
+        const char *locked = lf ? lock_find_sha(lf, u->dep->name) : NULL;
+        if (u->new_sha[0] && (!locked || strcmp(locked, u->new_sha) != 0)) {
+            if (lf)
+                lock_update_entry(lf, u->dep->name, u->dep->git, u->new_sha);
+            changed++;
         }
     }
+
+    if (n > 0)
+        print_update_table(jobs, n);
+    free(jobs);
+    arena_destroy(arena);
+    return changed;
+}
+
+static int cmp_vendor_pkg(const void *a, const void *b) {
+    return strcmp(((const VendorPkg *)a)->name, ((const VendorPkg *)b)->name);
+}
+
+int pkg_vendor(const DepGraph *g, GooseFramework *fw) {
+    const char *pkg_dir = fw ? fw->pkg_dir : "packages";
+    const char *path = fw && fw->vendor_file[0] ? fw->vendor_file
+                                                 : "goose.vendor";
+
+    VendorPkg *pkgs = calloc(g->count > 0 ? g->count : 1, sizeof(VendorPkg));
+    if (!pkgs) {
+        err("out of memory");
+        return -1;
+    }
+
+    int n = 0, rc = 0;
+    for (int i = 1; i < g->count && rc == 0; i++) {
+        const Dependency *dep = &g->nodes[i].dep;
+        /* path packages live in the tree; they travel with it */
+        if (dep->path[0]) continue;
+
+        VendorPkg *p = &pkgs[n];
+        if (pkg_content_id(dep, pkg_dir, p->rev, sizeof(p->rev)) != 0) {
+            err("cannot tell which revision of '%s' is checked out", dep->name);
+            rc = -1;
+            break;
+        }
+        snprintf(p->name, sizeof(p->name), "%s", dep->name);
+        snprintf(p->git, sizeof(p->git), "%s", dep->git);
+        snprintf(p->url, sizeof(p->url), "%s", dep->url);
+        snprintf(p->version, sizeof(p->version), "%s", dep->version);
+        snprintf(p->subdir, sizeof(p->subdir), "%s", dep->subdir);
+        n++;
+    }
+
+    /* by name, so the archive does not depend on resolution order */
+    if (rc == 0) {
+        qsort(pkgs, n, sizeof(VendorPkg), cmp_vendor_pkg);
+        rc = vendor_write(path, pkgs, n, pkg_dir);
+    }
+    free(pkgs);
+    return rc;
+}
+
+/* a workspace path dependency that points at one of the members */
+static int is_member(const Config *root, const char *dir) {
+    char want[4096], rp[4096];
+    if (!realpath(dir, want)) return 0;
+    for (int i = 0; i < root->ws_member_count; i++)
+        if (realpath(root->ws_members[i], rp) && strcmp(rp, want) == 0)
+            return 1;
     return 0;
 }
+
+static int same_source(const Dependency *a, const Dependency *b) {
+    return strcmp(a->git, b->git) == 0 && strcmp(a->url, b->url) == 0 &&
+           strcmp(a->version, b->version) == 0 &&
+           strcmp(a->subdir, b->subdir) == 0 &&
+           strcmp(a->path, b->path) == 0 &&
+           strcmp(a->sha256, b->sha256) == 0;
+}
+
+int pkg_workspace_deps(const Config *root, GooseFramework *fw, Config *out) {
+    const char *config_file = fw ? fw->config_file : "goose.yaml";
+    config_default(out, root->name, fw);
+
+    int rc = 0;
+    for (int m = 0; m < root->ws_member_count && rc == 0; m++) {
+        const char *dir = root->ws_members[m];
+        char cfg_path[1024];
+        snprintf(cfg_path, sizeof(cfg_path), "%s/%s", dir, config_file);
+        Config mc;
+        if (config_load(cfg_path, &mc, fw) != 0) {
+            rc = -1;
+            break;
+        }
+
+        for (int i = 0; i < mc.dep_count && rc == 0; i++) {
+            Dependency dep = mc.deps[i];
+            /* members build on their own; other local trees are rebased
+             * onto the root so their dependencies resolve too */
+            if (dep.path[0]) {
+                char rebased[MAX_PATH_LEN + 512];
+                snprintf(rebased, sizeof(rebased), "%s/%s", dir, dep.path);
+                if (is_member(root, rebased)) continue;
+                if ((size_t)snprintf(dep.path, sizeof(dep.path), "%s",
+                                     rebased) >= sizeof(dep.path)) {
+                    err("path of '%s' is too long once rebased onto %s",
+                        dep.name, dir);
+                    rc = -1;
+                    break;
+                }
+            }
+
+            const Dependency *have = NULL;
+            for (int k = 0; k < out->dep_count && !have; k++)
+                if (strcmp(out->deps[k].name, dep.name) == 0)
+                    have = &out->deps[k];
+            if (!have) {
+                *config_add_dep(out) = dep;
+            } else if (!same_source(have, &dep)) {
+                err("workspace members require '%s' from different sources",
+                    dep.name);
+                rc = -1;
+            }
+        }
+        config_free(&mc);
+    }
+
+    if (rc != 0) config_free(out);
+    return rc;
+}
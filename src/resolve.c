@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include "headers/resolve.h"
+#include "headers/build.h"
+#include "headers/color.h"
+
+/* lexically join rel onto base, folding "dir/.." pairs */
+static void join_path(const char *base, const char *rel, char *out, int outsz) {
+    if (rel[0] == '/' || strcmp(base, ".") == 0 || base[0] == '\0') {
+        snprintf(out, outsz, "%s", rel);
+        return;
+    }
+
+    char tmp[2 * MAX_PATH_LEN];
+    snprintf(tmp, sizeof(tmp), "%s/%s", base, rel);
+
+    /* split into components and fold */
+    char *parts[256];
+    int n = 0;
+    int absolute = tmp[0] == '/';
+    for (char *tok = strtok(tmp, "/"); tok && n < 256; tok = strtok(NULL, "/")) {
+        if (strcmp(tok, ".") == 0) continue;
+        if (strcmp(tok, "..") == 0 && n > 0 && strcmp(parts[n - 1], "..") != 0) {
+            n--;
+            continue;
+        }
+        parts[n++] = tok;
+    }
+
+    int off = snprintf(out, outsz, "%s", absolute ? "/" : "");
+    for (int i = 0; i < n && off < outsz; i++)
+        off += snprintf(out + off, outsz - off, "%s%s", i ? "/" : "", parts[i]);
+    if (n == 0 && !absolute)
+        snprintf(out, outsz, ".");
+}
+
+static void path_key(const char *dir, char *key, int keysz) {
+    char real[PATH_MAX];
+    snprintf(key, keysz, "path:%s", realpath(dir, real) ? real : dir);
+}
+
+static void dep_key(const Dependency *dep, const char *base, char *key, int keysz) {
+    if (dep->path[0])
+        path_key(base, key, keysz);
+    else if (dep->url[0])
+        snprintf(key, keysz, "url:%s", dep->url);
+    else if (dep->version[0])
+        snprintf(key, keysz, "git:%s@%s", dep->git, dep->version);
+    else
+        snprintf(key, keysz, "git:%s", dep->git);
+
+    /* two subtrees of one repository are different packages */
+    if (!dep->path[0] && dep->subdir[0]) {
+        size_t len = strlen(key);
+        snprintf(key + len, keysz - len, "#%s", dep->subdir);
+    }
+}
+
+static int add_node(DepGraph *g) {
+    if (g->count == g->cap) {
+        int cap = g->cap ? g->cap * 2 : 16;
+        DepNode *nodes = realloc(g->nodes, cap * sizeof(DepNode));
+        if (!nodes) return -1;
+        g->nodes = nodes;
+        g->cap = cap;
+    }
+    DepNode *n = &g->nodes[g->count];
+    memset(n, 0, sizeof(DepNode));
+    n->parent = -1;
+    return g->count++;
+}
+
+static int add_edge(DepNode *from, int to) {
+    for (int i = 0; i < from->child_count; i++)
+        if (from->children[i] == to) return 0;
+    if (from->child_count == from->child_cap) {
+        int cap = from->child_cap ? from->child_cap * 2 : 4;
+        int *children = realloc(from->children, cap * sizeof(int));
+        if (!children) return -1;
+        from->children = children;
+        from->child_cap = cap;
+    }
+    from->children[from->child_count++] = to;
+    return 0;
+}
+
+static const char *node_label(const DepGraph *g, int idx) {
+    return idx == 0 ? "(root)" : g->nodes[idx].dep.name;
+}
+
+int dep_graph_init(DepGraph *g, const Config *root, const char *root_dir,
+                   const char *pkg_dir) {
+    memset(g, 0, sizeof(DepGraph));
+
+    int r = add_node(g);
+    if (r < 0) return -1;
+    DepNode *n = &g->nodes[r];
+    strncpy(n->dep.name, root->name, MAX_NAME_LEN - 1);
+    strncpy(n->base, root_dir, MAX_PATH_LEN - 1);
+    path_key(root_dir, n->key, sizeof(n->key));
+
+    for (int i = 0; i < root->dep_count; i++)
+        if (dep_graph_add(g, 0, &root->deps[i], pkg_dir) < 0)
+            return -1;
+    return 0;
+}
+
+/* add an already-rebased dep as a child of parent, reusing an existing node
+ * for the same package. returns the node index, or -1 on a conflict. */
+int dep_graph_add_rebased(DepGraph *g, int parent, const Dependency *dep,
+                          const char *pkg_dir) {
+    char base[MAX_PATH_LEN];
+    build_dep_base(dep, pkg_dir, base, sizeof(base));
+
+    char key[sizeof(g->nodes[0].key)];
+    dep_key(dep, base, key, sizeof(key));
+
+    int found = -1;
+    for (int i = 0; i < g->count; i++) {
+        if (strcmp(g->nodes[i].key, key) == 0) {
+            found = i;
+            break;
+        }
+        if (i > 0 && strcmp(g->nodes[i].dep.name, dep->name) == 0) {
+            err("conflicting sources for dependency '%s'", dep->name);
+            fprintf(stderr, "    %s requires %s\n",
+                    node_label(g, g->nodes[i].parent), g->nodes[i].key);
+            fprintf(stderr, "    %s requires %s\n",
+                    node_label(g, parent), key);
+            return -1;
+        }
+    }
+
+    if (found < 0) {
+        found = add_node(g);
+        if (found < 0) return -1;
+        DepNode *n = &g->nodes[found];
+        n->dep = *dep;
+        n->parent = parent;
+        strncpy(n->base, base, MAX_PATH_LEN - 1);
+        strncpy(n->key, key, sizeof(n->key) - 1);
+    }
+
+    if (add_edge(&g->nodes[parent], found) != 0) return -1;
+    return found;
+}
+
+/* add dep, as declared in parent's config, as a child of parent */
+int dep_graph_add(DepGraph *g, int parent, const Dependency *dep,
+                  const char *pkg_dir) {
+    Dependency resolved = *dep;
+    /* path deps are relative to the package that declares them */
+    if (dep->path[0])
+        join_path(g->nodes[parent].base, dep->path, resolved.path, MAX_PATH_LEN);
+    return dep_graph_add_rebased(g, parent, &resolved, pkg_dir);
+}
+
+enum { WHITE, GREY, BLACK };
+
+static int visit(DepGraph *g, int idx, int *color, int *stack, int depth) {
+    color[idx] = GREY;
+    stack[depth] = idx;
+
+    DepNode *n = &g->nodes[idx];
+    for (int i = 0; i < n->child_count; i++) {
+        int c = n->children[i];
+        if (color[c] == GREY) {
+            /* report the cycle from where it starts on the stack */
+            int start = 0;
+            while (stack[start] != c) start++;
+            err("dependency cycle detected");
+            fprintf(stderr, "    ");
+            for (int k = start; k <= depth; k++)
+                fprintf(stderr, "%s -> ", node_label(g, stack[k]));
+            fprintf(stderr, "%s\n", node_label(g, c));
+            return -1;
+        }
+        if (color[c] == WHITE && visit(g, c, color, stack, depth + 1) != 0)
+            return -1;
+    }
+
+    color[idx] = BLACK;
+    if (idx != 0)
+        g->order[g->order_count++] = idx;
+    return 0;
+}
+
+/* detect cycles and compute a topological order of all dependencies
+ * (dependencies before their dependents), excluding the root */
+int dep_graph_order(DepGraph *g) {
+    free(g->order);
+    g->order = malloc((g->count + 1) * sizeof(int));
+    int *color = calloc(g->count + 1, sizeof(int));
+    int *stack = malloc((g->count + 1) * sizeof(int));
+    g->order_count = 0;
+
+    int rc = -1;
+    if (g->order && color && stack)
+        rc = visit(g, 0, color, stack, 0);
+
+    free(color);
+    free(stack);
+    return rc;
+}
+
+/* replace cfg's dependency list with every resolved dependency in build
+ * order, so the build phase sees the whole graph exactly once */
+int dep_graph_flatten(const DepGraph *g, Config *cfg) {
+    cfg->dep_count = 0;
+    for (int i = 0; i < g->order_count; i++)
+        *config_add_dep(cfg) = g->nodes[g->order[i]].dep;
+    return 0;
+}
+
+void dep_graph_free(DepGraph *g) {
+    for (int i = 0; i < g->count; i++)
+        free(g->nodes[i].children);
+    free(g->nodes);
+    free(g->order);
+    memset(g, 0, sizeof(DepGraph));
+}
@@ -0,0 +1,361 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "headers/sched.h"
+#include "headers/color.h"
+
+/* skipped: waited on a job that failed, so it can never run */
+enum { JOB_PENDING, JOB_RUNNING, JOB_DONE, JOB_FAILED, JOB_SKIPPED };
+
+typedef struct {
+    char *cmd;          /* NULL for a function job */
+    char *fail_msg;
+    sched_job_fn fn;
+    void *ctx;
+    int arg;
+    int state;
+    int first;
+    int always;         /* runs once its prerequisites finished at all */
+    int status;         /* wait status of a finished command */
+    pid_t pid;
+    double started;
+    double seconds;
+    double timeout;     /* seconds before it is killed, 0 = never */
+    int timed_out;
+    long max_rss;       /* KiB */
+    int *after;
+    int after_count;
+    int after_cap;
+} Job;
+
+struct Sched {
+    Job *jobs;
+    int count;
+    int cap;
+    int max_running;
+    int running;
+    int failed;
+    int keep_going;
+};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+Sched *sched_new(int jobs) {
+    Sched *s = calloc(1, sizeof(Sched));
+    if (!s) return NULL;
+    if (jobs <= 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        jobs = n > 0 ? (int)n : 1;
+    }
+    s->max_running = jobs;
+    return s;
+}
+
+void sched_free(Sched *s) {
+    if (!s) return;
+    for (int i = 0; i < s->count; i++) {
+        free(s->jobs[i].cmd);
+        free(s->jobs[i].fail_msg);
+        free(s->jobs[i].after);
+    }
+    free(s->jobs);
+    free(s);
+}
+
+static int add_job(Sched *s) {
+    if (s->count == s->cap) {
+        int cap = s->cap ? s->cap * 2 : 64;
+        Job *jobs = realloc(s->jobs, cap * sizeof(Job));
+        if (!jobs) return -1;
+        s->jobs = jobs;
+        s->cap = cap;
+    }
+    memset(&s->jobs[s->count], 0, sizeof(Job));
+    return s->count++;
+}
+
+int sched_cmd(Sched *s, const char *cmd, const char *fail_msg) {
+    int id = add_job(s);
+    if (id < 0) return -1;
+    Job *j = &s->jobs[id];
+    j->cmd = strdup(cmd);
+    j->fail_msg = fail_msg ? strdup(fail_msg) : NULL;
+    if (!j->cmd) {
+        s->count--;
+        return -1;
+    }
+    return id;
+}
+
+int sched_fn(Sched *s, sched_job_fn fn, void *ctx, int arg) {
+    int id = add_job(s);
+    if (id < 0) return -1;
+    s->jobs[id].fn = fn;
+    s->jobs[id].ctx = ctx;
+    s->jobs[id].arg = arg;
+    return id;
+}
+
+int sched_after(Sched *s, int job, int prereq) {
+    if (job < 0 || prereq < 0 || job == prereq) return -1;
+    if (s->jobs[prereq].state == JOB_DONE) return 0;
+
+    Job *j = &s->jobs[job];
+    if (j->after_count == j->after_cap) {
+        int cap = j->after_cap ? j->after_cap * 2 : 4;
+        int *after = realloc(j->after, cap * sizeof(int));
+        if (!after) return -1;
+        j->after = after;
+        j->after_cap = cap;
+    }
+    j->after[j->after_count++] = prereq;
+    return 0;
+}
+
+int sched_after_range(Sched *s, int job, int from, int to) {
+    for (int i = from; i < to; i++)
+        if (i != job && sched_after(s, job, i) != 0)
+            return -1;
+    return 0;
+}
+
+void sched_first(Sched *s, int job) {
+    if (job >= 0 && job < s->count)
+        s->jobs[job].first = 1;
+}
+
+int sched_size(const Sched *s) {
+    return s->count;
+}
+
+int sched_jobs(const Sched *s) {
+    return s->max_running;
+}
+
+static int finished(int state) {
+    return state == JOB_DONE || state == JOB_FAILED || state == JOB_SKIPPED;
+}
+
+static int runnable(const Sched *s, const Job *j) {
+    if (j->state != JOB_PENDING) return 0;
+    for (int i = 0; i < j->after_count; i++) {
+        int state = s->jobs[j->after[i]].state;
+        if (state != JOB_DONE && !(j->always && finished(state)))
+            return 0;
+    }
+    return 1;
+}
+
+/* with keep_going, jobs behind a failure will never run: mark them so the
+ * jobs that run regardless of them stop waiting */
+static void skip_blocked(Sched *s) {
+    for (int changed = 1; changed;) {
+        changed = 0;
+        for (int i = 0; i < s->count; i++) {
+            Job *j = &s->jobs[i];
+            if (j->state != JOB_PENDING || j->always) continue;
+            for (int k = 0; k < j->after_count; k++) {
+                int state = s->jobs[j->after[k]].state;
+                if (state == JOB_FAILED || state == JOB_SKIPPED) {
+                    j->state = JOB_SKIPPED;
+                    changed = 1;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+static int spawn(Sched *s, int id) {
+    /* children must not inherit (and later repeat) buffered output */
+    fflush(stdout);
+    fflush(stderr);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        err("cannot start job: %s", s->jobs[id].cmd);
+        return -1;
+    }
+    /* a job that may be killed leads its own process group, set on both
+     * sides of the fork so neither can run ahead of it */
+    if (pid == 0) {
+        if (s->jobs[id].timeout > 0) setpgid(0, 0);
+        execl("/bin/sh", "sh", "-c", s->jobs[id].cmd, (char *)NULL);
+        _exit(127);
+    }
+    if (s->jobs[id].timeout > 0) setpgid(pid, pid);
+    s->jobs[id].pid = pid;
+    s->jobs[id].started = now();
+    s->jobs[id].state = JOB_RUNNING;
+    s->running++;
+    return 0;
+}
+
+/* kill the process group of every command past its timeout. returns the
+ * seconds until the next one is due, -1 if none is */
+static double expire(Sched *s) {
+    double t = now(), next = -1;
+    for (int i = 0; i < s->count; i++) {
+        Job *j = &s->jobs[i];
+        if (j->state != JOB_RUNNING || j->timeout <= 0 || j->timed_out)
+            continue;
+        double left = j->started + j->timeout - t;
+        if (left <= 0) {
+            kill(-j->pid, SIGKILL);
+            j->timed_out = 1;
+        } else if (next < 0 || left < next) {
+            next = left;
+        }
+    }
+    return next;
+}
+
+/* collect one finished command. returns 0 if one was reaped. while a
+ * timeout is pending, a blocking wait polls so it can fire */
+static int reap(Sched *s, int block) {
+    int status;
+    struct rusage ru;
+    pid_t pid;
+    for (;;) {
+        double due = expire(s);
+        pid = wait4(-1, &status, block && due < 0 ? 0 : WNOHANG, &ru);
+        if (pid < 0 || (pid == 0 && !block)) return -1;
+        if (pid == 0) {
+            long ns = due < 0.005 ? (long)(due * 1e9) : 5000000;
+            struct timespec ts = {0, ns};
+            nanosleep(&ts, NULL);
+            continue;
+        }
+        for (int i = 0; i < s->count; i++) {
+            Job *j = &s->jobs[i];
+            if (j->state != JOB_RUNNING || j->pid != pid) continue;
+            s->running--;
+            j->seconds = now() - j->started;
+            j->status = status;
+#ifdef __APPLE__
+            j->max_rss = ru.ru_maxrss / 1024;   /* bytes there */
+#else
+            j->max_rss = ru.ru_maxrss;
+#endif
+            if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+                j->state = JOB_DONE;
+            } else {
+                j->state = JOB_FAILED;
+                s->failed = 1;
+                if (j->fail_msg) err("%s", j->fail_msg);
+            }
+            return 0;
+        }
+        /* not one of ours (e.g. reaped on behalf of a nested system()) */
+    }
+}
+
+/* pick the next runnable job of a kind, priority jobs first */
+static int next_job(const Sched *s, int want_cmd) {
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < s->count; i++) {
+            const Job *j = &s->jobs[i];
+            if ((j->cmd != NULL) != want_cmd) continue;
+            if (j->first != (pass == 0)) continue;
+            if (runnable(s, j)) return i;
+        }
+    }
+    return -1;
+}
+
+int sched_run(Sched *s) {
+    for (;;) {
+        while (s->running > 0 && reap(s, 0) == 0)
+            ;
+        if (s->failed && s->keep_going)
+            skip_blocked(s);
+
+        if (!s->failed || s->keep_going) {
+            int id;
+            while (s->running < s->max_running &&
+                   (id = next_job(s, 1)) >= 0) {
+                if (spawn(s, id) != 0) {
+                    s->jobs[id].state = JOB_FAILED;
+                    s->failed = 1;
+                    if (!s->keep_going) break;
+                }
+            }
+
+            /* function jobs run inline; commands keep going meanwhile */
+            id = s->failed && !s->keep_going ? -1 : next_job(s, 0);
+            if (id >= 0) {
+                s->jobs[id].state = JOB_RUNNING;
+                int rc = s->jobs[id].fn(s, s->jobs[id].ctx, s->jobs[id].arg);
+                /* fn may have queued jobs and moved the array */
+                s->jobs[id].state = rc == 0 ? JOB_DONE : JOB_FAILED;
+                if (rc != 0) s->failed = 1;
+                continue;
+            }
+        }
+
+        if (s->running > 0) {
+            if (reap(s, 1) != 0) {
+                /* children vanished under us: nothing left to wait for */
+                s->running = 0;
+                s->failed = 1;
+            }
+            continue;
+        }
+        break;
+    }
+
+    if (s->failed) return -1;
+    for (int i = 0; i < s->count; i++)
+        if (s->jobs[i].state == JOB_PENDING)
+            return -2;
+    return 0;
+}
+
+void sched_keep_going(Sched *s) {
+    s->keep_going = 1;
+}
+
+void sched_always(Sched *s, int job) {
+    if (job >= 0 && job < s->count)
+        s->jobs[job].always = 1;
+}
+
+int sched_status(const Sched *s, int job) {
+    if (job < 0 || job >= s->count) return SCHED_PENDING;
+    switch (s->jobs[job].state) {
+    case JOB_DONE:   return SCHED_DONE;
+    case JOB_FAILED: return SCHED_FAILED;
+    default:         return SCHED_PENDING;
+    }
+}
+
+double sched_seconds(const Sched *s, int job) {
+    return job >= 0 && job < s->count ? s->jobs[job].seconds : 0;
+}
+
+int sched_exit_status(const Sched *s, int job) {
+    return job >= 0 && job < s->count ? s->jobs[job].status : 0;
+}
+
+long sched_max_rss(const Sched *s, int job) {
+    return job >= 0 && job < s->count ? s->jobs[job].max_rss : 0;
+}
+
+void sched_timeout(Sched *s, int job, double seconds) {
+    if (job >= 0 && job < s->count && s->jobs[job].cmd)
+        s->jobs[job].timeout = seconds;
+}
+
+int sched_timed_out(const Sched *s, int job) {
+    return job >= 0 && job < s->count && s->jobs[job].timed_out;
+}
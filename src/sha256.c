@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <string.h>
+#include "headers/sha256.h"
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_block(Sha256 *ctx, const uint8_t *p) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++)
+        w[i] = (uint32_t)p[i * 4] << 24 | (uint32_t)p[i * 4 + 1] << 16 |
+               (uint32_t)p[i * 4 + 2] << 8 | (uint32_t)p[i * 4 + 3];
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = ctx->state[0], b = ctx->state[1], c = ctx->state[2],
+             d = ctx->state[3], e = ctx->state[4], f = ctx->state[5],
+             g = ctx->state[6], h = ctx->state[7];
+
+    for (int i = 0; i < 64; i++) {
+        uint32_t s1 = ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25);
+        uint32_t ch = (e & f) ^ (~e & g);
+        uint32_t t1 = h + s1 + ch + K[i] + w[i];
+        uint32_t s0 = ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22);
+        uint32_t mj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = s0 + mj;
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+
+    ctx->state[0] += a; ctx->state[1] += b; ctx->state[2] += c;
+    ctx->state[3] += d; ctx->state[4] += e; ctx->state[5] += f;
+    ctx->state[6] += g; ctx->state[7] += h;
+}
+
+void sha256_init(Sha256 *ctx) {
+    static const uint32_t iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(ctx->state, iv, sizeof(iv));
+    ctx->bitlen = 0;
+    ctx->buflen = 0;
+}
+
+void sha256_update(Sha256 *ctx, const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    ctx->bitlen += (uint64_t)len * 8;
+
+    /* top up a partial block first */
+    if (ctx->buflen > 0) {
+        size_t take = 64 - ctx->buflen;
+        if (take > len) take = len;
+        memcpy(ctx->buf + ctx->buflen, p, take);
+        ctx->buflen += take;
+        p += take;
+        len -= take;
+        if (ctx->buflen < 64) return;
+        sha256_block(ctx, ctx->buf);
+        ctx->buflen = 0;
+    }
+
+    while (len >= 64) {
+        sha256_block(ctx, p);
+        p += 64;
+        len -= 64;
+    }
+
+    memcpy(ctx->buf, p, len);
+    ctx->buflen = len;
+}
+
+void sha256_final(Sha256 *ctx, uint8_t out[SHA256_DIGEST_LEN]) {
+    uint64_t bitlen = ctx->bitlen;
+
+    ctx->buf[ctx->buflen++] = 0x80;
+    if (ctx->buflen > 56) {
+        memset(ctx->buf + ctx->buflen, 0, 64 - ctx->buflen);
+        sha256_block(ctx, ctx->buf);
+        ctx->buflen = 0;
+    }
+    memset(ctx->buf + ctx->buflen, 0, 56 - ctx->buflen);
+    for (int i = 0; i < 8; i++)
+        ctx->buf[56 + i] = (uint8_t)(bitlen >> (56 - 8 * i));
+    sha256_block(ctx, ctx->buf);
+
+    for (int i = 0; i < 8; i++) {
+        out[i * 4]     = (uint8_t)(ctx->state[i] >> 24);
+        out[i * 4 + 1] = (uint8_t)(ctx->state[i] >> 16);
+        out[i * 4 + 2] = (uint8_t)(ctx->state[i] >> 8);
+        out[i * 4 + 3] = (uint8_t)(ctx->state[i]);
+    }
+}
+
+void sha256_final_hex(Sha256 *ctx, char out[SHA256_HEX_LEN]) {
+    static const char hex[] = "0123456789abcdef";
+    uint8_t digest[SHA256_DIGEST_LEN];
+    sha256_final(ctx, digest);
+    for (int i = 0; i < SHA256_DIGEST_LEN; i++) {
+        out[i * 2]     = hex[digest[i] >> 4];
+        out[i * 2 + 1] = hex[digest[i] & 0x0f];
+    }
+    out[SHA256_HEX_LEN - 1] = '\0';
+}
+
+void sha256_hex(const void *data, size_t len, char out[SHA256_HEX_LEN]) {
+    Sha256 ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, data, len);
+    sha256_final_hex(&ctx, out);
+}
+
+int sha256_file_hex(const char *path, char out[SHA256_HEX_LEN]) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+
+    Sha256 ctx;
+    sha256_init(&ctx);
+    char buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        sha256_update(&ctx, buf, n);
+    int bad = ferror(f);
+    fclose(f);
+    if (bad) return -1;
+
+    sha256_final_hex(&ctx, out);
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "headers/stats.h"
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+double stats_quantile(const double *sorted, int n, double q) {
+    if (n <= 0) return 0;
+    double pos = q * (n - 1);
+    int lo = (int)pos;
+    if (lo >= n - 1) return sorted[n - 1];
+    return sorted[lo] + (pos - lo) * (sorted[lo + 1] - sorted[lo]);
+}
+
+int stats_summary(const double *samples, int n, Stats *out) {
+    memset(out, 0, sizeof(*out));
+    if (n <= 0) return -1;
+    double *v = malloc(n * sizeof(double));
+    if (!v) return -1;
+    memcpy(v, samples, n * sizeof(double));
+    qsort(v, n, sizeof(double), cmp_double);
+
+    double sum = 0;
+    for (int i = 0; i < n; i++) sum += v[i];
+    out->n = n;
+    out->min = v[0];
+    out->median = stats_quantile(v, n, 0.5);
+    out->p99 = stats_quantile(v, n, 0.99);
+    out->mean = sum / n;
+
+    for (int i = 0; i < n; i++)
+        v[i] = v[i] > out->median ? v[i] - out->median : out->median - v[i];
+    qsort(v, n, sizeof(double), cmp_double);
+    out->mad = stats_quantile(v, n, 0.5);
+    free(v);
+    return 0;
+}
+
+/* splitmix64: small, seedable and good enough to draw resample indices */
+static uint64_t next_rand(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/* median of n values drawn with replacement from v, using tmp */
+static double resampled_median(const double *v, int n, double *tmp,
+                               uint64_t *state) {
+    for (int i = 0; i < n; i++)
+        tmp[i] = v[next_rand(state) % (uint64_t)n];
+    qsort(tmp, n, sizeof(double), cmp_double);
+    return stats_quantile(tmp, n, 0.5);
+}
+
+int stats_compare(const double *base, int nb, const double *cur, int nc,
+                  double level, StatsChange *out) {
+    enum { RESAMPLES = 2000 };
+    memset(out, 0, sizeof(*out));
+    if (nb <= 0 || nc <= 0) return -1;
+
+    Stats sb, sc;
+    if (stats_summary(base, nb, &sb) != 0 || stats_summary(cur, nc, &sc) != 0 ||
+        sb.median <= 0)
+        return -1;
+    out->change = sc.median / sb.median - 1;
+
+    double *tmp = malloc((nb > nc ? nb : nc) * sizeof(double));
+    double *changes = malloc(RESAMPLES * sizeof(double));
+    if (!tmp || !changes) {
+        free(tmp);
+        free(changes);
+        return -1;
+    }
+    uint64_t state = 0x676f6f7365ULL;
+    int n = 0;
+    for (int i = 0; i < RESAMPLES; i++) {
+        double mb = resampled_median(base, nb, tmp, &state);
+        double mc = resampled_median(cur, nc, tmp, &state);
+        if (mb > 0) changes[n++] = mc / mb - 1;
+    }
+    qsort(changes, n, sizeof(double), cmp_double);
+    out->lo = stats_quantile(changes, n, (1 - level) / 2);
+    out->hi = stats_quantile(changes, n, 1 - (1 - level) / 2);
+    free(tmp);
+    free(changes);
+    return 0;
+}
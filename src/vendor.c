@@ -0,0 +1,560 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "headers/vendor.h"
+#include "headers/arena.h"
+#include "headers/color.h"
+#include "headers/fs.h"
+#include "headers/lz.h"
+
+/* layout:
+ *   "GOOSEVND" u32 version
+ *   blobs        file contents, each stored once, raw or lz-compressed
+ *   index        text, one tab-separated line per package and per file:
+ *                P name git url version subdir rev
+ *                F type mode method offset csize size sha256 path
+ *   trailer      u64 index offset, u64 index size, "GOOSEIDX"
+ * integers are little-endian; file lines belong to the package above.
+ * version 2 adds empty directories, as entries of type 'd' and size 0 */
+#define VENDOR_MAGIC   "GOOSEVND"
+#define VENDOR_VERSION 2
+#define VENDOR_TRAILER "GOOSEIDX"
+#define HEADER_LEN     12
+#define TRAILER_LEN    24
+
+enum { METHOD_RAW, METHOD_LZ };
+
+typedef struct {
+    char type;                  /* 'f' file, 'l' symlink, 'd' empty dir */
+    int mode;
+    int method;
+    uint64_t offset;
+    uint64_t csize;
+    uint64_t size;
+    const char *sha;
+    const char *path;
+} VendorFile;
+
+struct Vendor {
+    FILE *f;
+    char *index;                /* index text; entries point into it */
+    VendorPkg *pkgs;
+    int pkg_count;
+    VendorFile *files;
+    int file_count;
+};
+
+static void put_u64(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint64_t get_u64(const uint8_t *p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) v |= (uint64_t)p[i] << (8 * i);
+    return v;
+}
+
+/* --- writing --- */
+
+typedef struct {
+    char sha[SHA256_HEX_LEN];
+    uint64_t offset;
+    uint64_t csize;
+    int method;
+} Blob;
+
+typedef struct {
+    FILE *out;
+    uint64_t pos;
+    Blob *blobs;
+    int blob_count;
+    int blob_cap;
+    int *slots;                 /* open-addressing set of blobs by digest */
+    int slot_cap;
+    StrBuf index;
+    int files;
+    uint64_t raw_bytes;
+} Packer;
+
+static unsigned sha_slot(const char *sha, int cap) {
+    unsigned h = 0;
+    for (int i = 0; i < 8; i++) h = h * 16 + (unsigned)(sha[i] & 0x0f);
+    return h & (unsigned)(cap - 1);
+}
+
+static Blob *blob_find(Packer *pk, const char *sha) {
+    if (!pk->slot_cap) return NULL;
+    for (unsigned s = sha_slot(sha, pk->slot_cap); pk->slots[s] >= 0;
+         s = (s + 1) & (unsigned)(pk->slot_cap - 1))
+        if (strcmp(pk->blobs[pk->slots[s]].sha, sha) == 0)
+            return &pk->blobs[pk->slots[s]];
+    return NULL;
+}
+
+static int blob_add(Packer *pk, const Blob *b) {
+    if (pk->blob_count == pk->blob_cap) {
+        int cap = pk->blob_cap ? pk->blob_cap * 2 : 256;
+        Blob *blobs = realloc(pk->blobs, cap * sizeof(Blob));
+        int *slots = malloc(cap * 2 * sizeof(int));
+        if (!blobs || !slots) {
+            if (blobs) pk->blobs = blobs;
+            free(slots);
+            return -1;
+        }
+        pk->blobs = blobs;
+        pk->blob_cap = cap;
+        free(pk->slots);
+        pk->slots = slots;
+        pk->slot_cap = cap * 2;
+        memset(slots, 0xff, pk->slot_cap * sizeof(int));
+        for (int i = 0; i < pk->blob_count; i++) {
+            unsigned s = sha_slot(blobs[i].sha, pk->slot_cap);
+            while (slots[s] >= 0) s = (s + 1) & (unsigned)(pk->slot_cap - 1);
+            slots[s] = i;
+        }
+    }
+    pk->blobs[pk->blob_count] = *b;
+    unsigned s = sha_slot(b->sha, pk->slot_cap);
+    while (pk->slots[s] >= 0) s = (s + 1) & (unsigned)(pk->slot_cap - 1);
+    pk->slots[s] = pk->blob_count++;
+    return 0;
+}
+
+static int pack_file(Packer *pk, const char *rel, char type, int mode,
+                     const uint8_t *data, size_t size) {
+    char sha[SHA256_HEX_LEN];
+    sha256_hex(data, size, sha);
+
+    Blob *b = blob_find(pk, sha);
+    if (!b) {
+        Blob nb;
+        memcpy(nb.sha, sha, sizeof(nb.sha));
+        nb.offset = pk->pos;
+        nb.method = METHOD_RAW;
+        nb.csize = size;
+
+        /* keep whichever is smaller; tiny and incompressible files stay raw */
+        uint8_t *packed = size > 0 ? malloc(lz_bound(size)) : NULL;
+        size_t c = packed ? lz_compress(data, size, packed) : 0;
+        const uint8_t *body = data;
+        if (c > 0 && c < size) {
+            nb.method = METHOD_LZ;
+            nb.csize = c;
+            body = packed;
+        }
+        size_t wrote = nb.csize ? fwrite(body, 1, nb.csize, pk->out) : 0;
+        free(packed);
+        if (wrote != nb.csize || blob_add(pk, &nb) != 0) return -1;
+        pk->pos += nb.csize;
+        b = &pk->blobs[pk->blob_count - 1];
+    }
+
+    strbuf_printf(&pk->index, "F\t%c\t%o\t%d\t%llu\t%llu\t%llu\t%s\t%s\n",
+                  type, mode, b->method, (unsigned long long)b->offset,
+                  (unsigned long long)b->csize, (unsigned long long)size,
+                  sha, rel);
+    pk->files++;
+    pk->raw_bytes += size;
+    return 0;
+}
+
+static int cmp_name(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* pack everything under root/rel in sorted order. repository metadata and
+ * the revision marker are left out: the index records the revision */
+static int pack_dir(Packer *pk, const char *root, const char *rel) {
+    char dir[1024];
+    if (rel[0])
+        snprintf(dir, sizeof(dir), "%s/%s", root, rel);
+    else
+        snprintf(dir, sizeof(dir), "%s", root);
+
+    DIR *d = opendir(dir);
+    if (!d) return -1;
+
+    char **names = NULL;
+    int count = 0, cap = 0;
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        const char *n = ent->d_name;
+        if (strcmp(n, ".") == 0 || strcmp(n, "..") == 0) continue;
+        if (strcmp(n, ".git") == 0) continue;
+        if (!rel[0] && strcmp(n, ".goose-rev") == 0) continue;
+        if (count == cap) {
+            cap = cap ? cap * 2 : 32;
+            char **grown = realloc(names, cap * sizeof(char *));
+            if (!grown) break;
+            names = grown;
+        }
+        names[count++] = strdup(n);
+    }
+    closedir(d);
+    qsort(names, count, sizeof(char *), cmp_name);
+
+    int rc = 0;
+    for (int i = 0; i < count; i++) {
+        char sub[1024], full[2048];
+        if (rel[0])
+            snprintf(sub, sizeof(sub), "%s/%s", rel, names[i]);
+        else
+            snprintf(sub, sizeof(sub), "%s", names[i]);
+        snprintf(full, sizeof(full), "%s/%s", root, sub);
+
+        struct stat st;
+        if (rc != 0 || lstat(full, &st) != 0) continue;
+        if (strpbrk(sub, "\t\n")) {
+            warn("Skipping", "%s (unsupported file name)", full);
+            continue;
+        }
+
+        if (S_ISDIR(st.st_mode)) {
+            /* a directory with nothing packed below it would vanish */
+            int files = pk->files;
+            rc = pack_dir(pk, root, sub);
+            if (rc == 0 && pk->files == files)
+                rc = pack_file(pk, sub, 'd', (int)(st.st_mode & 0777),
+                               (const uint8_t *)"", 0);
+        } else if (S_ISLNK(st.st_mode)) {
+            char target[1024];
+            ssize_t n = readlink(full, target, sizeof(target));
+            if (n < 0 || n == (ssize_t)sizeof(target)) continue;
+            rc = pack_file(pk, sub, 'l', 0777, (uint8_t *)target, (size_t)n);
+        } else if (S_ISREG(st.st_mode)) {
+            FILE *f = fopen(full, "rb");
+            uint8_t *data = malloc(st.st_size ? (size_t)st.st_size : 1);
+            size_t got = f && data ? fread(data, 1, (size_t)st.st_size, f) : 0;
+            if (f) fclose(f);
+            if (!f || !data || got != (size_t)st.st_size) {
+                err("cannot read %s", full);
+                rc = -1;
+            } else {
+                rc = pack_file(pk, sub, 'f', (int)(st.st_mode & 0777), data,
+                               got);
+            }
+            free(data);
+        }
+    }
+    for (int i = 0; i < count; i++) free(names[i]);
+    free(names);
+    return rc;
+}
+
+int vendor_write(const char *path, const VendorPkg *pkgs, int count,
+                 const char *pkg_dir) {
+    char tmp[1024];
+    snprintf(tmp, sizeof(tmp), "%s.partial", path);
+
+    Packer pk;
+    memset(&pk, 0, sizeof(pk));
+    strbuf_init(&pk.index);
+    pk.out = fopen(tmp, "wb");
+    if (!pk.out) {
+        err("cannot write %s", tmp);
+        return -1;
+    }
+
+    uint8_t header[HEADER_LEN];
+    memcpy(header, VENDOR_MAGIC, 8);
+    for (int i = 0; i < 4; i++)
+        header[8 + i] = (uint8_t)(VENDOR_VERSION >> (8 * i));
+    int rc = fwrite(header, 1, HEADER_LEN, pk.out) == HEADER_LEN ? 0 : -1;
+    pk.pos = HEADER_LEN;
+
+    for (int i = 0; i < count && rc == 0; i++) {
+        const VendorPkg *p = &pkgs[i];
+        strbuf_printf(&pk.index, "P\t%s\t%s\t%s\t%s\t%s\t%s\n", p->name,
+                      p->git, p->url, p->version, p->subdir, p->rev);
+        char dir[1024];
+        snprintf(dir, sizeof(dir), "%s/%s", pkg_dir, p->name);
+        rc = pack_dir(&pk, dir, "");
+        if (rc != 0) err("cannot pack '%s' from %s", p->name, dir);
+    }
+
+    if (rc == 0) {
+        uint8_t trailer[TRAILER_LEN];
+        put_u64(trailer, pk.pos);
+        put_u64(trailer + 8, pk.index.len);
+        memcpy(trailer + 16, VENDOR_TRAILER, 8);
+        if (fwrite(pk.index.data, 1, pk.index.len, pk.out) != pk.index.len ||
+            fwrite(trailer, 1, TRAILER_LEN, pk.out) != TRAILER_LEN)
+            rc = -1;
+    }
+    if (fclose(pk.out) != 0) rc = -1;
+
+    if (rc == 0 && rename(tmp, path) != 0) {
+        err("cannot move %s into place", tmp);
+        rc = -1;
+    }
+    if (rc != 0) {
+        remove(tmp);
+    } else {
+        uint64_t total = pk.pos + pk.index.len + TRAILER_LEN;
+        info("Vendored", "%d package%s, %d files (%d unique) into %s",
+             count, count == 1 ? "" : "s", pk.files, pk.blob_count, path);
+        info("Size", "%llu KiB (%llu KiB unpacked)",
+             (unsigned long long)(total + 1023) / 1024,
+             (unsigned long long)(pk.raw_bytes + 1023) / 1024);
+    }
+
+    free(pk.blobs);
+    free(pk.slots);
+    strbuf_free(&pk.index);
+    return rc;
+}
+
+/* --- reading --- */
+
+/* split line on tabs in place, keeping empty fields */
+static int split_tabs(char *line, char **fields, int max) {
+    int n = 0;
+    while (n < max) {
+        fields[n++] = line;
+        char *tab = strchr(line, '\t');
+        if (!tab) break;
+        *tab = '\0';
+        line = tab + 1;
+    }
+    return n;
+}
+
+static int parse_index(Vendor *v) {
+    int pkg_cap = 0, file_cap = 0;
+    char *line = v->index;
+    while (*line) {
+        char *nl = strchr(line, '\n');
+        if (!nl) return -1;
+        *nl = '\0';
+
+        char *f[9];
+        int n = split_tabs(line, f, 9);
+        if (strcmp(f[0], "P") == 0 && n == 7) {
+            if (v->pkg_count == pkg_cap) {
+                pkg_cap = pkg_cap ? pkg_cap * 2 : 16;
+                VendorPkg *grown = realloc(v->pkgs, pkg_cap * sizeof(VendorPkg));
+                if (!grown) return -1;
+                v->pkgs = grown;
+            }
+            VendorPkg *p = &v->pkgs[v->pkg_count++];
+            memset(p, 0, sizeof(*p));
+            snprintf(p->name, sizeof(p->name), "%s", f[1]);
+            snprintf(p->git, sizeof(p->git), "%s", f[2]);
+            snprintf(p->url, sizeof(p->url), "%s", f[3]);
+            snprintf(p->version, sizeof(p->version), "%s", f[4]);
+            snprintf(p->subdir, sizeof(p->subdir), "%s", f[5]);
+            snprintf(p->rev, sizeof(p->rev), "%s", f[6]);
+            p->first_file = v->file_count;
+        } else if (strcmp(f[0], "F") == 0 && n == 9 && v->pkg_count > 0) {
+            if (v->file_count == file_cap) {
+                file_cap = file_cap ? file_cap * 2 : 256;
+                VendorFile *grown =
+                    realloc(v->files, file_cap * sizeof(VendorFile));
+                if (!grown) return -1;
+                v->files = grown;
+            }
+            VendorFile *vf = &v->files[v->file_count++];
+            vf->type = f[1][0];
+            vf->mode = (int)strtol(f[2], NULL, 8);
+            vf->method = atoi(f[3]);
+            vf->offset = strtoull(f[4], NULL, 10);
+            vf->csize = strtoull(f[5], NULL, 10);
+            vf->size = strtoull(f[6], NULL, 10);
+            vf->sha = f[7];
+            vf->path = f[8];
+            v->pkgs[v->pkg_count - 1].file_count++;
+        } else {
+            return -1;
+        }
+        line = nl + 1;
+    }
+    return 0;
+}
+
+Vendor *vendor_open(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    Vendor *v = calloc(1, sizeof(Vendor));
+    if (!v) {
+        fclose(f);
+        return NULL;
+    }
+    v->f = f;
+
+    /* the trailer locates the index; the blobs are only read on demand */
+    uint8_t header[HEADER_LEN], trailer[TRAILER_LEN];
+    int ok = fread(header, 1, HEADER_LEN, f) == HEADER_LEN &&
+             memcmp(header, VENDOR_MAGIC, 8) == 0 &&
+             header[8] >= 1 && header[8] <= VENDOR_VERSION &&
+             fseeko(f, -TRAILER_LEN, SEEK_END) == 0 &&
+             fread(trailer, 1, TRAILER_LEN, f) == TRAILER_LEN &&
+             memcmp(trailer + 16, VENDOR_TRAILER, 8) == 0;
+
+    uint64_t index_off = ok ? get_u64(trailer) : 0;
+    uint64_t index_len = ok ? get_u64(trailer + 8) : 0;
+    if (ok && (index_off < HEADER_LEN || index_len > (1u << 30)))
+        ok = 0;
+    if (ok) {
+        v->index = malloc(index_len + 1);
+        ok = v->index && fseeko(f, (off_t)index_off, SEEK_SET) == 0 &&
+             fread(v->index, 1, index_len, f) == index_len;
+        if (ok) {
+            v->index[index_len] = '\0';
+            ok = parse_index(v) == 0;
+        }
+    }
+
+    if (!ok) {
+        warn("Warn", "%s is not a readable vendor archive, ignoring it", path);
+        vendor_close(v);
+        return NULL;
+    }
+    return v;
+}
+
+void vendor_close(Vendor *v) {
+    if (!v) return;
+    if (v->f) fclose(v->f);
+    free(v->index);
+    free(v->pkgs);
+    free(v->files);
+    free(v);
+}
+
+const VendorPkg *vendor_find(const Vendor *v, const Dependency *dep,
+                             const char *rev) {
+    for (int i = 0; i < v->pkg_count; i++) {
+        const VendorPkg *p = &v->pkgs[i];
+        if (strcmp(p->name, dep->name) != 0) continue;
+        if (dep->url[0]) {
+            if (strcmp(p->url, dep->url) != 0) continue;
+        } else if (strcmp(p->git, dep->git) != 0 ||
+                   strcmp(p->version, dep->version) != 0 ||
+                   strcmp(p->subdir, dep->subdir) != 0) {
+            continue;
+        }
+        if (rev[0] && strcasecmp(p->rev, rev) != 0) continue;
+        return p;
+    }
+    return NULL;
+}
+
+/* an index path that would land outside the package directory */
+static int escapes(const char *path) {
+    if (path[0] == '/') return 1;
+    for (const char *p = path; p; p = strchr(p, '/')) {
+        if (*p == '/') p++;
+        if (p[0] == '.' && p[1] == '.' && (p[2] == '/' || p[2] == '\0'))
+            return 1;
+    }
+    return 0;
+}
+
+/* create the directories of rel below dest, one component at a time.
+ * an entry may not pass through a symbolic link: one unpacked earlier
+ * could point anywhere, and writing through it would land outside dest */
+static int make_parents(const char *dest, const char *rel, int whole) {
+    char path[2048];
+    size_t base = (size_t)snprintf(path, sizeof(path), "%s/", dest);
+    if (base + strlen(rel) >= sizeof(path)) return -1;
+    strcpy(path + base, rel);
+
+    char *end = whole ? path + strlen(path) : strrchr(path + base, '/');
+    for (char *p = path + base; end && p <= end; p++) {
+        if (*p != '/' && *p != '\0') continue;
+        char c = *p;
+        *p = '\0';
+        struct stat st;
+        if (lstat(path, &st) != 0) {
+            if (errno != ENOENT || mkdir(path, 0755) != 0) return -1;
+        } else if (S_ISLNK(st.st_mode)) {
+            err("refusing to unpack %s through the symbolic link %s", rel,
+                path);
+            return -1;
+        } else if (!S_ISDIR(st.st_mode)) {
+            return -1;
+        }
+        *p = c;
+        if (c == '\0') break;
+    }
+    return 0;
+}
+
+static int extract_file(Vendor *v, const VendorFile *vf, const char *dest) {
+    if (escapes(vf->path)) {
+        err("refusing to unpack %s outside of %s", vf->path, dest);
+        return -1;
+    }
+
+    uint8_t *packed = malloc(vf->csize ? vf->csize : 1);
+    uint8_t *data = vf->method == METHOD_LZ ? malloc(vf->size ? vf->size : 1)
+                                            : packed;
+    int ok = packed && data &&
+             fseeko(v->f, (off_t)vf->offset, SEEK_SET) == 0 &&
+             fread(packed, 1, vf->csize, v->f) == vf->csize;
+    if (ok && vf->method == METHOD_LZ)
+        ok = lz_decompress(packed, vf->csize, data, vf->size) == 0;
+    else if (ok)
+        ok = vf->csize == vf->size;
+
+    if (ok) {
+        char sha[SHA256_HEX_LEN];
+        sha256_hex(data, vf->size, sha);
+        ok = strcmp(sha, vf->sha) == 0;
+    }
+    if (!ok) {
+        err("corrupt vendor entry for %s", vf->path);
+        if (data != packed) free(data);
+        free(packed);
+        return -1;
+    }
+
+    char full[2048];
+    snprintf(full, sizeof(full), "%s/%s", dest, vf->path);
+    ok = make_parents(dest, vf->path, vf->type == 'd') == 0;
+
+    if (ok && vf->type == 'd') {
+        chmod(full, (mode_t)vf->mode);
+    } else if (ok && vf->type == 'l') {
+        char target[1024];
+        size_t n = vf->size < sizeof(target) - 1 ? vf->size : sizeof(target) - 1;
+        memcpy(target, data, n);
+        target[n] = '\0';
+        ok = symlink(target, full) == 0;
+    } else if (ok) {
+        /* never through a link, and never over anything already there */
+        int fd = open(full, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW, 0600);
+        FILE *f = fd >= 0 ? fdopen(fd, "wb") : NULL;
+        if (fd >= 0 && !f) close(fd);
+        ok = f && fwrite(data, 1, vf->size, f) == vf->size;
+        if (f && fclose(f) != 0) ok = 0;
+        if (ok) chmod(full, (mode_t)vf->mode);
+    }
+    if (!ok) err("cannot write %s", full);
+
+    if (data != packed) free(data);
+    free(packed);
+    return ok ? 0 : -1;
+}
+
+int vendor_extract(Vendor *v, const VendorPkg *p, const char *dest) {
+    if (fs_mkdir_p(dest) != 0) {
+        err("cannot create %s", dest);
+        return -1;
+    }
+    for (int i = 0; i < p->file_count; i++) {
+        if (extract_file(v, &v->files[p->first_file + i], dest) != 0) {
+            fs_rmrf(dest);
+            return -1;
+        }
+    }
+    return 0;
+}
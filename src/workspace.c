@@ -0,0 +1,204 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "headers/workspace.h"
+#include "headers/cache.h"
+#include "headers/color.h"
+#include "headers/fs.h"
+#include "headers/sha256.h"
+
+void ws_graph_free(WsGraph *g) {
+    free(g->names);
+    free(g->dep);
+    memset(g, 0, sizeof(*g));
+}
+
+/* digest of every member's config, in declared order */
+static void ws_graph_key(const Config *root, const char *config_file,
+                         char key[SHA256_HEX_LEN]) {
+    Sha256 ctx;
+    sha256_init(&ctx);
+    cache_key_field(&ctx, "goose-ws-1");
+    for (int i = 0; i < root->ws_member_count; i++) {
+        char path[1024], hex[SHA256_HEX_LEN];
+        snprintf(path, sizeof(path), "%s/%s", root->ws_members[i], config_file);
+        if (sha256_file_hex(path, hex) != 0)
+            snprintf(hex, sizeof(hex), "missing");
+        cache_key_field(&ctx, root->ws_members[i]);
+        cache_key_field(&ctx, hex);
+    }
+    sha256_final_hex(&ctx, key);
+}
+
+/* read the graph cached for key. returns 0 on a hit */
+static int ws_graph_read(WsGraph *g, const char *path, const char *key) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+
+    char line[1024];
+    int ok = fgets(line, sizeof(line), f) && strncmp(line, "key ", 4) == 0 &&
+             strncmp(line + 4, key, SHA256_HEX_LEN - 1) == 0;
+    int named = 0;
+    while (ok && fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\n")] = '\0';
+        int i, j, off = 0;
+        if (sscanf(line, "name %d %n", &i, &off) == 1 && off > 0 &&
+            i >= 0 && i < g->n) {
+            snprintf(g->names[i], MAX_NAME_LEN, "%s", line + off);
+            named++;
+        } else if (sscanf(line, "dep %d %d", &i, &j) == 2 && i >= 0 &&
+                   i < g->n && j >= 0 && j < g->n) {
+            g->dep[i * g->n + j] = 1;
+        } else {
+            ok = 0;
+        }
+    }
+    fclose(f);
+    return ok && named == g->n ? 0 : -1;
+}
+
+static void ws_graph_write(const WsGraph *g, const char *path,
+                           const char *key) {
+    FILE *f = fopen(path, "w");
+    if (!f) return;
+    fprintf(f, "key %s\n", key);
+    for (int i = 0; i < g->n; i++)
+        fprintf(f, "name %d %s\n", i, g->names[i]);
+    for (int i = 0; i < g->n; i++)
+        for (int j = 0; j < g->n; j++)
+            if (g->dep[i * g->n + j])
+                fprintf(f, "dep %d %d\n", i, j);
+    fclose(f);
+}
+
+/* load every member config once and match its path dependencies against
+ * the members */
+static void ws_graph_scan(WsGraph *g, const char *config_file,
+                          GooseFramework *fw) {
+    char (*real)[4096] = calloc(g->n ? g->n : 1, sizeof(*real));
+    if (!real) return;
+    for (int i = 0; i < g->n; i++)
+        if (!realpath(g->dirs[i], real[i]))
+            snprintf(real[i], sizeof(real[i]), "%s", g->dirs[i]);
+
+    for (int i = 0; i < g->n; i++) {
+        snprintf(g->names[i], MAX_NAME_LEN, "%s", g->dirs[i]);
+        char cfg_path[1024];
+        snprintf(cfg_path, sizeof(cfg_path), "%s/%s", g->dirs[i], config_file);
+        if (!fs_exists(cfg_path)) continue;
+
+        Config cfg;
+        if (config_load(cfg_path, &cfg, fw) != 0) continue;
+        snprintf(g->names[i], MAX_NAME_LEN, "%s", cfg.name);
+        for (int d = 0; d < cfg.dep_count; d++) {
+            if (!cfg.deps[d].path[0]) continue;
+            char resolved[1024], rp[4096];
+            snprintf(resolved, sizeof(resolved), "%s/%s", g->dirs[i],
+                     cfg.deps[d].path);
+            const char *target = realpath(resolved, rp) ? rp : resolved;
+            for (int j = 0; j < g->n; j++)
+                if (j != i && strcmp(real[j], target) == 0)
+                    g->dep[i * g->n + j] = 1;
+        }
+        config_free(&cfg);
+    }
+    free(real);
+}
+
+/* the member graph, from build/workspace.graph while no member config
+ * changed since it was written, so large workspaces skip re-reading every
+ * config on each command */
+int ws_graph_load(const Config *root, GooseFramework *fw, WsGraph *g) {
+    memset(g, 0, sizeof(*g));
+    g->n = root->ws_member_count;
+    g->dirs = root->ws_members;
+    g->names = calloc(g->n ? g->n : 1, sizeof(*g->names));
+    g->dep = calloc(g->n ? (size_t)g->n * g->n : 1, 1);
+    if (!g->names || !g->dep) {
+        ws_graph_free(g);
+        err("out of memory");
+        return -1;
+    }
+
+    char key[SHA256_HEX_LEN], path[1024];
+    ws_graph_key(root, fw->config_file, key);
+    snprintf(path, sizeof(path), "%s/workspace.graph", fw->build_dir);
+    if (ws_graph_read(g, path, key) == 0)
+        return 0;
+
+    memset(g->dep, 0, (size_t)g->n * g->n);
+    ws_graph_scan(g, fw->config_file, fw);
+    fs_mkdir(fw->build_dir);
+    ws_graph_write(g, path, key);
+    return 0;
+}
+
+/* mark members picked with -p / --package as 2 and the members they depend
+ * on, directly or not, as 1; without -p every member is picked. returns
+ * how many were named, -1 for an unknown member */
+int ws_select(const WsGraph *g, int argc, char **argv, int *selected) {
+    int named = 0;
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "-p") != 0 && strcmp(argv[i], "--package") != 0) ||
+            i + 1 >= argc)
+            continue;
+        const char *want = argv[++i];
+        int found = -1;
+        for (int k = 0; k < g->n && found < 0; k++)
+            if (strcmp(g->names[k], want) == 0 || strcmp(g->dirs[k], want) == 0)
+                found = k;
+        if (found < 0) {
+            err("no workspace member named '%s'", want);
+            return -1;
+        }
+        selected[found] = 2;
+        named++;
+    }
+
+    if (named == 0) {
+        for (int i = 0; i < g->n; i++) selected[i] = 1;
+        return 0;
+    }
+
+    for (int changed = 1; changed;) {
+        changed = 0;
+        for (int i = 0; i < g->n; i++) {
+            if (!selected[i]) continue;
+            for (int j = 0; j < g->n; j++) {
+                if (g->dep[i * g->n + j] && !selected[j]) {
+                    selected[j] = 1;
+                    changed = 1;
+                }
+            }
+        }
+    }
+    return named;
+}
+
+/* selected members, dependencies first. members caught in a cycle follow
+ * in declared order. returns how many were ordered */
+int ws_order(const WsGraph *g, const int *selected, int *order) {
+    int *done = calloc(g->n ? g->n : 1, sizeof(int));
+    if (!done) return -1;
+
+    int ordered = 0;
+    for (int progress = 1; progress;) {
+        progress = 0;
+        for (int i = 0; i < g->n; i++) {
+            if (!selected[i] || done[i]) continue;
+            int ready = 1;
+            for (int j = 0; j < g->n && ready; j++)
+                if (j != i && selected[j] && !done[j] && g->dep[i * g->n + j])
+                    ready = 0;
+            if (ready) {
+                order[ordered++] = i;
+                done[i] = 1;
+                progress = 1;
+            }
+        }
+    }
+    for (int i = 0; i < g->n; i++)
+        if (selected[i] && !done[i]) order[ordered++] = i;
+    free(done);
+    return ordered;
+}
@@ -7,6 +7,10 @@ ROOT="$(cd "$(dirname "$0")/.." && pwd)"
 GOOSE="$ROOT/build/goose"
 WORK="$(mktemp -d 2>/dev/null || mktemp -d -t goosetest)"
 
+# keep the machine-wide artifact cache inside the scratch dir
+GOOSE_CACHE_DIR="$WORK/cache"
+export GOOSE_CACHE_DIR
+
 PASS=0
 FAIL=0
 
@@ -95,6 +99,215 @@ echo "$APPRUN" | grep -q "2 + 3 = 5" && ok "path-dep example runs" || bad "path-
 TESTOUT="$( cd "$APP" && "$GOOSE" test 2>&1 )"
 echo "$TESTOUT" | grep -q "2 passed, 0 failed" && ok "example test runner reports 2 passed" || bad "example test runner reports 2 passed"
 
+# --- tests compile and run in parallel, reported in file order ---
+PAR="$WORK/partest"
+mkdir -p "$PAR/src" "$PAR/tests"
+printf 'project:\n  name: "partest"\n  version: "0.1.0"\n' > "$PAR/goose.yaml"
+printf 'int main(void) { return 0; }\n' > "$PAR/src/main.c"
+for t in a b c d; do
+    printf '#include <stdio.h>\n#include <unistd.h>\nint main(void) { sleep(1); puts("out-%s"); return 0; }\n' \
+        "$t" > "$PAR/tests/test_$t.c"
+done
+printf '#include <stdio.h>\nint main(void) { puts("out-e"); return 4; }\n' > "$PAR/tests/test_e.c"
+PARSTART="$( date +%s )"
+PAROUT="$( cd "$PAR" && "$GOOSE" test -j 5 2>&1 )"
+PARTIME=$(( $( date +%s ) - PARSTART ))
+[ "$( echo "$PAROUT" | grep -E "out-|PASS|FAIL" | tr -s ' ' | tr '\n' ',' )" = \
+  "out-a, PASS test_a,out-b, PASS test_b,out-c, PASS test_c,out-d, PASS test_d,out-e, FAIL test_e (exit 4)," ] &&
+    echo "$PAROUT" | grep -q "4 passed, 1 failed" &&
+    ok "test -j captures each test's output and reports in order" || bad "test -j captures each test's output and reports in order"
+[ "$PARTIME" -lt 4 ] && ok "test -j runs tests concurrently" || bad "test -j runs tests concurrently"
+
+# --- tests link the shared sources compiled once, reusing the build's ---
+SHR="$WORK/sharedobj"
+mkdir -p "$SHR/src" "$SHR/tests"
+printf 'project:\n  name: "sharedobj"\n  version: "0.1.0"\n' > "$SHR/goose.yaml"
+printf '#define BASE 40\nint answer(void);\n' > "$SHR/src/answer.h"
+printf '#include "answer.h"\nint answer(void) { return BASE + 2; }\n' > "$SHR/src/answer.c"
+printf '#include "answer.h"\nint main(void) { return answer() == 42 ? 0 : 1; }\n' > "$SHR/src/main.c"
+for t in a b; do
+    printf '#include "answer.h"\nint main(void) { return answer() == 42 ? 0 : 1; }\n' > "$SHR/tests/test_$t.c"
+done
+sleep 1
+( cd "$SHR" && "$GOOSE" build ) >/dev/null 2>&1
+SHROUT="$( cd "$SHR" && "$GOOSE" test 2>&1 )"
+echo "$SHROUT" | grep -q "Reusing.*1 object from earlier builds" &&
+    ! echo "$SHROUT" | grep -q "shared by the tests" &&
+    echo "$SHROUT" | grep -q "2 passed, 0 failed" &&
+    ok "test links the objects the build left behind" || bad "test links the objects the build left behind"
+printf '#define BASE 41\nint answer(void);\n' > "$SHR/src/answer.h"
+SHROUT="$( cd "$SHR" && "$GOOSE" test 2>&1 )"
+echo "$SHROUT" | grep -q "Compiling.*1 source shared by the tests" &&
+    echo "$SHROUT" | grep -q "0 passed, 2 failed" &&
+    ok "test recompiles a shared source once when its header changes" || bad "test recompiles a shared source once when its header changes"
+
+# --- --shard K/N splits the tests across machines, --filter by name ---
+SHD="$WORK/shardtest"
+mkdir -p "$SHD/src" "$SHD/tests"
+printf 'project:\n  name: "shardtest"\n  version: "0.1.0"\n' > "$SHD/goose.yaml"
+printf 'int main(void) { return 0; }\n' > "$SHD/src/main.c"
+for t in a b c d e f; do
+    printf 'int main(void) { return 0; }\n' > "$SHD/tests/test_$t.c"
+done
+printf '#include <unistd.h>\nint main(void) { usleep(300000); return 0; }\n' > "$SHD/tests/test_slow.c"
+( cd "$SHD" && "$GOOSE" test --shard 1/2 && "$GOOSE" test --shard 2/2 ) >/dev/null 2>&1
+[ "$( cat "$SHD"/build/test/results-*-of-2.tsv | cut -f1 | sort | tr '\n' ' ' )" = \
+  "test_a test_b test_c test_d test_e test_f test_slow " ] &&
+    ok "test --shard runs every test in exactly one shard" || bad "test --shard runs every test in exactly one shard"
+SHDJSON="$( cat "$SHD"/build/test/results-*-of-2.jsonl )"
+[ "$( echo "$SHDJSON" | grep -c '^{"project": "shardtest", "shard": "[12]/2", "name": "test_[a-z]*", "status": "pass", ' )" = 7 ] &&
+    ok "shard results concatenate into one JSON-lines file" || bad "shard results concatenate into one JSON-lines file"
+cat "$SHD"/build/test/results-*-of-2.tsv > "$SHD/build/test/timings"
+SHDOUT="$( cd "$SHD" && "$GOOSE" test --no-cache --shard 1/2 2>&1 )"
+echo "$SHDOUT" | grep -q "balanced by recorded durations" &&
+    [ "$( echo "$SHDOUT" | grep PASS | tr -s ' ' )" = " PASS test_slow" ] &&
+    [ "$( cd "$SHD" && "$GOOSE" test --no-cache --filter 'test_[ab]' 2>&1 | grep -c PASS )" = 2 ] &&
+    ok "test --shard balances by duration and --filter selects by name" || bad "test --shard balances by duration and --filter selects by name"
+
+# --- test.timeout kills a hung test and everything it started ---
+TMO="$WORK/timeouttest"
+mkdir -p "$TMO/src" "$TMO/tests"
+printf 'project:\n  name: "timeouttest"\n  version: "0.1.0"\n\ntest:\n  timeout: 1\n' > "$TMO/goose.yaml"
+printf 'int main(void) { return 0; }\n' > "$TMO/src/main.c"
+printf 'int main(void) { return 0; }\n' > "$TMO/tests/test_quick.c"
+printf '#include <unistd.h>\nint main(void) { fork(); sleep(60); return 0; }\n' > "$TMO/tests/test_hang.c"
+TMOSTART="$( date +%s )"
+TMOOUT="$( cd "$TMO" && "$GOOSE" test 2>&1 )"
+TMOTIME=$(( $( date +%s ) - TMOSTART ))
+echo "$TMOOUT" | grep -q "FAIL test_hang (timed out after 1s)" &&
+    echo "$TMOOUT" | grep -q "1 passed, 1 failed" &&
+    [ "$TMOTIME" -lt 10 ] && ! ps -eo args= | grep -q "^build/test/bin/test_hang" &&
+    ok "test.timeout kills a hung test's process group" || bad "test.timeout kills a hung test's process group"
+echo "$TMOOUT" | grep -q "Slowest.*2 of 2 tests" &&
+    grep -q '"name": "test_hang", "status": "timeout", "seconds": 1\.[0-9]*, "max_rss_kib": [1-9]' "$TMO/build/test/results.json" &&
+    grep -q '"name": "test_quick", "status": "pass"' "$TMO/build/test/results.json" &&
+    ok "test reports the slowest tests and writes results.json" || bad "test reports the slowest tests and writes results.json"
+
+# --- a passing test is not run again until its binary or inputs change ---
+CCH="$WORK/cachetest"
+mkdir -p "$CCH/src" "$CCH/tests" "$CCH/data"
+printf 'project:\n  name: "cachetest"\n  version: "0.1.0"\n\ntest:\n  data:\n    - "data"\n  env:\n    - "CACHE_MODE"\n' > "$CCH/goose.yaml"
+printf 'int main(void) { return 0; }\n' > "$CCH/src/main.c"
+printf '#include <stdio.h>\nint main(void) { FILE *f = fopen("runs.log", "a"); fputs("a\\n", f); fclose(f); return 0; }\n' > "$CCH/tests/test_a.c"
+printf '#include <stdio.h>\nint main(void) { FILE *f = fopen("runs.log", "a"); fputs("fail\\n", f); fclose(f); return 1; }\n' > "$CCH/tests/test_fail.c"
+printf 'one\n' > "$CCH/data/input.txt"
+( cd "$CCH" && "$GOOSE" test ) >/dev/null 2>&1
+CCHOUT="$( cd "$CCH" && "$GOOSE" test 2>&1 )"
+echo "$CCHOUT" | grep -q "CACHED test_a" && echo "$CCHOUT" | grep -q "FAIL test_fail" &&
+    echo "$CCHOUT" | grep -q "1 passed, 1 failed" &&
+    [ "$( grep -c '^a$' "$CCH/runs.log" )" = 1 ] && [ "$( grep -c fail "$CCH/runs.log" )" = 2 ] &&
+    ok "test reports an unchanged passing test as CACHED without running it" || bad "test reports an unchanged passing test as CACHED without running it"
+printf 'two\n' > "$CCH/data/input.txt"
+( cd "$CCH" && "$GOOSE" test ) >/dev/null 2>&1
+( cd "$CCH" && CACHE_MODE=x "$GOOSE" test ) >/dev/null 2>&1
+( cd "$CCH" && CACHE_MODE=x "$GOOSE" test ) >/dev/null 2>&1
+( cd "$CCH" && CACHE_MODE=x "$GOOSE" test --no-cache ) >/dev/null 2>&1
+[ "$( grep -c '^a$' "$CCH/runs.log" )" = 4 ] &&
+    ok "test reruns a cached test when its data, env or --no-cache say so" || bad "test reruns a cached test when its data, env or --no-cache say so"
+
+# --- --impacted runs only the tests whose binaries use a changed file ---
+IMP="$WORK/impacttest"
+mkdir -p "$IMP/src" "$IMP/tests"
+printf 'build/\n' > "$IMP/.gitignore"
+printf 'project:\n  name: "impacttest"\n  version: "0.1.0"\n' > "$IMP/goose.yaml"
+printf 'int a(void);\n' > "$IMP/src/a.h"
+printf '#include "a.h"\nint a(void) { return 1; }\n' > "$IMP/src/a.c"
+printf 'int b(void);\n' > "$IMP/src/b.h"
+printf '#include "a.h"\n#include "b.h"\nint b(void) { return a() + 1; }\n' > "$IMP/src/b.c"
+printf 'int main(void) { return 0; }\n' > "$IMP/src/main.c"
+printf '#include "a.h"\nint main(void) { return a() == 1 ? 0 : 1; }\n' > "$IMP/tests/test_a.c"
+printf '#include "b.h"\nint main(void) { return b() == 2 ? 0 : 1; }\n' > "$IMP/tests/test_b.c"
+( cd "$IMP" && git init -q && git add . &&
+  git -c user.name=goose -c user.email=goose@localhost commit -qm base &&
+  "$GOOSE" test ) >/dev/null 2>&1
+printf '#include "a.h"\n#include "b.h"\nint b(void) { return a() + 2; }\n' > "$IMP/src/b.c"
+IMPOUT="$( cd "$IMP" && "$GOOSE" test --impacted 2>&1 )"
+echo "$IMPOUT" | grep -q "FAIL test_b" && ! echo "$IMPOUT" | grep -q "test_a" &&
+    echo "$IMPOUT" | grep -q "Impacted 1 of 2 tests, 1 unchanged since HEAD" &&
+    grep -q "src/a.c" "$IMP/build/test/test_b.impact" && ! grep -q "src/b" "$IMP/build/test/test_a.impact" &&
+    ok "test --impacted skips tests whose binaries do not use a changed source" || bad "test --impacted skips tests whose binaries do not use a changed source"
+IMC="$WORK/impactctor"
+mkdir -p "$IMC/src" "$IMC/tests"
+printf 'build/\n' > "$IMC/.gitignore"
+printf 'project:\n  name: "impactctor"\n  version: "0.1.0"\n' > "$IMC/goose.yaml"
+printf 'int main(void) { return 0; }\n' > "$IMC/src/main.c"
+printf '#include <stdlib.h>\n__attribute__((constructor)) static void init(void) { setenv("IMC_MODE", "1", 1); }\n' > "$IMC/src/mode.c"
+printf '#include <stdlib.h>\nint main(void) { const char *m = getenv("IMC_MODE"); return m && m[0] == 0x31 ? 0 : 1; }\n' > "$IMC/tests/test_mode.c"
+( cd "$IMC" && git init -q && git add . &&
+  git -c user.name=goose -c user.email=goose@localhost commit -qm base &&
+  "$GOOSE" test ) >/dev/null 2>&1
+printf '#include <stdlib.h>\n__attribute__((constructor)) static void init(void) { setenv("IMC_MODE", "2", 1); }\n' > "$IMC/src/mode.c"
+IMPOUT="$( cd "$IMC" && "$GOOSE" test --impacted 2>&1 )"
+echo "$IMPOUT" | grep -q "FAIL test_mode" && grep -q "src/mode.c" "$IMC/build/test/test_mode.impact" &&
+    ok "test --impacted counts a source that acts only through a constructor" || bad "test --impacted counts a source that acts only through a constructor"
+
+# --- TEST cases from several files link into one runner ---
+HAR="$WORK/harnesstest"
+mkdir -p "$HAR/src" "$HAR/tests"
+printf 'project:\n  name: "harnesstest"\n  version: "0.1.0"\n\ntest:\n  timeout: 2\n' > "$HAR/goose.yaml"
+printf 'int add(int a, int b);\n' > "$HAR/src/add.h"
+printf '#include "add.h"\nint add(int a, int b) { return a + b; }\n' > "$HAR/src/add.c"
+printf 'int main(void) { return 0; }\n' > "$HAR/src/main.c"
+printf '#include "goose_test.h"\n#include "add.h"\nTEST(adds) { CHECK(add(1, 2) == 3); }\nTEST(wrong) { REQUIRE(add(1, 2) == 4); }\n' > "$HAR/tests/math.c"
+printf '#include "goose_test.h"\nTEST(hangs) { for (;;) ; }\nTEST(crashes) { *(volatile int *)0 = 1; }\n' > "$HAR/tests/bad.c"
+printf 'int main(void) { return 0; }\n' > "$HAR/tests/test_plain.c"
+HAROUT="$( cd "$HAR" && "$GOOSE" test 2>&1 )"
+echo "$HAROUT" | grep -q "PASS math.adds" && echo "$HAROUT" | grep -q "REQUIRE failed: add(1, 2) == 4" &&
+    echo "$HAROUT" | grep -q "FAIL math.wrong (exit 1)" && echo "$HAROUT" | grep -q "FAIL bad.hangs (timed out" &&
+    echo "$HAROUT" | grep -q "FAIL bad.crashes (signal" && echo "$HAROUT" | grep -q "PASS test_plain" &&
+    echo "$HAROUT" | grep -q "2 passed, 3 failed" && [ -x "$HAR/build/test/bin/goose_tests" ] &&
+    [ ! -e "$HAR/build/test/bin/math" ] && grep -q '"name": "math.adds"' "$HAR/build/test/results.json" &&
+    ok "test runs TEST cases of several files from one runner binary" || bad "test runs TEST cases of several files from one runner binary"
+# a test named like a file goose test keeps beside the binaries
+printf 'int main(void) { return 0; }\n' > "$HAR/tests/timings.c"
+printf 'int main(void) { return 0; }\n' > "$HAR/tests/include.c"
+( cd "$HAR" && "$GOOSE" test ) >/dev/null 2>&1
+HAROUT="$( cd "$HAR" && "$GOOSE" test 2>&1 )"
+echo "$HAROUT" | grep -q "CACHED timings" && echo "$HAROUT" | grep -q "CACHED include" &&
+    [ -x "$HAR/build/test/bin/timings" ] && grep -q "^timings	" "$HAR/build/test/timings" &&
+    [ -f "$HAR/build/test/include/goose_test.h" ] &&
+    ok "test binaries named timings or include keep apart from its records" || bad "test binaries named timings or include keep apart from its records"
+rm "$HAR/tests/timings.c" "$HAR/tests/include.c"
+HAROUT="$( cd "$HAR" && "$GOOSE" test --filter 'math.*' --no-cache 2>&1 )"
+echo "$HAROUT" | grep -q "PASS math.adds" && ! echo "$HAROUT" | grep -q "bad\." &&
+    ! echo "$HAROUT" | grep -q "test_plain" && echo "$HAROUT" | grep -q "1 passed, 1 failed" &&
+    ok "test --filter selects TEST cases by file.case name" || bad "test --filter selects TEST cases by file.case name"
+
+# --- bench: BENCH() files link into one release runner with statistics ---
+BEN="$WORK/benchtest"
+mkdir -p "$BEN/src" "$BEN/benches"
+printf 'project:\n  name: "benchtest"\n  version: "0.1.0"\n' > "$BEN/goose.yaml"
+printf 'unsigned sum(const unsigned char *p, unsigned n);\n' > "$BEN/src/sum.h"
+printf '#include "sum.h"\nunsigned sum(const unsigned char *p, unsigned n) { unsigned s = 0; while (n--) s += *p++; return s; }\n' > "$BEN/src/sum.c"
+printf 'int main(void) { return 0; }\n' > "$BEN/src/main.c"
+printf '#include "goose_bench.h"\n#include "sum.h"\nstatic unsigned char buf[1024];\nBENCH(sum1k) {\n    goose_bench_bytes(sizeof(buf));\n    for (uint64_t i = 0; i < iters; i++) { unsigned s = sum(buf, sizeof(buf)); do_not_optimize(s); }\n}\n' > "$BEN/benches/sum.c"
+printf '#include "goose_bench.h"\nBENCH(spin) { for (uint64_t i = 0; i < iters; i++) clobber_memory(); }\n' > "$BEN/benches/loop.c"
+BENOUT="$( cd "$BEN" && "$GOOSE" bench --time 0.05 2>&1 )"
+echo "$BENOUT" | grep -q "Benching benchtest v0.1.0 (release)" &&
+    echo "$BENOUT" | grep "sum.sum1k" | grep -q "B/s" && echo "$BENOUT" | grep "loop.spin" | grep -q " ns " &&
+    grep -q '"name": "sum.sum1k".*"median_ns": .*"mad_ns": .*"p99_ns": .*"bytes_per_sec"' "$BEN/build/bench/results.json" &&
+    [ "$( cd "$BEN" && "$GOOSE" bench --time 0.05 --filter 'loop.*' 2>&1 | grep -c '^  [a-z]*\.' )" = 1 ] &&
+    ok "bench reports median, MAD, p99 and throughput per benchmark" || bad "bench reports median, MAD, p99 and throughput per benchmark"
+( cd "$BEN" && "$GOOSE" bench --time 0.05 --filter 'sum.*' --save-baseline main ) >/dev/null 2>&1
+printf '#include "sum.h"\nunsigned sum(const unsigned char *p, unsigned n) { unsigned s = 0; for (unsigned k = 1; k <= 16; k++) for (unsigned i = 0; i < n; i++) s = (s ^ p[i]) * k + 1; return s; }\n' > "$BEN/src/sum.c"
+BENOUT="$( cd "$BEN" && "$GOOSE" bench --time 0.05 --filter 'sum.*' --baseline main --fail-above 5% 2>&1 )"
+BENRC=$?
+[ "$BENRC" -ne 0 ] && grep -q '^# key ' "$BEN/build/bench/baselines/main.tsv" &&
+    echo "$BENOUT" | grep "sum.sum1k" | grep -q "regressed" &&
+    echo "$BENOUT" | grep -q "1 benchmark regressed by more than 5% against baseline main" &&
+    grep -q '"baseline": "main"' "$BEN/build/bench/results.json" &&
+    grep -q '"change_lo": .*"verdict": "regressed"' "$BEN/build/bench/results.json" &&
+    ok "bench --baseline --fail-above fails on a confident slowdown" || bad "bench --baseline --fail-above fails on a confident slowdown"
+printf 'project:\n  name: "benchtest"\n  version: "0.1.0"\n\nbuild:\n  cflags: "-Wall -DBENCH_FLAGS_CHANGED"\n' > "$BEN/goose.yaml"
+BENOUT="$( cd "$BEN" && "$GOOSE" bench --time 0.05 --filter 'sum.*' --baseline main --fail-above 5% 2>&1 )" &&
+    echo "$BENOUT" | grep -q "main was measured with other flags or another compiler; comparing without --fail-above" &&
+    echo "$BENOUT" | grep -q "sum.sum1k" && ! grep -q '"verdict": "regressed"' "$BEN/build/bench/results.json" &&
+    ok "bench --fail-above does not gate on a baseline of other flags" || bad "bench --fail-above does not gate on a baseline of other flags"
+BENOUT="$( cd "$BEN" && "$GOOSE" bench --time 0.05 --filter 'loop.*' --counters 2>&1 )" &&
+    { grep -Eq '"counters": [{].*"(cycles|task_clock_ns)"' "$BEN/build/bench/results.json" ||
+      echo "$BENOUT" | grep -q "perf_event_open is not available"; } &&
+    ok "bench --counters reports perf counters or says why not" || bad "bench --counters reports perf counters or says why not"
+
 # --- library mode: type "lib" produces a static archive ---
 LIB="$WORK/greet"
 mkdir -p "$LIB/src" "$LIB/include"
@@ -156,6 +369,147 @@ check "lib-consumer binary builds" test -x "$CONS/build/debug/greetapp"
 CONSRUN="$( cd "$CONS" && "$GOOSE" run 2>/dev/null )"
 echo "$CONSRUN" | grep -q "greet=42" && ok "lib-consumer binary runs" || bad "lib-consumer binary runs"
 
+# --- archive dependency: file:// tarball verified by sha256 ---
+sha256_of() {
+    if command -v sha256sum >/dev/null 2>&1; then
+        sha256sum "$1" | cut -d' ' -f1
+    else
+        shasum -a 256 "$1" | cut -d' ' -f1
+    fi
+}
+ARC="$WORK/arc"
+mkdir -p "$ARC/tiny-1.0/src" "$ARC/tiny-1.0/include" "$ARC/app/src"
+cat > "$ARC/tiny-1.0/goose.yaml" <<'YAML'
+project:
+  name: "tiny"
+  version: "1.0.0"
+
+build:
+  includes:
+    - "include"
+YAML
+cat > "$ARC/tiny-1.0/include/tiny.h" <<'H'
+#ifndef TINY_H
+#define TINY_H
+int tiny_value(void);
+#endif
+H
+cat > "$ARC/tiny-1.0/src/tiny.c" <<'C'
+#include "tiny.h"
+int tiny_value(void) { return 9; }
+C
+( cd "$ARC" && tar czf tiny-1.0.tar.gz tiny-1.0 )
+ARCSUM="$(sha256_of "$ARC/tiny-1.0.tar.gz")"
+cat > "$ARC/app/goose.yaml" <<YAML
+project:
+  name: "arcapp"
+  version: "0.1.0"
+
+build:
+  includes:
+    - "src"
+
+dependencies:
+  tiny:
+    url: "file://$ARC/tiny-1.0.tar.gz"
+    sha256: "$ARCSUM"
+YAML
+cat > "$ARC/app/src/main.c" <<'C'
+#include <stdio.h>
+#include <tiny.h>
+int main(void) {
+    printf("tiny=%d\n", tiny_value());
+    return 0;
+}
+C
+ARCRUN="$( cd "$ARC/app" && "$GOOSE" run 2>/dev/null )"
+echo "$ARCRUN" | grep -q "tiny=9" && ok "archive dependency builds and runs" || bad "archive dependency builds and runs"
+grep -q "sha256 = \"$ARCSUM\"" "$ARC/app/goose.lock" && ok "archive digest recorded in lock" || bad "archive digest recorded in lock"
+printf '# goose.lock - auto-generated, do not edit\n\n[[package]]\nname = "tiny"\nurl = "file://%s/tiny-1.0.tar.gz"\nsha256 = "%s"\n\n' "$ARC" "$ARCSUM" > "$ARC/app/goose.lock"
+( cd "$ARC/app" && "$GOOSE" build ) >/dev/null 2>&1
+grep -q '^version = 2' "$ARC/app/goose.lock" && grep -q "sha256 = \"$ARCSUM\"" "$ARC/app/goose.lock" && ok "v1 lock is read and upgraded" || bad "v1 lock is read and upgraded"
+rm -rf "$ARC/app/packages"
+sed "s/$ARCSUM/0000$ARCSUM/" "$ARC/app/goose.yaml" > "$ARC/app/goose.yaml.tmp" && mv "$ARC/app/goose.yaml.tmp" "$ARC/app/goose.yaml"
+if ( cd "$ARC/app" && "$GOOSE" build ) >/dev/null 2>&1; then
+    bad "archive digest mismatch is rejected"
+else
+    test ! -d "$ARC/app/packages/tiny" && ok "archive digest mismatch is rejected" || bad "archive digest mismatch is rejected"
+fi
+mkdir -p "$ARC/quote/src"
+printf 'int main(void) { return 0; }\n' > "$ARC/quote/src/main.c"
+printf 'project:\n  name: "quote"\n  version: "0.1.0"\n\ndependencies:\n  tiny:\n    url: "http://127.0.0.1:9/x%stouch %s%s.tar.gz"\n    sha256: "%s"\n' \
+    "';" "$ARC/injected" ";'" "$ARCSUM" > "$ARC/quote/goose.yaml"
+( cd "$ARC/quote" && "$GOOSE" build ) >/dev/null 2>&1
+test ! -e "$ARC/injected" && ok "archive URL with a quote is passed to curl as one word" || bad "archive URL with a quote is passed to curl as one word"
+
+# --- resolver: diamond path deps resolve once, cycles are reported ---
+DIA="$WORK/diamond"
+mkdir -p "$DIA/util/src" "$DIA/left/src" "$DIA/right/src" "$DIA/app/src"
+cat > "$DIA/util/goose.yaml" <<'YAML'
+project:
+  name: "util"
+  version: "1.0.0"
+
+build:
+  includes:
+    - "src"
+YAML
+printf 'int util_base(void);\n' > "$DIA/util/src/util.h"
+printf 'int util_base(void) { return 10; }\n' > "$DIA/util/src/util.c"
+for side in left right; do
+cat > "$DIA/$side/goose.yaml" <<YAML
+project:
+  name: "$side"
+  version: "1.0.0"
+
+build:
+  includes:
+    - "src"
+
+dependencies:
+  util:
+    path: "../util"
+YAML
+printf 'int %s_value(void);\n' "$side" > "$DIA/$side/src/$side.h"
+printf '#include "util.h"\nint %s_value(void) { return util_base() + 1; }\n' "$side" > "$DIA/$side/src/$side.c"
+done
+cat > "$DIA/app/goose.yaml" <<'YAML'
+project:
+  name: "diamond"
+  version: "0.1.0"
+
+build:
+  includes:
+    - "src"
+
+dependencies:
+  left:
+    path: "../left"
+  right:
+    path: "../right"
+YAML
+cat > "$DIA/app/src/main.c" <<'C'
+#include <stdio.h>
+#include <left.h>
+#include <right.h>
+int main(void) {
+    printf("sum=%d\n", left_value() + right_value());
+    return 0;
+}
+C
+DIARUN="$( cd "$DIA/app" && "$GOOSE" run 2>/dev/null )"
+echo "$DIARUN" | grep -q "sum=22" && ok "diamond dependency links shared dep once" || bad "diamond dependency links shared dep once"
+grep -q '^version = 2' "$DIA/app/goose.lock" && ok "lock is written as format v2" || bad "lock is written as format v2"
+grep -q '^dependents = \["left", "right"\]' "$DIA/app/goose.lock" && ok "lock records transitive edges" || bad "lock records transitive edges"
+cat >> "$DIA/util/goose.yaml" <<'YAML'
+
+dependencies:
+  left:
+    path: "../left"
+YAML
+CYCOUT="$( cd "$DIA/app" && "$GOOSE" build 2>&1 )"
+echo "$CYCOUT" | grep -q "dependency cycle" && ok "dependency cycle is reported" || bad "dependency cycle is reported"
+
 # --- workspace: builds all members in dependency order ---
 WS="$WORK/ws"
 mkdir -p "$WS/corelib/src" "$WS/corelib/include" "$WS/tool/src"
@@ -228,6 +582,347 @@ WSOUT="$( cd "$WS" && "$GOOSE" build 2>&1 )"
 echo "$WSOUT" | grep -q "2 ok, 0 failed" && ok "workspace reports all members built" || bad "workspace reports all members built"
 check "workspace built lib member archive" test -f "$WS/corelib/build/debug/libcorelib.a"
 check "workspace built binary member" test -x "$WS/tool/build/debug/tool"
+mkdir -p "$WS/extra/src"
+printf 'project:\n  name: "extra"\n  version: "0.1.0"\n' > "$WS/extra/goose.yaml"
+printf 'int main(void) { return 0; }\n' > "$WS/extra/src/main.c"
+printf 'workspace:\n  members:\n    - "tool"\n    - "corelib"\n    - "extra"\n\nproject:\n  name: "ws"\n  version: "0.1.0"\n' > "$WS/goose.yaml"
+rm -rf "$WS/corelib/build" "$WS/tool/build"
+WSPOUT="$( cd "$WS" && "$GOOSE" build -p tool 2>&1 )"
+echo "$WSPOUT" | grep -q "2 of 3 members" && [ -f "$WS/corelib/build/debug/libcorelib.a" ] &&
+    [ ! -d "$WS/extra/build" ] && grep -q "^dep 0 1$" "$WS/build/workspace.graph" &&
+    ok "build -p builds a member and the members it needs" || bad "build -p builds a member and the members it needs"
+WSRUN="$( cd "$WS" && "$GOOSE" run -p tool 2>/dev/null )"
+echo "$WSRUN" | grep -q "answer=7" && ok "run -p runs the selected member" || bad "run -p runs the selected member"
+printf 'build/\npackages/\n' > "$WS/.gitignore"
+mkdir -p "$WS/corelib/tests"
+printf '#include "corelib.h"\nint main(void) { return core_answer() == 7 ? 0 : 1; }\n' > "$WS/corelib/tests/test_answer.c"
+printf '#define LIMIT 3\n' > "$WS/corelib/tests/limit.h"
+printf '#include "limit.h"\nint main(void) { return LIMIT > 2 ? 0 : 1; }\n' > "$WS/corelib/tests/test_limit.c"
+( cd "$WS" && git init -q && git add . &&
+  git -c user.name=goose -c user.email=goose@localhost commit -qm base ) >/dev/null 2>&1
+printf '#define LIMIT 4\n' > "$WS/corelib/tests/limit.h"
+AFFOUT="$( cd "$WS" && "$GOOSE" test --affected 2>&1 )"
+echo "$AFFOUT" | grep -q "2 of 3 members" && echo "$AFFOUT" | grep -q "1 of 2 tests" &&
+    echo "$AFFOUT" | grep -q "PASS test_limit" && ! echo "$AFFOUT" | grep -q "test_answer" &&
+    ok "test --affected runs only the tests a change reaches" || bad "test --affected runs only the tests a change reaches"
+( cd "$WS" && git add . && git -c user.name=goose -c user.email=goose@localhost commit -qm limit ) >/dev/null 2>&1
+printf 'int main(void) { return 0; }\n\n' > "$WS/extra/src/main.c"
+AFFOUT="$( cd "$WS" && "$GOOSE" build --since HEAD 2>&1 )"
+echo "$AFFOUT" | grep -q "1 of 3 members" && echo "$AFFOUT" | grep -q "Building extra" &&
+    ! echo "$AFFOUT" | grep -q "Building tool" &&
+    ok "build --since builds only changed members and their dependents" || bad "build --since builds only changed members and their dependents"
+printf '\ntasks:\n  stamp: "sleep 1; echo core-out; touch ../stamp"\n' >> "$WS/corelib/goose.yaml"
+printf '\ntasks:\n  stamp: "test -f ../stamp && echo tool-out"\n' >> "$WS/tool/goose.yaml"
+TASKOUT="$( cd "$WS" && "$GOOSE" task stamp --workspace --ordered -j 2 2>&1 )"
+echo "$TASKOUT" | grep -q "2 passed, 0 failed, 0 skipped" && echo "$TASKOUT" | grep -q "core-out" &&
+    echo "$TASKOUT" | grep -q "tool-out" &&
+    ok "task --workspace --ordered runs members after their dependencies" || bad "task --workspace --ordered runs members after their dependencies"
+rm -f "$WS/stamp"
+TASKOUT="$( cd "$WS" && "$GOOSE" task stamp --workspace -j 2 2>&1 )"
+[ $? -ne 0 ] && echo "$TASKOUT" | grep -q "1 passed, 1 failed" &&
+    ok "task --workspace reports failing members" || bad "task --workspace reports failing members"
+
+# --- workspace: one packages/ and lock at the root, package objects shared ---
+WSP="$WORK/wsp"
+mkdir -p "$WSP/shared/src" "$WSP/one/src" "$WSP/two/src"
+printf 'int shared_v(void) { return 3; }\n' > "$WSP/shared/src/shared.c"
+( cd "$WSP/shared" && git init -q && git add . &&
+  git -c user.name=goose -c user.email=goose@localhost commit -qm one ) >/dev/null 2>&1
+printf 'workspace:\n  members:\n    - "one"\n    - "two"\n\nproject:\n  name: "wsp"\n  version: "0.1.0"\n' > "$WSP/goose.yaml"
+for m in one two; do
+    printf 'project:\n  name: "%s"\n  version: "0.1.0"\n\ndependencies:\n  shared:\n    git: "file://%s/shared"\n' \
+        "$m" "$WSP" > "$WSP/$m/goose.yaml"
+    printf '#include <stdio.h>\nint shared_v(void);\nint main(void) { printf("%s=%%d\\n", shared_v()); return 0; }\n' \
+        "$m" > "$WSP/$m/src/main.c"
+done
+WSPOUT="$( cd "$WSP" && "$GOOSE" build 2>&1 )"
+[ -d "$WSP/packages/shared" ] && [ -f "$WSP/goose.lock" ] &&
+    [ ! -e "$WSP/one/packages" ] && [ ! -e "$WSP/two/goose.lock" ] &&
+    [ "$( echo "$WSPOUT" | grep -c "Fetching shared" )" = "1" ] &&
+    ok "workspace fetches packages once into the root" || bad "workspace fetches packages once into the root"
+echo "$WSPOUT" | grep -q "Reusing 1 package object from earlier members" &&
+    "$WSP/two/build/debug/two" | grep -q "two=3" &&
+    ok "workspace members share package objects" || bad "workspace members share package objects"
+
+# --- monorepo subdir dependency: partial clone + sparse checkout ---
+MONO="$WORK/mono"
+mkdir -p "$MONO/repo/libs/widget/src" "$MONO/repo/libs/widget/include" \
+         "$MONO/repo/tools/unrelated" "$MONO/app/src"
+cat > "$MONO/repo/libs/widget/goose.yaml" <<'YAML'
+project:
+  name: "widget"
+  version: "1.0.0"
+
+build:
+  includes:
+    - "include"
+YAML
+printf 'int widget_size(void);\n' > "$MONO/repo/libs/widget/include/widget.h"
+printf '#include "widget.h"\nint widget_size(void) { return 7; }\n' > "$MONO/repo/libs/widget/src/widget.c"
+printf 'int not_wanted(void) { return 0; }\n' > "$MONO/repo/tools/unrelated/skip.c"
+( cd "$MONO/repo" && git init -q && git config uploadpack.allowFilter true &&
+  git add . && git -c user.name=goose -c user.email=goose@localhost commit -qm init ) >/dev/null 2>&1
+cat > "$MONO/app/goose.yaml" <<'YAML'
+project:
+  name: "monoapp"
+  version: "0.1.0"
+
+build:
+  includes:
+    - "src"
+YAML
+cat > "$MONO/app/src/main.c" <<'C'
+#include <stdio.h>
+#include <widget.h>
+int main(void) {
+    printf("widget=%d\n", widget_size());
+    return 0;
+}
+C
+( cd "$MONO/app" && "$GOOSE" add "file://$MONO/repo" --subdir libs/widget ) >/dev/null 2>&1
+MONORUN="$( cd "$MONO/app" && "$GOOSE" run 2>/dev/null )"
+echo "$MONORUN" | grep -q "widget=7" && ok "subdir dependency builds and runs" || bad "subdir dependency builds and runs"
+test -f "$MONO/app/packages/widget/libs/widget/src/widget.c" && test ! -e "$MONO/app/packages/widget/tools" &&
+    ok "subdir dependency checks out only its subtree" || bad "subdir dependency checks out only its subtree"
+grep -q 'subdir = "libs/widget"' "$MONO/app/goose.lock" && ok "subdir recorded in lock" || bad "subdir recorded in lock"
+
+# --- artifact cache: a locked lib is compiled once per machine ---
+CACHE="$WORK/artcache"
+mkdir -p "$CACHE/clib/src" "$CACHE/app1/src"
+cat > "$CACHE/clib/goose.yaml" <<'YAML'
+project:
+  name: "clib"
+  version: "1.0.0"
+  type: "lib"
+
+build:
+  includes:
+    - "src"
+YAML
+printf 'int clib_value(void);\n' > "$CACHE/clib/src/clib.h"
+printf '#include "clib.h"\nint clib_value(void) { return 5; }\n' > "$CACHE/clib/src/clib.c"
+( cd "$CACHE/clib" && git init -q && git add . &&
+  git -c user.name=goose -c user.email=goose@localhost commit -qm init ) >/dev/null 2>&1
+cat > "$CACHE/app1/goose.yaml" <<YAML
+project:
+  name: "app1"
+  version: "0.1.0"
+
+build:
+  includes:
+    - "src"
+
+dependencies:
+  clib:
+    git: "file://$CACHE/clib"
+YAML
+cat > "$CACHE/app1/src/main.c" <<'C'
+#include <stdio.h>
+#include <clib.h>
+int main(void) {
+    printf("clib=%d\n", clib_value());
+    return 0;
+}
+C
+cp -R "$CACHE/app1" "$CACHE/app2"
+( cd "$CACHE/app1" && "$GOOSE" build ) >/dev/null 2>&1
+CACHEOUT="$( cd "$CACHE/app2" && "$GOOSE" build 2>&1 )"
+echo "$CACHEOUT" | grep -q "Cached clib" && ! echo "$CACHEOUT" | grep -q "Compiling clib" &&
+    ok "second project reuses the cached lib archive" || bad "second project reuses the cached lib archive"
+CACHERUN="$( "$CACHE/app2/build/debug/app1" 2>/dev/null )"
+echo "$CACHERUN" | grep -q "clib=5" && ok "binary linked from cached archive runs" || bad "binary linked from cached archive runs"
+RELOUT="$( cd "$CACHE/app2" && "$GOOSE" build --release 2>&1 )"
+echo "$RELOUT" | grep -q "Compiling clib" && ok "release profile has its own cache key" || bad "release profile has its own cache key"
+
+# a lib whose archive holds a header of a package two levels down
+for p in ta tb tc; do mkdir -p "$CACHE/$p/src"; done
+printf 'project:\n  name: "ta"\n  version: "1.0.0"\n  type: "lib"\n\nbuild:\n  includes:\n    - "src"\n\ndependencies:\n  tb:\n    git: "file://%s/tb"\n' "$CACHE" > "$CACHE/ta/goose.yaml"
+printf 'project:\n  name: "tb"\n  version: "1.0.0"\n\nbuild:\n  includes:\n    - "src"\n\ndependencies:\n  tc:\n    git: "file://%s/tc"\n' "$CACHE" > "$CACHE/tb/goose.yaml"
+printf 'project:\n  name: "tc"\n  version: "1.0.0"\n\nbuild:\n  includes:\n    - "src"\n' > "$CACHE/tc/goose.yaml"
+printf 'int ta_value(void);\n' > "$CACHE/ta/src/ta.h"
+printf '#include "ta.h"\n#include "tb.h"\nint ta_value(void) { return TB_VALUE; }\n' > "$CACHE/ta/src/ta.c"
+printf '#include "../../tc/src/tc.h"\n#define TB_VALUE TC_VALUE\n' > "$CACHE/tb/src/tb.h"
+printf 'int tb_unused;\n' > "$CACHE/tb/src/tb.c"
+printf '#define TC_VALUE 1\n' > "$CACHE/tc/src/tc.h"
+printf 'int tc_unused;\n' > "$CACHE/tc/src/tc.c"
+for p in ta tb tc; do
+    ( cd "$CACHE/$p" && git init -q && git add . &&
+      git -c user.name=goose -c user.email=goose@localhost commit -qm init ) >/dev/null 2>&1
+done
+mkdir -p "$CACHE/tapp1/src"
+printf 'project:\n  name: "tapp"\n  version: "0.1.0"\n\ndependencies:\n  ta:\n    git: "file://%s/ta"\n' "$CACHE" > "$CACHE/tapp1/goose.yaml"
+printf '#include <stdio.h>\nint ta_value(void);\nint main(void) { printf("ta=%%d\\n", ta_value()); return 0; }\n' > "$CACHE/tapp1/src/main.c"
+cp -R "$CACHE/tapp1" "$CACHE/tapp2"
+( cd "$CACHE/tapp1" && "$GOOSE" build ) >/dev/null 2>&1
+printf '#define TC_VALUE 2\n' > "$CACHE/tc/src/tc.h"
+( cd "$CACHE/tc" && git -c user.name=goose -c user.email=goose@localhost commit -qam two ) >/dev/null 2>&1
+TCOUT="$( cd "$CACHE/tapp2" && "$GOOSE" build 2>&1 )"
+echo "$TCOUT" | grep -q "Compiling ta" && "$CACHE/tapp2/build/debug/tapp" | grep -q "ta=2" &&
+    ok "lib cache key covers packages its dependencies depend on" || bad "lib cache key covers packages its dependencies depend on"
+
+# --- pipelined build: sources needing no package compile while it is fetched ---
+cp -R "$CACHE/app1" "$CACHE/app3"
+rm -rf "$CACHE/app3/build" "$CACHE/app3/packages" "$CACHE/app3/goose.lock"
+printf '#include <string.h>\nint util_len(void) { return (int)strlen("ab"); }\n' > "$CACHE/app3/src/util.c"
+PIPEOUT="$( cd "$CACHE/app3" && "$GOOSE" build -j 2 2>&1 )"
+echo "$PIPEOUT" | grep -q "Compiling 1 of 2 sources ahead of dependencies" &&
+    ok "project sources compile ahead of dependencies" || bad "project sources compile ahead of dependencies"
+PIPERUN="$( "$CACHE/app3/build/debug/app1" 2>/dev/null )"
+echo "$PIPERUN" | grep -q "clib=5" && ok "pipelined build links and runs" || bad "pipelined build links and runs"
+[ -f "$CACHE/app3/build/debug/obj-ahead/src/util.o" ] && [ ! -e "$CACHE/app3/build/debug/obj/src/util.o" ] &&
+    [ -f "$CACHE/app3/build/debug/obj-ahead/flags" ] &&
+    ! cmp -s "$CACHE/app3/build/debug/obj/flags" "$CACHE/app3/build/debug/obj-ahead/flags" &&
+    ok "sources compiled ahead keep their own objects and flags" || bad "sources compiled ahead keep their own objects and flags"
+
+# --- lock sync: check out exactly the locked commit, fetching only it ---
+SYNC="$WORK/sync"
+mkdir -p "$SYNC/lib/src" "$SYNC/app/src"
+printf 'int lib_v(void) { return 1; }\n' > "$SYNC/lib/src/lib.c"
+( cd "$SYNC/lib" && git init -q && git add . &&
+  git -c user.name=goose -c user.email=goose@localhost commit -qm one ) >/dev/null 2>&1
+cat > "$SYNC/app/goose.yaml" <<YAML
+project:
+  name: "app"
+  version: "0.1.0"
+
+build:
+  includes:
+    - "src"
+
+dependencies:
+  lib:
+    git: "file://$SYNC/lib"
+YAML
+printf '#include <stdio.h>\nint lib_v(void);\nint main(void) { printf("v=%%d\\n", lib_v()); return 0; }\n' > "$SYNC/app/src/main.c"
+( cd "$SYNC/app" && "$GOOSE" build ) >/dev/null 2>&1
+SYNC_ONE="$( git -C "$SYNC/lib" rev-parse HEAD )"
+printf 'int lib_v(void) { return 2; }\n' > "$SYNC/lib/src/lib.c"
+( cd "$SYNC/lib" && git -c user.name=goose -c user.email=goose@localhost commit -qam two ) >/dev/null 2>&1
+SYNC_TWO="$( git -C "$SYNC/lib" rev-parse HEAD )"
+rm -rf "$SYNC/app/packages"
+SYNCRUN="$( cd "$SYNC/app" && "$GOOSE" run 2>/dev/null )"
+echo "$SYNCRUN" | grep -q "v=1" && ok "fresh clone honours the locked revision" || bad "fresh clone honours the locked revision"
+sed "s/$SYNC_ONE/$SYNC_TWO/" "$SYNC/app/goose.lock" > "$SYNC/lock.tmp" && mv "$SYNC/lock.tmp" "$SYNC/app/goose.lock"
+SYNCRUN="$( cd "$SYNC/app" && "$GOOSE" run 2>/dev/null )"
+echo "$SYNCRUN" | grep -q "v=2" &&
+    [ "$( git -C "$SYNC/app/packages/lib" rev-parse --is-shallow-repository )" = "true" ] &&
+    ok "lock sync fetches just the locked commit" || bad "lock sync fetches just the locked commit"
+for v in 3 4; do
+    printf 'int lib_v(void) { return %s; }\n' "$v" > "$SYNC/lib/src/lib.c"
+    ( cd "$SYNC/lib" && git -c user.name=goose -c user.email=goose@localhost commit -qam "c$v" ) >/dev/null 2>&1
+done
+UPDOUT="$( cd "$SYNC/app" && "$GOOSE" update -j 2 2>&1 )"
+echo "$UPDOUT" | grep -Eq "^ +lib +[0-9a-f]{7} +[0-9a-f]{7} +2$" &&
+    grep -q "$( git -C "$SYNC/lib" rev-parse HEAD )" "$SYNC/app/goose.lock" &&
+    ok "update reports moved commits and pins the new tip" || bad "update reports moved commits and pins the new tip"
+touch "$SYNC/before-update"
+sleep 1
+( cd "$SYNC/app" && "$GOOSE" update ) >/dev/null 2>&1
+[ ! "$SYNC/app/goose.lock" -nt "$SYNC/before-update" ] &&
+    ok "update leaves an unchanged lock alone" || bad "update leaves an unchanged lock alone"
+
+# --- update: a remote that fails does not lose what the others moved to ---
+UPF="$WORK/updfail"
+mkdir -p "$UPF/gone/src" "$UPF/app/src"
+printf 'int gone_v(void) { return 1; }\n' > "$UPF/gone/src/gone.c"
+( cd "$UPF/gone" && git init -q && git add . &&
+  git -c user.name=goose -c user.email=goose@localhost commit -qm one ) >/dev/null 2>&1
+printf 'project:\n  name: "app"\n  version: "0.1.0"\n\ndependencies:\n  lib:\n    git: "file://%s/lib"\n  gone:\n    git: "file://%s/gone"\n' "$SYNC" "$UPF" > "$UPF/app/goose.yaml"
+printf 'int main(void) { return 0; }\n' > "$UPF/app/src/main.c"
+( cd "$UPF/app" && "$GOOSE" build ) >/dev/null 2>&1
+printf 'int lib_v(void) { return 5; }\n' > "$SYNC/lib/src/lib.c"
+( cd "$SYNC/lib" && git -c user.name=goose -c user.email=goose@localhost commit -qam c5 ) >/dev/null 2>&1
+rm -rf "$UPF/gone"
+UPDOUT="$( cd "$UPF/app" && "$GOOSE" update 2>&1 )"
+UPDRC=$?
+UPF_TIP="$( git -C "$SYNC/lib" rev-parse HEAD )"
+[ "$UPDRC" -ne 0 ] && echo "$UPDOUT" | grep -q "failed to update 'gone'" &&
+    [ "$( git -C "$UPF/app/packages/lib" rev-parse HEAD )" = "$UPF_TIP" ] &&
+    grep -q "$UPF_TIP" "$UPF/app/goose.lock" &&
+    ok "update locks the packages that moved when another fails" || bad "update locks the packages that moved when another fails"
+mkdir -p "$UPF/fresh/src"
+printf 'int main(void) { return 0; }\n' > "$UPF/fresh/src/main.c"
+sed 's/name: "app"/name: "fresh"/' "$UPF/app/goose.yaml" > "$UPF/fresh/goose.yaml"
+UPDOUT="$( cd "$UPF/fresh" && "$GOOSE" update -j 2 2>&1 )"
+echo "$UPDOUT" | grep -Eq "^ +lib +- +$( echo "$UPF_TIP" | cut -c1-7 ) +new$" &&
+    echo "$UPDOUT" | grep -A1 "Output gone" | grep -q "^    fatal:" &&
+    grep -q "$UPF_TIP" "$UPF/fresh/goose.lock" &&
+    ok "update clones missing packages as jobs with buffered output" || bad "update clones missing packages as jobs with buffered output"
+
+# --- lock sync: an entry for another version gives way to the new ref ---
+REL="$WORK/relock"
+mkdir -p "$REL/src"
+printf 'project:\n  name: "app"\n  version: "0.1.0"\n\ndependencies:\n  lib:\n    git: "file://%s/lib"\n' "$SYNC" > "$REL/goose.yaml"
+printf '#include <stdio.h>\nint lib_v(void);\nint main(void) { printf("v=%%d\\n", lib_v()); return 0; }\n' > "$REL/src/main.c"
+( cd "$REL" && "$GOOSE" build ) >/dev/null 2>&1
+git -C "$SYNC/lib" tag first "$SYNC_ONE"
+printf '    version: "first"\n' >> "$REL/goose.yaml"
+RELRUN="$( cd "$REL" && "$GOOSE" run 2>/dev/null )"
+echo "$RELRUN" | grep -q "v=1" && grep -q "$SYNC_ONE" "$REL/goose.lock" &&
+    ok "lock entry for another version is not synced to" || bad "lock entry for another version is not synced to"
+
+# --- vendor: locked packages restored from one archive, no remote needed ---
+( cd "$SYNC/app" && "$GOOSE" vendor ) >/dev/null 2>&1
+cp "$SYNC/app/goose.vendor" "$SYNC/first.vendor"
+rm -rf "$SYNC/app/packages" "$SYNC/app/build"
+mv "$SYNC/lib" "$SYNC/lib.away"
+VENDRUN="$( cd "$SYNC/app" && "$GOOSE" run --offline 2>/dev/null )"
+echo "$VENDRUN" | grep -q "v=4" && ok "offline build restores packages from the vendor archive" ||
+    bad "offline build restores packages from the vendor archive"
+mv "$SYNC/lib.away" "$SYNC/lib"
+( cd "$SYNC/app" && "$GOOSE" vendor ) >/dev/null 2>&1
+check "vendoring the same lock twice gives an identical archive" \
+    cmp "$SYNC/first.vendor" "$SYNC/app/goose.vendor"
+mkdir -p "$SYNC/app/packages/lib/data/empty"
+( cd "$SYNC/app" && "$GOOSE" vendor && rm -rf packages && "$GOOSE" build --offline ) >/dev/null 2>&1
+check "vendoring keeps empty directories" test -d "$SYNC/app/packages/lib/data/empty"
+
+# an archive entry under a symlink unpacked before it must not escape
+mkdir -p "$SYNC/outside" "$SYNC/app/packages/lib/lnb"
+ln -s "$SYNC/outside" "$SYNC/app/packages/lib/lna"
+printf 'int x;\n' > "$SYNC/app/packages/lib/lnb/x.c"
+( cd "$SYNC/app" && "$GOOSE" vendor ) >/dev/null 2>&1
+perl -pi -e 's{lnb/x\.c}{lna/x.c}g' "$SYNC/app/goose.vendor"
+rm -rf "$SYNC/app/packages"
+VENDOUT="$( cd "$SYNC/app" && "$GOOSE" build --offline 2>&1 )"
+[ ! -e "$SYNC/outside/x.c" ] && echo "$VENDOUT" | grep -q "through the symbolic link" &&
+    ok "vendor restore does not write through a symlink" || bad "vendor restore does not write through a symlink"
+
+# --- large projects: no fixed cap on sources, long links use a response file ---
+BIG="$WORK/big"
+DEEP="src/generated/sources_in_a_deliberately_long_directory_name_so_that_the_link_line_outgrows_the_limit"
+mkdir -p "$BIG/$DEEP"
+cat > "$BIG/goose.yaml" <<'YAML'
+project:
+  name: "big"
+  version: "0.1.0"
+
+build:
+  cc: "cc"
+  cflags: "-std=c11"
+  includes:
+    - "src"
+YAML
+i=0
+while [ $i -lt 300 ]; do
+    echo "int big_$i(void) { return 1; }" > "$BIG/$DEEP/f$i.c"
+    i=$((i + 1))
+done
+{
+    echo '#include <stdio.h>'
+    i=0
+    while [ $i -lt 300 ]; do echo "int big_$i(void);"; i=$((i + 1)); done
+    echo 'int main(void) {'
+    echo '    int n = 0;'
+    i=0
+    while [ $i -lt 300 ]; do echo "    n += big_$i();"; i=$((i + 1)); done
+    printf '%s\n' '    printf("total=%d\\n", n);'
+    echo '    return 0;'
+    echo '}'
+} > "$BIG/src/main.c"
+BIGRUN="$( cd "$BIG" && "$GOOSE" run 2>&1 )"
+echo "$BIGRUN" | grep -q "total=300" && ok "project with 300 sources links every file" || bad "project with 300 sources links every file"
+check "long link command goes through a response file" test -f "$BIG/build/debug/big.rsp"
 
 echo
 echo "results: $PASS passed, $FAIL failed"